@@ -0,0 +1,229 @@
+#define _GNU_SOURCE
+#include "bench.h"
+#include "launcher.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <sys/wait.h>
+
+uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t bench_percentile(const uint64_t *sorted, size_t n, double p) {
+  if (n == 0) return 0;
+  size_t rank = (size_t)(p / 100.0 * (double)n + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank > n) rank = n;
+  return sorted[rank - 1];
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+int bench_spawn(int count, int ballast_mb) {
+  char *ballast = NULL;
+  if (ballast_mb > 0) {
+    ballast = malloc((size_t)ballast_mb << 20);
+    if (!ballast) {
+      fprintf(stderr, "lab1p1: cannot allocate %d MiB of ballast\n", ballast_mb);
+      return 1;
+    }
+    memset(ballast, 1, (size_t)ballast_mb << 20);
+  }
+  uint64_t *lat = malloc((size_t)count * sizeof(uint64_t));
+  if (!lat) {
+    free(ballast);
+    return 1;
+  }
+
+  char *argv[] = {"/bin/true", NULL};
+  printf("%-12s %12s %12s %12s   (%d spawns of /bin/true, %d MiB ballast)\n",
+         "backend", "spawns/s", "p50 us", "p99 us", count, ballast_mb);
+  int rc = 0;
+  for (int b = 0; b < SPAWN_BACKENDS; b++) {
+    uint64_t start = bench_now_ns();
+    int ok = 1;
+    for (int i = 0; i < count && ok; i++) {
+      uint64_t t0 = bench_now_ns();
+      pid_t pid = spawn_command((SpawnBackend)b, argv[0], argv, NULL, NULL);
+      lat[i] = bench_now_ns() - t0;
+      int status;
+      if (pid < 0) ok = 0;
+      else while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+      }
+    }
+    if (!ok) {
+      printf("%-12s %12s\n", spawn_backend_name((SpawnBackend)b), "failed");
+      rc = 1;
+      continue;
+    }
+    double secs = (double)(bench_now_ns() - start) / 1e9;
+    qsort(lat, (size_t)count, sizeof(uint64_t), cmp_u64);
+    printf("%-12s %12.0f %12.1f %12.1f\n", spawn_backend_name((SpawnBackend)b), count / secs,
+           bench_percentile(lat, (size_t)count, 50) / 1e3, bench_percentile(lat, (size_t)count, 99) / 1e3);
+  }
+  free(lat);
+  free(ballast);
+  return rc;
+}
+
+// === Repeat mode ===
+// Hands out each collected command warmup + repeat times in a row and
+// keeps the timed runs' wall times
+typedef struct Repeat {
+  Command *cmds;
+  Arena *arenas;
+  int n;
+  int repeat, warmup;
+  int at, run;       // next command and run of it to hand out
+  int *finished;     // runs heard back, per command
+  int *failed;       // failed runs, warmup included
+  uint64_t *samples; // repeat per command
+} Repeat;
+
+static int repeat_next(void *ctx, Command *cmd, Arena *arena) {
+  Repeat *rp = ctx;
+  (void)arena; // the commands keep their own
+  if (rp->at == rp->n) return 0;
+  *cmd = rp->cmds[rp->at];
+  cmd->id = rp->at;
+  if (++rp->run == rp->warmup + rp->repeat) {
+    rp->run = 0;
+    rp->at++;
+  }
+  return 1;
+}
+
+static void repeat_done(void *ctx, const Command *cmd, const RunResult *r) {
+  Repeat *rp = ctx;
+  int i = cmd->id, k = rp->finished[i]++ - rp->warmup;
+  if (!run_succeeded(r)) rp->failed[i]++;
+  if (k >= 0) rp->samples[(size_t)i * (size_t)rp->repeat + (size_t)k] = r->wall_ns;
+}
+
+// The command as typed, stages joined by " | "
+static void print_command(FILE *fp, const Command *cmd, int json) {
+  size_t len = 1;
+  for (int s = 0; s < cmd->nstages; s++) {
+    for (int a = 0; a < cmd->stages[s].argc; a++) len += strlen(cmd->stages[s].argv[a]) + 3;
+  }
+  char *text = malloc(len), *p = text;
+  if (!text) return;
+  for (int s = 0; s < cmd->nstages; s++) {
+    if (s) p = stpcpy(p, " | ");
+    for (int a = 0; a < cmd->stages[s].argc; a++) {
+      if (a) *p++ = ' ';
+      p = stpcpy(p, cmd->stages[s].argv[a]);
+    }
+  }
+  *p = '\0';
+  if (json) run_json_string(fp, text);
+  else fputs(text, fp);
+  free(text);
+}
+
+static void report(const Repeat *rp, int i, int json) {
+  size_t n = (size_t)rp->repeat;
+  uint64_t *t = &rp->samples[(size_t)i * n];
+  qsort(t, n, sizeof(uint64_t), cmp_u64);
+  double sum = 0, sq = 0;
+  for (size_t k = 0; k < n; k++) sum += (double)t[k];
+  double mean = sum / (double)n;
+  for (size_t k = 0; k < n; k++) sq += ((double)t[k] - mean) * ((double)t[k] - mean);
+  double stddev = n > 1 ? sqrt(sq / (double)(n - 1)) : 0;
+
+  // Tukey's fences around the interquartile range
+  double q1 = (double)bench_percentile(t, n, 25), q3 = (double)bench_percentile(t, n, 75), iqr = q3 - q1;
+  int low_severe = 0, low_mild = 0, high_mild = 0, high_severe = 0;
+  for (size_t k = 0; k < n; k++) {
+    double x = (double)t[k];
+    if (x < q1 - 3 * iqr) low_severe++;
+    else if (x < q1 - 1.5 * iqr) low_mild++;
+    else if (x > q3 + 3 * iqr) high_severe++;
+    else if (x > q3 + 1.5 * iqr) high_mild++;
+  }
+
+  double ms[6] = {mean, stddev, (double)t[0], (double)bench_percentile(t, n, 50),
+                  (double)bench_percentile(t, n, 95), (double)t[n - 1]};
+  for (int k = 0; k < 6; k++) ms[k] /= 1e6;
+  if (json) {
+    printf("{\"command\":");
+    print_command(stdout, &rp->cmds[i], 1);
+    printf(",\"runs\":%d,\"warmup\":%d,\"failed\":%d,\"mean_ms\":%.4f,\"stddev_ms\":%.4f,"
+           "\"min_ms\":%.4f,\"median_ms\":%.4f,\"p95_ms\":%.4f,\"max_ms\":%.4f,"
+           "\"outliers\":{\"low_severe\":%d,\"low_mild\":%d,\"high_mild\":%d,\"high_severe\":%d}}\n",
+           rp->repeat, rp->warmup, rp->failed[i], ms[0], ms[1], ms[2], ms[3], ms[4], ms[5], low_severe,
+           low_mild, high_mild, high_severe);
+    return;
+  }
+  print_command(stdout, &rp->cmds[i], 0);
+  printf("  (%d runs after %d warmup)\n", rp->repeat, rp->warmup);
+  printf("  mean %9.3f ms   stddev %9.3f ms\n", ms[0], ms[1]);
+  printf("  min  %9.3f ms   median %9.3f ms   p95 %9.3f ms   max %9.3f ms\n", ms[2], ms[3], ms[4], ms[5]);
+  int outliers = low_severe + low_mild + high_mild + high_severe;
+  if (outliers) {
+    printf("  outliers: %d (%.0f%%): %d low severe, %d low mild, %d high mild, %d high severe\n", outliers,
+           100.0 * outliers / rp->repeat, low_severe, low_mild, high_mild, high_severe);
+  }
+  if (rp->failed[i]) printf("  %d of %d runs failed\n", rp->failed[i], rp->warmup + rp->repeat);
+}
+
+int bench_repeat(const RunOptions *opt, CommandSource *src, int repeat, int warmup, int json) {
+  Repeat rp = {0};
+  rp.repeat = repeat;
+  rp.warmup = warmup;
+  int cap = 0, bad = 0;
+  for (;;) {
+    if (rp.n == cap) {
+      int old = cap;
+      cap = cap ? cap * 2 : 8;
+      rp.cmds = realloc(rp.cmds, (size_t)cap * sizeof(Command));
+      rp.arenas = realloc(rp.arenas, (size_t)cap * sizeof(Arena));
+      if (!rp.cmds || !rp.arenas) {
+        fprintf(stderr, "lab1p1: out of memory\n");
+        exit(1);
+      }
+      memset(&rp.arenas[old], 0, (size_t)(cap - old) * sizeof(Arena));
+    }
+    int got = src->next(src->ctx, &rp.cmds[rp.n], &rp.arenas[rp.n]);
+    if (got == 1) rp.n++;
+    else if (got < 0) bad++;
+    else break;
+  }
+  free(rp.arenas[rp.n].buf);
+  rp.finished = calloc((size_t)rp.n + 1, sizeof(int));
+  rp.failed = calloc((size_t)rp.n + 1, sizeof(int));
+  rp.samples = calloc((size_t)rp.n * (size_t)repeat + 1, sizeof(uint64_t));
+  if (!rp.finished || !rp.failed || !rp.samples) {
+    fprintf(stderr, "lab1p1: out of memory\n");
+    exit(1);
+  }
+
+  // One run at a time, so runs do not compete with each other
+  RunOptions one = *opt;
+  one.max_jobs = 0;
+  one.discard_output = 1;
+  CommandSource runs = {repeat_next, repeat_done, &rp};
+  run_commands(&one, &runs);
+
+  int failures = bad;
+  for (int i = 0; i < rp.n; i++) {
+    report(&rp, i, json);
+    if (rp.failed[i]) failures++;
+    free(rp.arenas[i].buf);
+  }
+  free(rp.cmds);
+  free(rp.arenas);
+  free(rp.finished);
+  free(rp.failed);
+  free(rp.samples);
+  return failures;
+}
@@ -0,0 +1,28 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "runner.h"
+
+// Monotonic clock in nanoseconds
+uint64_t bench_now_ns(void);
+
+// p-th percentile (0..100) of sorted[0..n), nearest rank
+uint64_t bench_percentile(const uint64_t *sorted, size_t n, double p);
+
+// Spawn /bin/true `count` times with every backend and print spawns per
+// second (spawn + reap) and the p50/p99 time of the launch call itself.
+// ballast_mb of touched heap first makes the parent's address space
+// large, which is what fork pays for. Returns 0, or 1 on failure.
+int bench_spawn(int count, int ballast_mb);
+
+// Run every command from src warmup + repeat times, one run at a time
+// with its output discarded, and report the wall time of the last
+// `repeat` runs: mean, standard deviation, min, median, p95, max, and how
+// many runs lie outside Tukey's fences (1.5 and 3 interquartile ranges
+// beyond the quartiles). Text on stdout, or one JSON object per command
+// with `json`. Returns the number of commands with a failed run.
+int bench_repeat(const RunOptions *opt, CommandSource *src, int repeat, int warmup, int json);
+
+#endif // BENCH_H
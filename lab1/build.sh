@@ -4,7 +4,7 @@ echo "🗑️  Removing old binary..."
 rm -f lab1p1
 
 echo "🛠️  Compiling..."
-gcc lab1p1.c -o lab1p1
+gcc lab1p1.c runner.c joblist.c dag.c launcher.c pathcache.c bench.c -o lab1p1 -lm
 
 if [ $? -eq 0 ]; then
     echo "✅ Compilation successful: ./lab1p1"
@@ -0,0 +1,382 @@
+#define _GNU_SOURCE
+#include "dag.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "joblist.h"
+
+enum { PENDING, READY, STARTED, FINISHED, SKIPPED };
+
+typedef struct Step {
+  char *name;
+  long line;
+  Command cmd;
+  Arena arena;       // cmd's stages and words
+  char *deps;        // dependency names, NUL-separated, until resolved
+  int ndeps;
+  int first_succ;    // successors: succ[first_succ .. first_succ + nsucc)
+  int nsucc;
+  int waiting;       // dependencies that have not finished
+  double cost, rank; // rank: cost plus the largest rank among successors
+  int state;
+  int blame;         // for a skipped step, the failed step behind it
+} Step;
+
+struct Dag {
+  const char *name;  // the file, for messages
+  Step *steps;
+  int n, cap;
+  int *table;        // name -> step + 1, open addressing; 0 = empty
+  size_t mask;
+  int *succ;
+  int *heap, nheap;  // ready steps, highest rank first
+  int *skipped, nskipped; // skipped, not reported yet
+  int handed_out;    // started or reported as skipped; n when done
+  int fail_fast, stopped;
+  int sweep;         // after a fail-fast stop: next step to report
+};
+
+static void *xcalloc(size_t n, size_t size) {
+  void *p = calloc(n ? n : 1, size);
+  if (!p) {
+    fprintf(stderr, "lab1p1: out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+static void *xrealloc(void *old, size_t size) {
+  void *p = realloc(old, size ? size : 1);
+  if (!p) {
+    fprintf(stderr, "lab1p1: out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+static char *xstrndup(const char *s, size_t len) {
+  char *p = strndup(s, len);
+  if (!p) {
+    fprintf(stderr, "lab1p1: out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+// === Names ===
+static uint64_t hash_name(const char *s, size_t len) {
+  uint64_t h = 1469598103934665603ULL; // FNV-1a
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)s[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+// Slot for name: holding it, or the empty one where it would go
+static int *find_slot(Dag *d, const char *name, size_t len) {
+  for (size_t i = hash_name(name, len) & d->mask;; i = (i + 1) & d->mask) {
+    int s = d->table[i];
+    if (!s) return &d->table[i];
+    const char *other = d->steps[s - 1].name;
+    if (strlen(other) == len && memcmp(other, name, len) == 0) return &d->table[i];
+  }
+}
+
+static int build_table(Dag *d) {
+  size_t size = 16;
+  while (size < (size_t)d->n * 2) size *= 2;
+  d->table = xcalloc(size, sizeof(int));
+  d->mask = size - 1;
+  for (int i = 0; i < d->n; i++) {
+    int *slot = find_slot(d, d->steps[i].name, strlen(d->steps[i].name));
+    if (*slot) {
+      fprintf(stderr, "lab1p1: %s:%ld: step '%s' already defined on line %ld\n", d->name, d->steps[i].line,
+              d->steps[i].name, d->steps[*slot - 1].line);
+      return -1;
+    }
+    *slot = i + 1;
+  }
+  return 0;
+}
+
+// === Loading ===
+// Next blank-separated word of a step header
+static const char *header_word(const char **p, size_t *len) {
+  const char *s = *p;
+  while (*s == ' ' || *s == '\t') s++;
+  const char *w = s;
+  while (*s && *s != ' ' && *s != '\t' && *s != '\r' && *s != '\n') s++;
+  *len = (size_t)(s - w);
+  *p = s;
+  return *len ? w : NULL;
+}
+
+// NAME [after DEP...] [~SECS] = COMMAND into a new step
+static const char *parse_step(Dag *d, const char *line) {
+  const char *p = line, *w;
+  size_t len;
+  if (!(w = header_word(&p, &len)) || (len == 1 && *w == '=')) return "missing step name";
+  if (d->n == d->cap) {
+    d->cap = d->cap ? d->cap * 2 : 64;
+    d->steps = xrealloc(d->steps, (size_t)d->cap * sizeof(Step));
+  }
+  Step *st = &d->steps[d->n];
+  memset(st, 0, sizeof(*st));
+  st->cost = 1;
+  st->name = xstrndup(w, len);
+  st->deps = xcalloc(strlen(line) + 1, 1);
+  size_t used = 0;
+  int after = 0;
+  const char *err = NULL;
+  while (!err) {
+    if (!(w = header_word(&p, &len))) {
+      err = "missing '=' before the command";
+    } else if (len == 1 && *w == '=') {
+      break;
+    } else if (*w == '~') {
+      char *end;
+      st->cost = strtod(w + 1, &end);
+      if (end != w + len || st->cost < 0) err = "bad ~SECS";
+    } else if (!after && len == 5 && memcmp(w, "after", 5) == 0) {
+      after = 1;
+    } else if (after) {
+      memcpy(st->deps + used, w, len);
+      used += len + 1;
+      st->ndeps++;
+    } else {
+      err = "expected 'after', '~SECS' or '='";
+    }
+  }
+  if (err || joblist_parse(p, &st->cmd, &st->arena, &err) < 0) {
+    free(st->name);
+    free(st->deps);
+    free(st->arena.buf);
+    return err;
+  }
+  d->n++;
+  return NULL;
+}
+
+// Dependencies to successor lists, and each step's waiting count
+static int link_steps(Dag *d) {
+  int total = 0, rc = 0;
+  for (int pass = 0; pass < 2 && rc == 0; pass++) {
+    if (pass == 1) {
+      d->succ = xcalloc((size_t)total, sizeof(int));
+      for (int i = 0, at = 0; i < d->n; i++) {
+        d->steps[i].first_succ = at;
+        at += d->steps[i].nsucc;
+        d->steps[i].nsucc = 0;
+      }
+    }
+    for (int i = 0; i < d->n && rc == 0; i++) {
+      Step *st = &d->steps[i];
+      const char *dep = st->deps;
+      for (int k = 0; k < st->ndeps; k++, dep += strlen(dep) + 1) {
+        int j = *find_slot(d, dep, strlen(dep)) - 1;
+        if (j < 0 || j == i) {
+          fprintf(stderr, "lab1p1: %s:%ld: %s: %s '%s'\n", d->name, st->line, st->name,
+                  j < 0 ? "unknown step" : "depends on itself", dep);
+          rc = -1;
+          break;
+        }
+        Step *prev = &d->steps[j];
+        if (pass == 0) {
+          prev->nsucc++;
+          total++;
+          st->waiting++;
+        } else {
+          d->succ[prev->first_succ + prev->nsucc++] = i;
+        }
+      }
+    }
+  }
+  return rc;
+}
+
+// Ranks in reverse topological order; -1 (after naming the steps) if
+// the graph has a cycle
+static int rank_steps(Dag *d) {
+  int *order = xcalloc((size_t)d->n, sizeof(int));
+  int *left = xcalloc((size_t)d->n, sizeof(int));
+  int n = 0;
+  for (int i = 0; i < d->n; i++) {
+    left[i] = d->steps[i].waiting;
+    if (!left[i]) order[n++] = i;
+  }
+  for (int k = 0; k < n; k++) {
+    const Step *st = &d->steps[order[k]];
+    for (int s = 0; s < st->nsucc; s++) {
+      int j = d->succ[st->first_succ + s];
+      if (--left[j] == 0) order[n++] = j;
+    }
+  }
+  int rc = 0;
+  if (n < d->n) {
+    fprintf(stderr, "lab1p1: %s: dependency cycle among:", d->name);
+    for (int i = 0; i < d->n; i++) {
+      if (left[i]) fprintf(stderr, " %s", d->steps[i].name);
+    }
+    fputc('\n', stderr);
+    rc = -1;
+  } else {
+    for (int k = n - 1; k >= 0; k--) {
+      Step *st = &d->steps[order[k]];
+      double longest = 0;
+      for (int s = 0; s < st->nsucc; s++) {
+        double r = d->steps[d->succ[st->first_succ + s]].rank;
+        if (r > longest) longest = r;
+      }
+      st->rank = st->cost + longest;
+    }
+  }
+  free(order);
+  free(left);
+  return rc;
+}
+
+// === Ready heap ===
+static int before(const Dag *d, int a, int b) {
+  double ra = d->steps[a].rank, rb = d->steps[b].rank;
+  return ra > rb || (ra == rb && a < b); // file order breaks ties
+}
+
+static void heap_push(Dag *d, int i) {
+  int k = d->nheap++;
+  while (k > 0 && before(d, i, d->heap[(k - 1) / 2])) {
+    d->heap[k] = d->heap[(k - 1) / 2];
+    k = (k - 1) / 2;
+  }
+  d->heap[k] = i;
+  d->steps[i].state = READY;
+}
+
+static int heap_pop(Dag *d) {
+  int top = d->heap[0], last = d->heap[--d->nheap], k = 0;
+  for (;;) {
+    int c = 2 * k + 1;
+    if (c >= d->nheap) break;
+    if (c + 1 < d->nheap && before(d, d->heap[c + 1], d->heap[c])) c++;
+    if (!before(d, d->heap[c], last)) break;
+    d->heap[k] = d->heap[c];
+    k = c;
+  }
+  if (d->nheap) d->heap[k] = last;
+  return top;
+}
+
+// Mark the pending successors of `at` skipped because of step `blame`
+static void skip_after(Dag *d, const Step *at, int blame) {
+  for (int s = 0; s < at->nsucc; s++) {
+    Step *next = &d->steps[d->succ[at->first_succ + s]];
+    if (next->state != PENDING) continue;
+    next->state = SKIPPED;
+    next->blame = blame;
+    d->skipped[d->nskipped++] = (int)(next - d->steps);
+  }
+}
+
+// === Public ===
+Dag *dag_load(FILE *fp, const char *name, int fail_fast) {
+  Dag *d = xcalloc(1, sizeof(Dag));
+  d->name = name;
+  d->fail_fast = fail_fast;
+  char *line = NULL;
+  size_t cap = 0;
+  long lineno = 0;
+  int bad = 0;
+  while (getline(&line, &cap, fp) >= 0) {
+    lineno++;
+    const char *p = line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '#' || *p == '\n' || *p == '\r' || !*p) continue;
+    const char *err = parse_step(d, p);
+    if (err) {
+      fprintf(stderr, "lab1p1: %s:%ld: %s\n", name, lineno, err);
+      bad = 1;
+    } else {
+      d->steps[d->n - 1].line = lineno;
+    }
+  }
+  free(line);
+  if (bad || build_table(d) < 0 || link_steps(d) < 0 || rank_steps(d) < 0) {
+    dag_free(d);
+    return NULL;
+  }
+  d->heap = xcalloc((size_t)d->n, sizeof(int));
+  d->skipped = xcalloc((size_t)d->n, sizeof(int));
+  for (int i = 0; i < d->n; i++) {
+    free(d->steps[i].deps);
+    d->steps[i].deps = NULL;
+    if (!d->steps[i].waiting) heap_push(d, i);
+  }
+  return d;
+}
+
+void dag_free(Dag *d) {
+  if (!d) return;
+  for (int i = 0; i < d->n; i++) {
+    free(d->steps[i].name);
+    free(d->steps[i].deps);
+    free(d->steps[i].arena.buf);
+  }
+  free(d->steps);
+  free(d->table);
+  free(d->succ);
+  free(d->heap);
+  free(d->skipped);
+  free(d);
+}
+
+int dag_next(void *ctx, Command *cmd, Arena *arena) {
+  Dag *d = ctx;
+  (void)arena; // steps keep their own
+  if (d->nskipped) {
+    const Step *st = &d->steps[d->skipped[--d->nskipped]];
+    fprintf(stderr, "lab1p1: %s: skipped, %s failed\n", st->name, d->steps[st->blame].name);
+    d->handed_out++;
+    return -1;
+  }
+  if (d->stopped) {
+    while (d->sweep < d->n && d->steps[d->sweep].state != PENDING && d->steps[d->sweep].state != READY) d->sweep++;
+    if (d->sweep == d->n) return 0;
+    Step *st = &d->steps[d->sweep++];
+    st->state = SKIPPED;
+    fprintf(stderr, "lab1p1: %s: not started after a failure\n", st->name);
+    d->handed_out++;
+    return -1;
+  }
+  if (d->nheap) {
+    int i = heap_pop(d);
+    Step *st = &d->steps[i];
+    st->state = STARTED;
+    *cmd = st->cmd;
+    cmd->id = i;
+    cmd->name = st->name;
+    d->handed_out++;
+    return 1;
+  }
+  return d->handed_out == d->n ? 0 : RUN_WAIT;
+}
+
+void dag_done(void *ctx, const Command *cmd, const RunResult *r) {
+  Dag *d = ctx;
+  int failed = !run_succeeded(r);
+  Step *st = &d->steps[cmd->id];
+  st->state = FINISHED;
+  if (failed && d->fail_fast) {
+    d->stopped = 1;
+  } else if (failed) {
+    // Everything downstream is skipped; the new entries of d->skipped
+    // double as the walk's worklist
+    int from = d->nskipped;
+    skip_after(d, st, cmd->id);
+    for (int k = from; k < d->nskipped; k++) skip_after(d, &d->steps[d->skipped[k]], cmd->id);
+  } else {
+    for (int s = 0; s < st->nsucc; s++) {
+      Step *next = &d->steps[d->succ[st->first_succ + s]];
+      if (--next->waiting == 0 && next->state == PENDING) heap_push(d, (int)(next - d->steps));
+    }
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef DAG_H
+#define DAG_H
+
+#include <stdio.h>
+#include "runner.h"
+
+// A job file of named steps with dependencies, run as a DAG. Each line is
+//
+//   NAME [after DEP...] [~SECS] = COMMAND
+//
+// where COMMAND uses the job-list syntax (see joblist.h) and DEP names a
+// step anywhere in the file. A step is handed out as soon as all of its
+// dependencies have succeeded. Among ready steps the one with the longest
+// path to the end of the graph goes first, so the critical path is never
+// left waiting; each step counts SECS (default 1) towards that length.
+//
+// When a step fails, the steps that depend on it are skipped and the rest
+// carry on; with fail_fast nothing new starts after the first failure.
+// Skipped steps are reported and count as failed.
+
+typedef struct Dag Dag;
+
+// NULL after reporting what was wrong (syntax, unknown or duplicate
+// names, a cycle)
+Dag *dag_load(FILE *fp, const char *name, int fail_fast);
+
+void dag_free(Dag *dag);
+
+// For a CommandSource
+int dag_next(void *ctx, Command *cmd, Arena *arena);
+void dag_done(void *ctx, const Command *cmd, const RunResult *r);
+
+#endif // DAG_H
@@ -0,0 +1,199 @@
+#define _GNU_SOURCE
+#include "joblist.h"
+#include <stdlib.h>
+#include <string.h>
+
+// What a stage with no words runs
+static char *true_argv[] = {"/bin/true", NULL};
+
+enum { WORD, PIPE, IN, OUT, APPEND };
+
+static void *arena_reserve(Arena *a, size_t size) {
+  if (size > a->cap) {
+    size_t cap = a->cap ? a->cap : 256;
+    while (cap < size) cap *= 2;
+    char *p = realloc(a->buf, cap);
+    if (!p) {
+      fprintf(stderr, "lab1p1: out of memory\n");
+      exit(1);
+    }
+    a->buf = p;
+    a->cap = cap;
+  }
+  return a->buf;
+}
+
+static int operator(const char *s) {
+  if (strcmp(s, "|") == 0) return PIPE;
+  if (strcmp(s, "<") == 0) return IN;
+  if (strcmp(s, ">") == 0) return OUT;
+  if (strcmp(s, ">>") == 0) return APPEND;
+  return WORD;
+}
+
+// Words argv[from..to) are one stage; terminate them in place (argv[to]
+// is a separator or already NULL). No words runs /bin/true.
+static void close_stage(Stage *st, char **argv, int from, int to) {
+  argv[to] = NULL;
+  st->argv = to > from ? &argv[from] : true_argv;
+  st->argc = to > from ? to - from : 1;
+}
+
+// === Command line ===
+int argv_next(void *ctx, Command *cmd, Arena *arena) {
+  ArgvList *l = ctx;
+  char **argv = l->argv;
+  if (l->pos >= l->end) return 0;
+
+  // Where the command ends and how many stages it has. The word after a
+  // redirection is its file, whatever it says.
+  int end = l->pos, nstages = 1;
+  for (; end < l->end && strcmp(argv[end], "+") != 0; end++) {
+    int op = operator(argv[end]);
+    if (op == PIPE) nstages++;
+    else if (op != WORD && end + 1 < l->end) end++;
+  }
+
+  Stage *stages = arena_reserve(arena, (size_t)nstages * sizeof(Stage));
+  memset(stages, 0, (size_t)nstages * sizeof(Stage));
+  int s = 0, from = l->pos, w = l->pos;
+  for (int i = l->pos; i < end; i++) {
+    int op = operator(argv[i]);
+    if (op == PIPE) {
+      close_stage(&stages[s++], argv, from, w);
+      from = w = i + 1;
+    } else if (op != WORD) {
+      // Redirections are squeezed out, so the words stay contiguous
+      if (op == IN) stages[s].in_path = argv[i + 1];
+      else stages[s].out_path = argv[i + 1];
+      stages[s].append = op == APPEND;
+      i++;
+    } else {
+      argv[w++] = argv[i];
+    }
+  }
+  close_stage(&stages[s], argv, from, w);
+
+  cmd->stages = stages;
+  cmd->nstages = nstages;
+  cmd->id = 0;
+  cmd->name = NULL;
+  l->pos = end + 1;
+  return 1;
+}
+
+// === Job list ===
+// Read the word at *p into out (NULL = only measure it) and NUL-terminate
+// it. Returns its operator (WORD unless it is an unquoted operator), -1
+// at the end of the line or -2 for an unterminated quote.
+static int next_word(const char **p, char *out) {
+  const char *s = *p;
+  while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') s++;
+  if (!*s) return -1;
+  const char *start = s;
+  int quoted = 0;
+  char quote = 0;
+  size_t n = 0;
+  for (; *s; s++) {
+    char c = *s;
+    if (quote) {
+      if (c == quote) {
+        quote = 0;
+        continue;
+      }
+      if (c == '\\' && quote == '"' && s[1]) c = *++s;
+    } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+      break;
+    } else if (c == '\'' || c == '"') {
+      quote = c;
+      quoted = 1;
+      continue;
+    } else if (c == '\\' && s[1]) {
+      c = *++s;
+      quoted = 1;
+    }
+    if (out) out[n] = c;
+    n++;
+  }
+  if (quote) return -2;
+  *p = s;
+  if (!out) {
+    // Operators are short; compare the raw text
+    size_t len = (size_t)(s - start);
+    if (quoted || len > 2) return WORD;
+    char op[3] = {0};
+    memcpy(op, start, len);
+    return operator(op);
+  }
+  out[n] = '\0';
+  return quoted ? WORD : operator(out);
+}
+
+int joblist_parse(const char *line, Command *cmd, Arena *arena, const char **err) {
+  // First pass: check the line and size it
+  const char *p = line;
+  int nwords = 0, nstages = 1, op, pending = WORD;
+  *err = NULL;
+  while ((op = next_word(&p, NULL)) >= 0) {
+    if (pending != WORD && op != WORD) *err = "redirection needs a file";
+    if (op == PIPE) nstages++;
+    else if (op == WORD && pending == WORD) nwords++;
+    pending = op == PIPE || pending != WORD ? WORD : op;
+  }
+  if (op == -2) *err = "unterminated quote";
+  else if (pending != WORD) *err = "redirection needs a file";
+  else if (p == line) *err = "empty command";
+  if (*err) return -1;
+
+  // Stages, then argument pointers, then the words' bytes
+  size_t stage_bytes = (size_t)nstages * sizeof(Stage);
+  size_t ptr_bytes = (size_t)(nwords + nstages) * sizeof(char *);
+  char *base = arena_reserve(arena, stage_bytes + ptr_bytes + strlen(line) + 1);
+  Stage *stages = (Stage *)base;
+  char **argv = (char **)(base + stage_bytes);
+  char *text = base + stage_bytes + ptr_bytes;
+  memset(stages, 0, stage_bytes);
+
+  int s = 0, w = 0, from = 0;
+  p = line;
+  while ((op = next_word(&p, text)) >= 0) {
+    char *word = text;
+    text += strlen(word) + 1;
+    if (op == PIPE) {
+      close_stage(&stages[s++], argv, from, w);
+      from = ++w;
+    } else if (op != WORD) {
+      char *file = text;
+      next_word(&p, text);
+      text += strlen(file) + 1;
+      if (op == IN) stages[s].in_path = file;
+      else stages[s].out_path = file;
+      stages[s].append = op == APPEND;
+    } else {
+      argv[w++] = word;
+    }
+  }
+  close_stage(&stages[s], argv, from, w);
+
+  cmd->stages = stages;
+  cmd->nstages = nstages;
+  cmd->id = 0;
+  cmd->name = NULL;
+  return 0;
+}
+
+int file_next(void *ctx, Command *cmd, Arena *arena) {
+  FileList *l = ctx;
+  for (;;) {
+    if (getline(&l->buf, &l->cap, l->fp) < 0) return 0;
+    l->line++;
+    const char *p = l->buf;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '#' || *p == '\n' || *p == '\r' || !*p) continue;
+
+    const char *err;
+    if (joblist_parse(l->buf, cmd, arena, &err) == 0) return 1;
+    fprintf(stderr, "lab1p1: %s:%ld: %s\n", l->name, l->line, err);
+    return -1;
+  }
+}
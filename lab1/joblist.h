@@ -0,0 +1,41 @@
+#ifndef JOBLIST_H
+#define JOBLIST_H
+
+#include <stdio.h>
+#include "runner.h"
+
+// Command sources for run_commands. Neither copies the whole list: the
+// command line is parsed in place, and a job list is read one line at a
+// time into the arena of the slot that will run it, so memory stays
+// bounded however long the list is.
+
+// The command line: commands separated by '+'. Argument vectors point
+// into argv itself; the separators' slots are overwritten with the NULL
+// terminators (and redirections are squeezed out), nothing is copied.
+typedef struct ArgvList {
+  char **argv;
+  int pos, end;
+} ArgvList;
+
+int argv_next(void *ctx, Command *cmd, Arena *arena);
+
+// A job list: one command per line, with the same '|', '<', '>' and '>>'
+// operators as the command line. Words are split on blanks; '...' and
+// "..." quote, and a backslash escapes the next character outside single
+// quotes. Blank lines and lines starting with '#' are skipped. A bad line
+// is reported with its number and counts as a failed command.
+typedef struct FileList {
+  FILE *fp;
+  const char *name;  // for messages
+  long line;
+  char *buf;         // the current line (getline's)
+  size_t cap;
+} FileList;
+
+int file_next(void *ctx, Command *cmd, Arena *arena);
+
+// One line of job-list syntax (without the comment / blank-line check)
+// into cmd, its memory in arena. Returns 0, or -1 with *err set.
+int joblist_parse(const char *line, Command *cmd, Arena *arena, const char **err);
+
+#endif // JOBLIST_H
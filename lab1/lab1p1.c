@@ -1,54 +1,153 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/wait.h>
+#include "runner.h"
+#include "launcher.h"
+#include "bench.h"
+#include "pathcache.h"
+#include "joblist.h"
+#include "dag.h"
 
-int execute(char strings[8][100], int s_index) {
-  char *args[9];
-  for (int i = 0; i < s_index; i++) {
-    args[i] = strings[i];
-  }
-  args[s_index] = NULL;
-  pid_t pid = fork();
-  if (pid == 0) {
-    execve(strings[0], args, NULL);
-    perror("execve failed");
-    _exit(1); 
-  } else if (pid > 0) {
-    wait(NULL);
-  } else {
-    perror("fork failed");
-    return -1;
-  }
+static void usage(void) {
+  fprintf(stderr,
+          "Usage: lab1p1 [-j N] [--spawn fork|vfork|posix_spawn|clone] [--timeout SECS] [--kill-after SECS]\n"
+          "              [--summary FILE] [--env] [--env-keep NAME]... cmd [args...] [+ cmd [args...]]...\n"
+          "       lab1p1 [options] -f FILE|-     (one command per line)\n"
+          "       lab1p1 [options] [--fail-fast] --dag FILE|-     (NAME [after DEP...] [~SECS] = cmd ...)\n"
+          "       lab1p1 --repeat N [--warmup K] [--json] [options] cmd ... | -f FILE\n"
+          "       lab1p1 --bench-spawn COUNT [BALLAST_MB]\n"
+          "A command may be a pipeline: cmd '|' cmd ..., each with '<' FILE, '>' FILE or '>>' FILE.\n");
+}
+
+extern char **environ;
+
+// Passed through by --env; --env-keep adds to it. A trailing '*'
+// matches a prefix.
+static const char *env_default[] = {"PATH", "HOME", "USER", "LOGNAME", "SHELL", "TERM",
+                                    "LANG", "LC_*", "TZ", "TMPDIR", "PWD"};
+#define ENV_DEFAULTS (int)(sizeof(env_default) / sizeof(env_default[0]))
 
-  return 0;
+static int env_match(const char *var, const char *pattern) {
+  size_t len = strlen(pattern);
+  if (len && pattern[len - 1] == '*') return strncmp(var, pattern, len - 1) == 0;
+  return strncmp(var, pattern, len) == 0 && var[len] == '=';
+}
+
+// The entries of environ that match the default list or a kept name;
+// points into environ, no copies
+static char **filter_env(const char **keep, int nkeep) {
+  int n = 0;
+  while (environ[n]) n++;
+  char **envp = calloc((size_t)n + 1, sizeof(char *));
+  if (!envp) return NULL;
+  int out = 0;
+  for (int i = 0; i < n; i++) {
+    int pass = 0;
+    for (int k = 0; k < ENV_DEFAULTS && !pass; k++) pass = env_match(environ[i], env_default[k]);
+    for (int k = 0; k < nkeep && !pass; k++) pass = env_match(environ[i], keep[k]);
+    if (pass) envp[out++] = environ[i];
+  }
+  return envp;
 }
 
 int main(int argc, char *argv[]) {
-  char strings[8][100] = {0};
-  int s_index = 0;
-  // Loop through command line arguments and add them to the strings array before + sign
-  for (int i = 1; i < argc; i++) {
-    if (strcmp(argv[i], "+") == 0) {
-      if (s_index == 0) {
-        strcpy(strings[0], "/bin/true");
-        s_index = 1;
-      }
-      execute(strings, s_index);
-      memset(strings, 0, sizeof(strings));
-      s_index = 0;
+  RunOptions opt = {SPAWN_VFORK, 0, 0, 2.0, NULL, NULL, 0}; // vfork: see --bench-spawn
+  const char *summary = NULL, *list = NULL, *dag_file = NULL;
+  int fail_fast = 0, repeat = 0, warmup = 0, json = 0;
+  const char **keep = calloc((size_t)argc, sizeof(char *));
+  int nkeep = 0, pass_env = 0;
+  int first = 1;
+  for (; first < argc && argv[first][0] == '-'; first++) {
+    if (strcmp(argv[first], "--env") == 0) {
+      pass_env = 1;
+      continue;
+    }
+    if (strcmp(argv[first], "--env-keep") == 0 && first + 1 < argc) {
+      pass_env = 1;
+      keep[nkeep++] = argv[++first];
+      continue;
+    }
+    if (strcmp(argv[first], "-j") == 0 && first + 1 < argc && atoi(argv[first + 1]) >= 1) {
+      opt.max_jobs = atoi(argv[++first]);
+    } else if (strcmp(argv[first], "--timeout") == 0 && first + 1 < argc && atof(argv[first + 1]) > 0) {
+      opt.timeout = atof(argv[++first]);
+    } else if (strcmp(argv[first], "--kill-after") == 0 && first + 1 < argc && atof(argv[first + 1]) >= 0) {
+      opt.kill_after = atof(argv[++first]);
+    } else if (strcmp(argv[first], "-f") == 0 && first + 1 < argc) {
+      list = argv[++first];
+    } else if (strcmp(argv[first], "--dag") == 0 && first + 1 < argc) {
+      dag_file = argv[++first];
+    } else if (strcmp(argv[first], "--fail-fast") == 0) {
+      fail_fast = 1;
+    } else if (strcmp(argv[first], "--repeat") == 0 && first + 1 < argc && atoi(argv[first + 1]) >= 1) {
+      repeat = atoi(argv[++first]);
+    } else if (strcmp(argv[first], "--warmup") == 0 && first + 1 < argc && atoi(argv[first + 1]) >= 0) {
+      warmup = atoi(argv[++first]);
+    } else if (strcmp(argv[first], "--json") == 0) {
+      json = 1;
+    } else if (strcmp(argv[first], "--summary") == 0 && first + 1 < argc) {
+      summary = argv[++first];
+    } else if (strcmp(argv[first], "--spawn") == 0 && first + 1 < argc &&
+               spawn_backend_parse(argv[first + 1], &opt.backend) == 0) {
+      first++;
+    } else if (strcmp(argv[first], "--bench-spawn") == 0 && first + 1 < argc && atoi(argv[first + 1]) >= 1) {
+      return bench_spawn(atoi(argv[first + 1]), first + 2 < argc ? atoi(argv[first + 2]) : 0);
     } else {
-      if (s_index < 8) {
-        strcpy(strings[s_index], argv[i]);
-        s_index++;
-      }
+      usage();
+      return 2;
     }
   }
-  
-  // For any remaining arguments after the last '+'
-  if (s_index > 0) {
-    execute(strings, s_index);
+
+  if (pass_env) opt.envp = filter_env(keep, nkeep);
+  free(keep);
+
+  // A redirection needs its file; anything else is checked as it runs
+  if ((list && dag_file) || (repeat && dag_file)) {
+    usage();
+    return 2;
+  }
+  if (dag_file) list = dag_file;
+  if ((list && first < argc) || (first < argc && (strcmp(argv[argc - 1], "<") == 0 ||
+                                                  strcmp(argv[argc - 1], ">") == 0 ||
+                                                  strcmp(argv[argc - 1], ">>") == 0))) {
+    usage();
+    return 2;
+  }
+
+  ArgvList args = {argv, first, argc};
+  FileList lines = {0};
+  CommandSource src = {argv_next, NULL, &args};
+  Dag *dag = NULL;
+  if (list) {
+    lines.name = strcmp(list, "-") == 0 ? "stdin" : list;
+    lines.fp = strcmp(list, "-") == 0 ? stdin : fopen(list, "r");
+    if (!lines.fp) {
+      perror(list);
+      return 2;
+    }
+    src = (CommandSource){file_next, NULL, &lines};
+  }
+  if (dag_file) {
+    // The whole graph is needed up front
+    if (!(dag = dag_load(lines.fp, lines.name, fail_fast))) return 2;
+    src = (CommandSource){dag_next, dag_done, dag};
+  }
+  if (summary) {
+    opt.summary = strcmp(summary, "-") == 0 ? stderr : fopen(summary, "w");
+    if (!opt.summary) {
+      perror(summary);
+      return 2;
+    }
   }
 
-  return 0;
+  // Exit status: the number of commands that failed (capped at 125)
+  int failures = repeat ? bench_repeat(&opt, &src, repeat, warmup, json) : run_commands(&opt, &src);
+  if (opt.summary && opt.summary != stderr) fclose(opt.summary);
+  if (lines.fp && lines.fp != stdin) fclose(lines.fp);
+  free(lines.buf);
+  dag_free(dag);
+  free(opt.envp);
+  path_cache_free();
+  return failures > 125 ? 125 : failures;
 }
@@ -0,0 +1,140 @@
+#define _GNU_SOURCE
+#include "launcher.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define CLONE_STACK (64 * 1024)
+
+static const char *names[SPAWN_BACKENDS] = {"fork", "vfork", "posix_spawn", "clone"};
+
+// What the child needs; lives on the parent's stack, which vfork and
+// clone(CLONE_VM) children share. A child whose execve fails leaves the
+// errno in `err` (shared memory) or writes it to `report` (plain fork, a
+// close-on-exec pipe), as glibc's posix_spawn does.
+typedef struct Launch {
+  const char *path;
+  char *const *argv;
+  char *const *envp;
+  const int *fds;
+  int report;
+  volatile int err;
+} Launch;
+
+const char *spawn_backend_name(SpawnBackend b) {
+  return b < SPAWN_BACKENDS ? names[b] : "?";
+}
+
+int spawn_backend_parse(const char *name, SpawnBackend *b) {
+  for (int i = 0; i < SPAWN_BACKENDS; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      *b = (SpawnBackend)i;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+// Runs in the child. Only async-signal-safe calls: with vfork and clone
+// the child borrows the parent's memory until execve. The parent reports
+// a failed execve.
+static int child_exec(void *arg) {
+  Launch *l = arg;
+  for (int k = 0; k < 3; k++) {
+    if (l->fds[k] >= 0 && l->fds[k] != k) dup2(l->fds[k], k);
+  }
+  execve(l->path, l->argv, l->envp);
+  int err = errno;
+  l->err = err;
+  if (l->report >= 0) write(l->report, &err, sizeof(err));
+  _exit(127);
+}
+
+// Every backend ends up here when the program could not be started
+static pid_t launch_failed(int err) {
+  fprintf(stderr, "execve failed: %s\n", strerror(err));
+  return -1;
+}
+
+// The child has exec'd or exited by now (vfork semantics, or the fork
+// pipe was read); reap it if execve failed
+static pid_t launch_result(const Launch *l, pid_t pid) {
+  if (pid <= 0 || !l->err) return pid;
+  waitpid(pid, NULL, 0);
+  return launch_failed(l->err);
+}
+
+static pid_t spawn_fork(Launch *l) {
+  int p[2];
+  if (pipe2(p, O_CLOEXEC) != 0) return -1;
+  l->report = p[1];
+  pid_t pid = fork();
+  if (pid == 0) child_exec(l);
+  close(p[1]);
+  l->report = -1;
+  // EOF once the child has exec'd (the pipe closes) or exited
+  int err = 0;
+  ssize_t n;
+  if (pid > 0) {
+    while ((n = read(p[0], &err, sizeof(err))) < 0 && errno == EINTR) {}
+    if (n == (ssize_t)sizeof(err)) l->err = err;
+  }
+  close(p[0]);
+  return pid;
+}
+
+static pid_t spawn_posix(const Launch *l) {
+  posix_spawn_file_actions_t fa;
+  posix_spawn_file_actions_init(&fa);
+  for (int k = 0; k < 3; k++) {
+    if (l->fds[k] >= 0 && l->fds[k] != k) posix_spawn_file_actions_adddup2(&fa, l->fds[k], k);
+  }
+  pid_t pid;
+  int rc = posix_spawn(&pid, l->path, &fa, NULL, l->argv, l->envp);
+  posix_spawn_file_actions_destroy(&fa);
+  if (rc != 0) return launch_failed(rc);
+  return pid;
+}
+
+static pid_t spawn_clone(Launch *l) {
+  // The parent is suspended until the child execs or exits, so one stack
+  // serves every call
+  static char *stack = NULL;
+  if (!stack && !(stack = malloc(CLONE_STACK))) return -1;
+  return clone(child_exec, stack + CLONE_STACK, CLONE_VM | CLONE_VFORK | SIGCHLD, (void *)l);
+}
+
+pid_t spawn_command(SpawnBackend b, const char *path, char *const argv[], char *const envp[], const int fds[3]) {
+  static const int inherit[3] = {-1, -1, -1};
+  Launch l = {path, argv, envp, fds ? fds : inherit, -1, 0};
+  pid_t pid = -1;
+  switch (b) {
+  case SPAWN_FORK:
+    pid = spawn_fork(&l);
+    break;
+  case SPAWN_VFORK:
+    pid = vfork();
+    if (pid == 0) child_exec(&l);
+    break;
+  case SPAWN_POSIX_SPAWN:
+    return spawn_posix(&l);
+  case SPAWN_CLONE:
+    pid = spawn_clone(&l);
+    break;
+  default:
+    errno = EINVAL;
+    break;
+  }
+  if (pid < 0) {
+    perror("fork failed");
+    return -1;
+  }
+  return launch_result(&l, pid);
+}
@@ -0,0 +1,29 @@
+#ifndef LAUNCHER_H
+#define LAUNCHER_H
+
+#include <sys/types.h>
+
+// Ways to start a child that execs a program. fork copies the parent's
+// page tables, so its cost grows with the parent's address space; the
+// others share the parent's memory until the child has exec'd.
+typedef enum {
+  SPAWN_FORK,
+  SPAWN_VFORK,
+  SPAWN_POSIX_SPAWN,
+  SPAWN_CLONE,       // clone(CLONE_VM | CLONE_VFORK)
+  SPAWN_BACKENDS
+} SpawnBackend;
+
+const char *spawn_backend_name(SpawnBackend b);
+
+// 0 and *b set if name is a backend name, else -1
+int spawn_backend_parse(const char *name, SpawnBackend *b);
+
+// Start the program at `path` with argv/envp. fds[0..2] become the child's stdin,
+// stdout and stderr (-1 = inherit). Returns the pid, or -1 if no child
+// could be started. A failed execve counts as not started with every
+// backend: the error is reported on this process's stderr and the child,
+// if there was one, is reaped.
+pid_t spawn_command(SpawnBackend b, const char *path, char *const argv[], char *const envp[], const int fds[3]);
+
+#endif // LAUNCHER_H
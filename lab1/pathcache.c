@@ -0,0 +1,142 @@
+#include "pathcache.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+
+typedef struct Entry {
+  char *name;
+  char *path;             // NULL: not found
+  unsigned long epoch;    // dirs_epoch when resolved
+} Entry;
+
+typedef struct Dir {
+  char *path;
+  struct timespec mtime;
+} Dir;
+
+static Dir *dirs = NULL;
+static int ndirs = -1;            // -1 until PATH is parsed
+static unsigned long dirs_epoch = 0;
+static uint64_t checked_ns = 0;
+
+static Entry *slots = NULL;
+static size_t nslots = 0, used = 0;
+
+// --- helpers ---
+static uint32_t hash_name(const char *s) {
+  uint32_t h = 2166136261u; // FNV-1a
+  for (; *s; s++) {
+    h ^= (unsigned char)*s;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static struct timespec dir_mtime(const char *path) {
+  struct stat st;
+  if (stat(path, &st) < 0) return (struct timespec){0, 0};
+  return st.st_mtim;
+}
+
+static void parse_path(void) {
+  const char *env = getenv("PATH");
+  char *copy = strdup(env && *env ? env : "/usr/local/bin:/usr/bin:/bin");
+  if (!copy) return;
+  ndirs = 0;
+  // strsep keeps empty entries ("a::b", a leading or trailing ':'), which
+  // execvp takes as the current directory
+  for (char *rest = copy, *d; (d = strsep(&rest, ":")) != NULL;) {
+    Dir *grown = realloc(dirs, (size_t)(ndirs + 1) * sizeof(Dir));
+    if (!grown) break;
+    dirs = grown;
+    dirs[ndirs].path = strdup(*d ? d : ".");
+    if (!dirs[ndirs].path) break;
+    dirs[ndirs].mtime = dir_mtime(dirs[ndirs].path);
+    ndirs++;
+  }
+  free(copy);
+  checked_ns = bench_now_ns();
+}
+
+// Bump dirs_epoch if any directory changed since the last look
+static void recheck_dirs(void) {
+  uint64_t now = bench_now_ns();
+  if (now - checked_ns < (uint64_t)PATH_RECHECK_MS * 1000000) return;
+  checked_ns = now;
+  for (int i = 0; i < ndirs; i++) {
+    struct timespec m = dir_mtime(dirs[i].path);
+    if (m.tv_sec != dirs[i].mtime.tv_sec || m.tv_nsec != dirs[i].mtime.tv_nsec) {
+      dirs[i].mtime = m;
+      dirs_epoch++;
+    }
+  }
+}
+
+static char *probe(const char *name) {
+  char buf[4096];
+  for (int i = 0; i < ndirs; i++) {
+    struct stat st;
+    int len = snprintf(buf, sizeof(buf), "%s/%s", dirs[i].path, name);
+    if (len < 0 || (size_t)len >= sizeof(buf)) continue;
+    if (stat(buf, &st) == 0 && S_ISREG(st.st_mode) && access(buf, X_OK) == 0) return strdup(buf);
+  }
+  return NULL;
+}
+
+// Keeps the load factor at most 1/2
+static int rehash(void) {
+  size_t n = nslots ? nslots * 2 : 64;
+  Entry *fresh = calloc(n, sizeof(Entry));
+  if (!fresh) return -1;
+  for (size_t i = 0; i < nslots; i++) {
+    if (!slots[i].name) continue;
+    size_t j = hash_name(slots[i].name) & (n - 1);
+    while (fresh[j].name) j = (j + 1) & (n - 1);
+    fresh[j] = slots[i];
+  }
+  free(slots);
+  slots = fresh;
+  nslots = n;
+  return 0;
+}
+
+// === Public ===
+const char *path_resolve(const char *name) {
+  if (ndirs < 0) parse_path();
+  recheck_dirs();
+  if ((used + 1) * 2 > nslots && rehash() < 0) return NULL;
+
+  size_t i = hash_name(name) & (nslots - 1);
+  for (; slots[i].name; i = (i + 1) & (nslots - 1)) {
+    if (strcmp(slots[i].name, name) != 0) continue;
+    if (slots[i].epoch != dirs_epoch) {
+      free(slots[i].path); // a PATH directory changed: probe again
+      slots[i].path = probe(name);
+      slots[i].epoch = dirs_epoch;
+    }
+    return slots[i].path;
+  }
+  char *key = strdup(name);
+  if (!key) return NULL;
+  slots[i] = (Entry){key, probe(name), dirs_epoch};
+  used++;
+  return slots[i].path;
+}
+
+void path_cache_free(void) {
+  for (size_t i = 0; i < nslots; i++) {
+    free(slots[i].name);
+    free(slots[i].path);
+  }
+  free(slots);
+  slots = NULL;
+  nslots = used = 0;
+  for (int i = 0; i < ndirs; i++) free(dirs[i].path);
+  free(dirs);
+  dirs = NULL;
+  ndirs = -1;
+}
@@ -0,0 +1,19 @@
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+// Bare command names resolved against PATH, the way execvp would, but
+// remembered: a repeated name costs a hash lookup instead of probing
+// every PATH directory. An entry is dropped once any PATH directory's
+// mtime changes (something was added, removed or renamed there), and
+// the directories are re-checked at most every PATH_RECHECK_MS. An empty
+// PATH entry means the current directory, as for execvp.
+
+#define PATH_RECHECK_MS 1000
+
+// Full path of an executable named `name` (which contains no '/'), or
+// NULL if PATH has none. The string stays valid until the next call.
+const char *path_resolve(const char *name);
+
+void path_cache_free(void);
+
+#endif // PATHCACHE_H
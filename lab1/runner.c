@@ -0,0 +1,431 @@
+#define _GNU_SOURCE
+#include "runner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "pathcache.h"
+
+#define RELAY_CHUNK (1 << 20)
+// Commands held at once per -j slot: running, or finished and waiting
+// for an earlier one to print
+#define WINDOW_PER_JOB 4
+
+// A command being supervised. Jobs live in a ring of slots; a slot's
+// arrays and arena are kept for the next command it runs.
+typedef struct Job {
+  Command cmd;
+  Arena arena;
+  int index;         // position in the source, for the summary
+  int stage_cap;     // room in pids / pidfds
+  pid_t *pids;       // one per stage, -1 if it never started
+  int *pidfds;       // -1 once that stage is reaped
+  int live;          // stages not reaped yet
+  int fds[2];        // read ends for captured stdout, stderr; -1 once at EOF
+  int held[2];       // memfds holding output while an earlier job still prints
+  uint64_t started;
+  uint64_t deadline; // next timeout step, 0 = none
+  int signalled;     // last signal sent on timeout
+  int done;
+  RunResult r;
+} Job;
+
+// Cleared once splice is refused for stdout / stderr (a tty, an
+// O_APPEND file); read/write is used from then on
+static int splice_out[2] = {1, 1};
+
+// --- helpers ---
+// Write all of buf, retrying short writes
+static void write_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) return;
+    buf += n;
+    len -= (size_t)n;
+  }
+}
+
+int run_succeeded(const RunResult *r) {
+  return WIFEXITED(r->status) && WEXITSTATUS(r->status) == 0;
+}
+
+// Move what is available on pipe `from` to `to`. splice keeps the data
+// in the kernel; *can_splice is cleared if `to` does not take it.
+// Returns bytes moved, 0 at EOF, -1 on error.
+static ssize_t relay(int from, int to, int *can_splice) {
+  if (*can_splice) {
+    ssize_t n = splice(from, NULL, to, NULL, RELAY_CHUNK, SPLICE_F_MOVE);
+    if (n >= 0 || errno != EINVAL) return n;
+    *can_splice = 0;
+  }
+  char buf[65536];
+  ssize_t n = read(from, buf, sizeof(buf));
+  if (n > 0) write_all(to, buf, (size_t)n);
+  return n;
+}
+
+// Copy all of a memfd to `to`: sendfile, or read/write where the
+// destination refuses it
+static void copy_held(int fd, int to) {
+  off_t size = lseek(fd, 0, SEEK_CUR), off = 0;
+  while (off < size) {
+    ssize_t n = sendfile(to, fd, &off, (size_t)(size - off));
+    if (n > 0) continue;
+    if (n < 0 && errno == EINTR) continue;
+    break;
+  }
+  char buf[65536];
+  while (off < size) {
+    ssize_t n = pread(fd, buf, sizeof(buf), off);
+    if (n <= 0) break;
+    write_all(to, buf, (size_t)n);
+    off += n;
+  }
+}
+
+// Start every stage of cmd, joined by pipes. The last stage's stdout and
+// every stage's stderr go to out_fd / err_fd (-1 = inherit), unless a
+// redirection says otherwise. pids[i] is -1 for a stage that did not
+// start. Returns 0 if all of them did.
+static int launch(const RunOptions *opt, Command *cmd, int out_fd, int err_fd, pid_t *pids) {
+  int rc = 0, in = -1; // read end of the pipe from the previous stage
+  for (int i = 0; i < cmd->nstages; i++) {
+    Stage *st = &cmd->stages[i];
+    int last = i + 1 == cmd->nstages;
+    int p[2] = {-1, -1};
+    pids[i] = -1;
+    if (!last && pipe2(p, O_CLOEXEC) < 0) {
+      perror("pipe failed");
+      for (; i < cmd->nstages; i++) pids[i] = -1;
+      rc = -1;
+      break;
+    }
+
+    int fds[3] = {in, last ? out_fd : p[1], err_fd};
+    int opened[2] = {-1, -1};
+    const char *bad = NULL;
+    if (st->in_path && (opened[0] = fds[0] = open(st->in_path, O_RDONLY | O_CLOEXEC)) < 0) bad = st->in_path;
+    if (!bad && st->out_path) {
+      int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (st->append ? O_APPEND : O_TRUNC);
+      if ((opened[1] = fds[1] = open(st->out_path, flags, 0644)) < 0) bad = st->out_path;
+    }
+    const char *program = st->argv[0];
+    if (!bad && !strchr(program, '/') && !(program = path_resolve(program))) {
+      fprintf(stderr, "lab1p1: %s: command not found\n", st->argv[0]);
+    } else if (bad) {
+      fprintf(stderr, "lab1p1: %s: %s\n", bad, strerror(errno));
+    } else {
+      pids[i] = spawn_command(opt->backend, program, st->argv, opt->envp, fds);
+    }
+    if (pids[i] < 0) rc = -1;
+
+    for (int k = 0; k < 2; k++) {
+      if (opened[k] >= 0) close(opened[k]);
+    }
+    if (in >= 0) close(in);
+    if (p[1] >= 0) close(p[1]);
+    in = p[0];
+  }
+  if (in >= 0) close(in);
+  return rc;
+}
+
+// === Supervisor ===
+// Every child is watched through a pidfd in one epoll set, next to the
+// pipes carrying captured output. Up to max_jobs commands run at once
+// (one, with output inherited, when max_jobs is 0). Captured output is
+// kept in command order: the earliest unfinished job (the head) prints as
+// its output arrives, later jobs are held in memfds until every job
+// before them has finished. Either way the bytes go pipe -> destination
+// with splice.
+//
+// epoll tags: slot in the high half, then 0/1 for the stdout/stderr
+// pipe or 2 + stage for a pidfd.
+#define TAG(job, what) ((uint64_t)(job) << 32 | (uint32_t)(what))
+
+static int pidfd_open(pid_t pid) {
+  return (int)syscall(SYS_pidfd_open, pid, 0);
+}
+
+static int pidfd_signal(int pidfd, int sig) {
+  return (int)syscall(SYS_pidfd_send_signal, pidfd, sig, NULL, 0);
+}
+
+static void watch(int epfd, int fd, uint64_t tag) {
+  struct epoll_event ev = {.events = EPOLLIN, .data.u64 = tag};
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    perror("epoll_ctl failed");
+    exit(1);
+  }
+}
+
+static uint64_t seconds_ns(double s) {
+  return (uint64_t)(s * 1e9);
+}
+
+// Start the command already in slot `slot`. sink is /dev/null when output
+// is discarded, else -1.
+static void start_job(const RunOptions *opt, int epfd, Job *ring, int slot, int index, int sink) {
+  Job *job = &ring[slot];
+  Command *cmd = &job->cmd;
+  int capture = opt->max_jobs > 0 && sink < 0;
+  int out[2] = {-1, -1}, err[2] = {-1, -1};
+  if (cmd->nstages > job->stage_cap) {
+    job->stage_cap = cmd->nstages;
+    job->pids = realloc(job->pids, (size_t)cmd->nstages * sizeof(pid_t));
+    job->pidfds = realloc(job->pidfds, (size_t)cmd->nstages * sizeof(int));
+    if (!job->pids || !job->pidfds) {
+      fprintf(stderr, "lab1p1: out of memory\n");
+      exit(1);
+    }
+  }
+  job->index = index;
+  job->live = job->signalled = job->done = 0;
+  job->deadline = 0;
+  memset(&job->r, 0, sizeof(job->r));
+  job->fds[0] = job->fds[1] = job->held[0] = job->held[1] = -1;
+  job->r.status = 1 << 8; // exit status 1 unless the last stage reports
+  job->started = bench_now_ns();
+  if (capture && (pipe2(out, O_CLOEXEC) < 0 || pipe2(err, O_CLOEXEC) < 0)) {
+    perror("lab1p1: cannot start job");
+    for (int k = 0; k < 2; k++) {
+      if (out[k] >= 0) close(out[k]);
+      if (err[k] >= 0) close(err[k]);
+    }
+    for (int s = 0; s < cmd->nstages; s++) job->pids[s] = job->pidfds[s] = -1;
+    return;
+  }
+
+  launch(opt, cmd, capture ? out[1] : sink, capture ? err[1] : sink, job->pids);
+  if (capture) {
+    close(out[1]);
+    close(err[1]);
+    job->fds[0] = out[0];
+    job->fds[1] = err[0];
+    watch(epfd, out[0], TAG(slot, 0));
+    watch(epfd, err[0], TAG(slot, 1));
+  }
+  for (int s = 0; s < cmd->nstages; s++) {
+    job->pidfds[s] = -1;
+    if (job->pids[s] < 0) continue;
+    if ((job->pidfds[s] = pidfd_open(job->pids[s])) < 0) {
+      perror("pidfd_open failed");
+      exit(1);
+    }
+    watch(epfd, job->pidfds[s], TAG(slot, 2 + s));
+    job->live++;
+  }
+  if (opt->timeout > 0) job->deadline = job->started + seconds_ns(opt->timeout);
+}
+
+// Move what is available on one of job's pipes
+static void drain(Job *job, int k, int is_head) {
+  int always = 1;
+  ssize_t n;
+  if (is_head) {
+    n = relay(job->fds[k], k == 0 ? STDOUT_FILENO : STDERR_FILENO, &splice_out[k]);
+  } else {
+    if (job->held[k] < 0 && (job->held[k] = memfd_create("lab1p1-held", MFD_CLOEXEC)) < 0) {
+      perror("memfd_create failed");
+      exit(1);
+    }
+    n = relay(job->fds[k], job->held[k], &always);
+  }
+  if (n < 0 && (errno == EINTR || errno == EAGAIN)) return;
+  if (n <= 0) {
+    close(job->fds[k]);
+    job->fds[k] = -1;
+  }
+}
+
+// A stage's pidfd is readable: it has exited
+static void reap_stage(Job *job, int s, int last) {
+  int status;
+  struct rusage ru;
+  pid_t pid = wait4(job->pids[s], &status, WNOHANG, &ru);
+  if (pid <= 0) return;
+  RunResult *r = &job->r;
+  r->user_us += (uint64_t)ru.ru_utime.tv_sec * 1000000 + (uint64_t)ru.ru_utime.tv_usec;
+  r->sys_us += (uint64_t)ru.ru_stime.tv_sec * 1000000 + (uint64_t)ru.ru_stime.tv_usec;
+  if (ru.ru_maxrss > r->max_rss_kb) r->max_rss_kb = ru.ru_maxrss;
+  r->nvcsw += ru.ru_nvcsw;
+  r->nivcsw += ru.ru_nivcsw;
+  r->minflt += ru.ru_minflt;
+  r->majflt += ru.ru_majflt;
+  if (last) r->status = status;
+  close(job->pidfds[s]);
+  job->pidfds[s] = -1;
+  job->live--;
+}
+
+// Past its deadline: SIGTERM every live stage, then SIGKILL after
+// kill_after. Once no stage is left, a pipe still open belongs to an
+// orphaned grandchild and is closed.
+static void enforce(const RunOptions *opt, Job *job, uint64_t now) {
+  if (job->done || !job->deadline || now < job->deadline) return;
+  job->r.timed_out = 1;
+  if (job->live == 0) {
+    for (int k = 0; k < 2; k++) {
+      if (job->fds[k] >= 0) close(job->fds[k]);
+      job->fds[k] = -1;
+    }
+    job->deadline = 0;
+    return;
+  }
+  int sig = job->signalled ? SIGKILL : SIGTERM;
+  for (int s = 0; s < job->cmd.nstages; s++) {
+    if (job->pidfds[s] >= 0) pidfd_signal(job->pidfds[s], sig);
+  }
+  job->signalled = sig;
+  job->deadline = now + seconds_ns(opt->kill_after);
+}
+
+static void release_held(Job *job) {
+  for (int k = 0; k < 2; k++) {
+    if (job->held[k] < 0) continue;
+    copy_held(job->held[k], k == 0 ? STDOUT_FILENO : STDERR_FILENO);
+    close(job->held[k]);
+    job->held[k] = -1;
+  }
+}
+
+// epoll_wait timeout until the nearest deadline, -1 if none
+static int wait_ms(const Job *ring, int window, int from, int to, uint64_t now) {
+  uint64_t first = 0;
+  for (int i = from; i < to; i++) {
+    const Job *job = &ring[i % window];
+    if (!job->done && job->deadline && (!first || job->deadline < first)) first = job->deadline;
+  }
+  if (!first) return -1;
+  return first <= now ? 0 : (int)((first - now + 999999) / 1000000);
+}
+
+void run_json_string(FILE *fp, const char *s) {
+  fputc('"', fp);
+  for (; *s; s++) {
+    unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\') fprintf(fp, "\\%c", c);
+    else if (c < 0x20) fprintf(fp, "\\u%04x", c);
+    else fputc(c, fp);
+  }
+  fputc('"', fp);
+}
+
+// One JSON object per line and command, for scripts
+static void write_summary(FILE *fp, const Job *job) {
+  const RunResult *r = &job->r;
+  int code = WIFEXITED(r->status) ? WEXITSTATUS(r->status) : -1;
+  int sig = WIFSIGNALED(r->status) ? WTERMSIG(r->status) : 0;
+  fprintf(fp, "{\"index\":%d,", job->index);
+  if (job->cmd.name) {
+    fputs("\"step\":", fp);
+    run_json_string(fp, job->cmd.name);
+    fputc(',', fp);
+  }
+  fputs("\"command\":", fp);
+  run_json_string(fp, job->cmd.stages[0].argv[0]);
+  fprintf(fp, ",\"stages\":%d,\"exit\":%d,\"signal\":%d,\"timed_out\":%s,\"wall_ms\":%.3f,"
+              "\"user_ms\":%.3f,\"sys_ms\":%.3f,\"max_rss_kb\":%ld,\"nvcsw\":%ld,\"nivcsw\":%ld,"
+              "\"minflt\":%ld,\"majflt\":%ld}\n",
+          job->cmd.nstages, code, sig, r->timed_out ? "true" : "false", r->wall_ns / 1e6,
+          r->user_us / 1e3, r->sys_us / 1e3, r->max_rss_kb, r->nvcsw, r->nivcsw, r->minflt, r->majflt);
+}
+
+// === Public ===
+// Jobs next - head (at most `window`) sit in ring[i % window]: head is the
+// earliest that has not retired, next the first not started.
+int run_commands(const RunOptions *opt, CommandSource *src) {
+  int limit = opt->max_jobs > 0 ? opt->max_jobs : 1;
+  int window = opt->max_jobs > 0 ? limit * WINDOW_PER_JOB : 1;
+  int epfd = epoll_create1(EPOLL_CLOEXEC);
+  Job *ring = calloc((size_t)window, sizeof(Job));
+  int sink = opt->discard_output ? open("/dev/null", O_WRONLY | O_CLOEXEC) : -1;
+  if (epfd < 0 || !ring || (opt->discard_output && sink < 0)) {
+    fprintf(stderr, "lab1p1: cannot set up the supervisor\n");
+    exit(1);
+  }
+  int next = 0, head = 0, running = 0, failures = 0, exhausted = 0, index = 0;
+  int blocked = 0; // the source said RUN_WAIT and nothing has finished since
+
+  for (;;) {
+    while (!exhausted && !blocked && running < limit && next - head < window) {
+      Job *job = &ring[next % window];
+      int got = src->next(src->ctx, &job->cmd, &job->arena);
+      if (got < 0) {
+        failures++;
+        continue;
+      }
+      if (got == RUN_WAIT) {
+        blocked = 1;
+        break;
+      }
+      if (got == 0) {
+        exhausted = 1;
+        break;
+      }
+      start_job(opt, epfd, ring, next % window, index++, sink);
+      running++;
+      next++;
+    }
+
+    // Finished once every stage is reaped and its output is drained
+    for (int i = head; i < next; i++) {
+      Job *job = &ring[i % window];
+      if (job->done || job->live || job->fds[0] >= 0 || job->fds[1] >= 0) continue;
+      job->done = 1;
+      job->r.wall_ns = bench_now_ns() - job->started;
+      running--;
+      if (src->done) src->done(src->ctx, &job->cmd, &job->r);
+      blocked = 0;
+    }
+    while (head < next && ring[head % window].done) {
+      Job *job = &ring[head % window];
+      release_held(job);
+      if (!run_succeeded(&job->r)) failures++;
+      if (opt->summary) write_summary(opt->summary, job);
+      head++;
+      if (head < next) release_held(&ring[head % window]); // it prints live from now on
+    }
+    if (exhausted && head == next) break;
+    if (!exhausted && !blocked && running < limit && next - head < window) continue;
+
+    struct epoll_event evs[64];
+    int nev = epoll_wait(epfd, evs, 64, wait_ms(ring, window, head, next, bench_now_ns()));
+    if (nev < 0 && errno != EINTR) {
+      perror("epoll_wait failed");
+      exit(1);
+    }
+    for (int e = 0; e < nev; e++) {
+      int slot = (int)(evs[e].data.u64 >> 32), what = (int)(uint32_t)evs[e].data.u64;
+      Job *job = &ring[slot];
+      if (what < 2) {
+        if (job->fds[what] >= 0) drain(job, what, slot == head % window);
+      } else if (job->pidfds[what - 2] >= 0) {
+        reap_stage(job, what - 2, what - 2 == job->cmd.nstages - 1);
+      }
+    }
+    uint64_t now = bench_now_ns();
+    for (int i = head; i < next; i++) enforce(opt, &ring[i % window], now);
+  }
+
+  for (int i = 0; i < window; i++) {
+    free(ring[i].pids);
+    free(ring[i].pidfds);
+    free(ring[i].arena.buf);
+  }
+  if (sink >= 0) close(sink);
+  close(epfd);
+  free(ring);
+  return failures;
+}
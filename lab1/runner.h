@@ -0,0 +1,80 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "launcher.h"
+
+// One program of a pipeline, with its redirections. A program name
+// without '/' is looked up in PATH (see pathcache.h).
+typedef struct Stage {
+  char **argv;           // NULL-terminated; points into the source's memory
+  int argc;
+  const char *in_path;   // < FILE
+  const char *out_path;  // > FILE or >> FILE
+  int append;
+} Stage;
+
+// One command: stages joined by '|'
+typedef struct Command {
+  Stage *stages;
+  int nstages;
+  int id;                // the source's own number for it
+  const char *name;      // step name in a DAG, else NULL
+} Command;
+
+// Scratch memory a source may build a command in. Each running command
+// has its own, reused for a later command once this one has retired.
+typedef struct Arena {
+  char *buf;
+  size_t cap;
+} Arena;
+
+// How one command ended. CPU time, context switches and page faults are
+// summed over its stages; max_rss_kb is the largest stage's.
+typedef struct RunResult {
+  int status;            // wait status of the last stage
+  int timed_out;
+  uint64_t wall_ns;
+  uint64_t user_us, sys_us;
+  long max_rss_kb;
+  long nvcsw, nivcsw;    // voluntary / involuntary context switches
+  long minflt, majflt;
+} RunResult;
+
+// Where commands come from (see joblist.h, dag.h, bench.h). next fills
+// *cmd and returns 1, returns 0 once there are no more, -1 for an entry
+// that will not run (already reported; it counts as a failure), or
+// RUN_WAIT when nothing can start until a running command finishes.
+// done (may be NULL) hears how each command went as soon as it has
+// finished.
+#define RUN_WAIT 2
+
+typedef struct CommandSource {
+  int (*next)(void *ctx, Command *cmd, Arena *arena);
+  void (*done)(void *ctx, const Command *cmd, const RunResult *r);
+  void *ctx;
+} CommandSource;
+
+typedef struct RunOptions {
+  SpawnBackend backend;
+  int max_jobs;          // 0 = one at a time, output inherited
+  double timeout;        // seconds of wall clock per command, 0 = none
+  double kill_after;     // seconds between SIGTERM and SIGKILL
+  char **envp;           // children's environment (NULL = empty)
+  FILE *summary;         // one JSON line per command as it finishes, NULL = none
+  int discard_output;    // children's stdout and stderr go to /dev/null
+} RunOptions;
+
+// Exited with status 0?
+int run_succeeded(const RunResult *r);
+
+// Run every command src yields; a pipeline succeeds if its last stage
+// does. Only a bounded window of commands is held at once, so src may
+// be arbitrarily long. Returns the number of commands that failed.
+int run_commands(const RunOptions *opt, CommandSource *src);
+
+// s as a JSON string, quoted and escaped
+void run_json_string(FILE *fp, const char *s);
+
+#endif // RUNNER_H
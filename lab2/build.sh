@@ -10,8 +10,10 @@ VFS_DIR="virtual-file-system"
 
 AUDIT_DIR="audit"
 
+STATS_DIR="stats"
+
 # Source files
-SRC_FILES="main.c $SRC_DIR/user.c $SRC_DIR/group.c $SRC_DIR/usermod.c $VFS_DIR/vfs.c $AUDIT_DIR/audit.c"
+SRC_FILES="main.c $SRC_DIR/user.c $SRC_DIR/group.c $SRC_DIR/usermod.c $SRC_DIR/ugstore.c $VFS_DIR/vfs.c $VFS_DIR/dirindex.c $VFS_DIR/reaper.c $VFS_DIR/outbuf.c $VFS_DIR/quota.c $VFS_DIR/inode.c $VFS_DIR/scan.c $VFS_DIR/loader.c $VFS_DIR/import.c $VFS_DIR/tar.c $VFS_DIR/store.c $VFS_DIR/glob.c $VFS_DIR/grep.c $VFS_DIR/workers.c $VFS_DIR/wordindex.c $AUDIT_DIR/audit.c $STATS_DIR/stats.c $STATS_DIR/metrics.c $STATS_DIR/periodic.c"
 
 # Delete previous binary if it exists
 if [ -f "$OUTPUT" ]; then
@@ -21,7 +23,7 @@ fi
 
 # Compile the sources
 echo "Building..."
-gcc -Wall -Wextra $SRC_FILES -o $OUTPUT
+gcc -Wall -Wextra $SRC_FILES -o $OUTPUT -pthread
 
 # Build result
 if [ $? -eq 0 ]; then
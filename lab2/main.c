@@ -7,6 +7,8 @@
 #include "user-group-management/usermod.h"
 #include "virtual-file-system/vfs.h"
 #include "audit/audit.h"
+#include "stats/stats.h"
+#include "stats/metrics.h"
 
 #define MAX_INPUT 256
 #define MAX_ARGS 10
@@ -17,6 +19,30 @@ int is_logged_in() {
     return strlen(current_user) > 0;
 }
 
+// Action/result of the command being dispatched, for the latency metrics
+static const char* cmd_action = NULL;
+static const char* cmd_result = NULL;
+
+// Remember how a command ended, for the metrics only (paths the baseline
+// never audited, such as "Please login first", stay out of audit.log)
+static void note_command(const char* action, const char* result) {
+    cmd_action = action;
+    cmd_result = result;
+}
+
+// Audit a command and remember how it ended
+static void audit_command(const char* user, const char* action, const char* target, const char* result) {
+    log_event(user, action, target, result);
+    note_command(action, result);
+}
+
+// Commands the baseline always audited as "success": audit.log keeps that
+// line, the metrics get the real outcome (rc from the *_vfs call)
+static void audit_legacy(const char* user, const char* action, const char* target, int rc) {
+    log_event(user, action, target, "success");
+    note_command(action, rc == 0 ? "success" : "failed");
+}
+
 int main() {
     char input[MAX_INPUT];
     char* args[MAX_ARGS];
@@ -38,61 +64,79 @@ int main() {
         }
         if (arg_count == 0) continue;
 
+        reload_poll(); // a finished background reload takes over here
+
+        uint64_t started = stats_now_ns();
+        cmd_action = NULL;
+
         // Exit
         if (strcmp(args[0], "exit") == 0) {
+            reload_cancel();
             save_vfs();
-            log_event(current_user, "exit", "-", "success");
+            audit_command(current_user, "exit", "-", "success");
             break;
         }
 
         // USER / GROUP MANAGEMENT
         else if (strcmp(args[0], "useradd") == 0 && arg_count == 2) {
             adduser(args[1]);
-            log_event(current_user, "useradd", args[1], "success");
+            audit_command(current_user, "useradd", args[1], "success");
         }
         else if (strcmp(args[0], "groupadd") == 0 && arg_count == 2) {
             addgroup(args[1]);
-            log_event(current_user, "groupadd", args[1], "success");
+            audit_command(current_user, "groupadd", args[1], "success");
         }
         else if (strcmp(args[0], "usermod") == 0 && arg_count == 5 &&
                  strcmp(args[1], "-a") == 0 && strcmp(args[2], "-G") == 0) {
-            if (!is_logged_in()) { printf("Please login first.\n"); continue; }
-            usermod_append_group(args[4], args[3]);
-            log_event(current_user, "usermod", args[4], "success");
+            if (!is_logged_in()) {
+                printf("Please login first.\n");
+                note_command("usermod", "failed_no_login");
+            } else {
+                usermod_append_group(args[4], args[3]);
+                audit_command(current_user, "usermod", args[4], "success");
+            }
         }
         else if (strcmp(args[0], "deluser") == 0 && arg_count == 2) {
-            if (!is_logged_in()) { printf("Please login first.\n"); continue; }
-            deluser(args[1]);
-            log_event(current_user, "deluser", args[1], "success");
+            if (!is_logged_in()) {
+                printf("Please login first.\n");
+                note_command("deluser", "failed_no_login");
+            } else {
+                deluser(args[1]);
+                audit_command(current_user, "deluser", args[1], "success");
+            }
         }
         else if (strcmp(args[0], "delgroup") == 0 && arg_count == 2) {
-            if (!is_logged_in()) { printf("Please login first.\n"); continue; }
-            delgroup(args[1]);
-            log_event(current_user, "delgroup", args[1], "success");
+            if (!is_logged_in()) {
+                printf("Please login first.\n");
+                note_command("delgroup", "failed_no_login");
+            } else {
+                delgroup(args[1]);
+                audit_command(current_user, "delgroup", args[1], "success");
+            }
         }
 
         // LOGIN / LOGOUT
         else if (strcmp(args[0], "login") == 0 && arg_count == 2) {
             if (is_logged_in()) {
                 printf("A user is already logged in as '%s'. Please logout first.\n", current_user);
-                log_event(current_user, "login", args[1], "failed_already_logged_in");
-            } else if (!user_value_exists("users.txt", args[1])) {
+                audit_command(current_user, "login", args[1], "failed_already_logged_in");
+            } else if (!user_present(args[1])) {
                 printf("Login failed: user '%s' does not exist.\n", args[1]);
-                log_event("(none)", "login", args[1], "failed_no_user");
+                audit_command("(none)", "login", args[1], "failed_no_user");
             } else {
                 strcpy(current_user, args[1]);
                 printf("Logged in as %s\n", current_user);
                 go_to_home_directory();
-                log_event(current_user, "login", args[1], "success");
+                audit_command(current_user, "login", args[1], "success");
             }
         }
         else if (strcmp(args[0], "logout") == 0) {
             if (!is_logged_in()) {
                 printf("No user is currently logged in.\n");
-                log_event("(none)", "logout", "-", "failed_no_login");
+                audit_command("(none)", "logout", "-", "failed_no_login");
             } else {
                 printf("User %s logged out.\n", current_user);
-                log_event(current_user, "logout", "-", "success");
+                audit_command(current_user, "logout", "-", "success");
                 current_user[0] = '\0';
                 cd_vfs("/");
             }
@@ -100,25 +144,43 @@ int main() {
 
         // VFS COMMANDS
         else if (strcmp(args[0], "mkdir") == 0 && arg_count == 2) {
-            mkdir_vfs(args[1]);
-            log_event(current_user, "mkdir", args[1], "success");
+            audit_legacy(current_user, "mkdir", args[1], mkdir_vfs(args[1]));
         }
         else if (strcmp(args[0], "touch") == 0 && arg_count == 2) {
-            touch_vfs(args[1]);
-            log_event(current_user, "touch", args[1], "success");
+            audit_legacy(current_user, "touch", args[1], touch_vfs(args[1]));
         }
         else if (strcmp(args[0], "ls") == 0) {
-            if (arg_count == 2 && strcmp(args[1], "-l") == 0) ls_l_vfs();
-            else ls_vfs();
-            log_event(current_user, "ls", "-", "success");
+            // ls [-l] [--limit N] [--after NAME] [PATTERN]
+            int long_fmt = 0, limit = 0, bad = 0;
+            const char* after = NULL;
+            const char* pattern = NULL;
+            for (int i = 1; i < arg_count; ++i) {
+                if (strcmp(args[i], "-l") == 0) long_fmt = 1;
+                else if (strcmp(args[i], "--limit") == 0 && i + 1 < arg_count) limit = atoi(args[++i]);
+                else if (strcmp(args[i], "--after") == 0 && i + 1 < arg_count) after = args[++i];
+                else if (args[i][0] != '-' && !pattern) pattern = args[i];
+                else bad = 1;
+            }
+            if (bad) {
+                printf("Usage: ls [-l] [--limit N] [--after NAME] [PATTERN]\n");
+                audit_command(current_user, "ls", "-", "failed");
+            } else {
+                if (long_fmt) ls_l_vfs(after, limit, pattern);
+                else ls_vfs(after, limit, pattern);
+                audit_command(current_user, "ls", pattern ? pattern : "-", "success");
+            }
+        }
+        else if (strcmp(args[0], "complete") == 0 && arg_count <= 2) {
+            complete_vfs(arg_count == 2 ? args[1] : "");
+            audit_command(current_user, "complete", arg_count == 2 ? args[1] : "-", "success");
         }
         else if (strcmp(args[0], "cd") == 0 && arg_count == 2) {
             cd_vfs(args[1]);
-            log_event(current_user, "cd", args[1], "success");
+            audit_command(current_user, "cd", args[1], "success");
         }
         else if (strcmp(args[0], "pwd") == 0) {
             pwd_vfs();
-            log_event(current_user, "pwd", "-", "success");
+            audit_command(current_user, "pwd", "-", "success");
         }
         else if (strcmp(args[0], "write") == 0 && arg_count >= 3) {
             char content[1024] = "";
@@ -126,32 +188,146 @@ int main() {
                 strcat(content, args[i]);
                 if (i != arg_count - 1) strcat(content, " ");
             }
-            write_vfs(args[1], content);
-            log_event(current_user, "write", args[1], "success");
+            audit_legacy(current_user, "write", args[1], write_vfs(args[1], content));
         }
         else if (strcmp(args[0], "rm") == 0 && arg_count == 2) {
-            rm_vfs(args[1]);
-            log_event(current_user, "rm", args[1], "success");
+            audit_legacy(current_user, "rm", args[1], rm_vfs(args[1]));
         }
         else if (strcmp(args[0], "rm") == 0 && arg_count == 3 && strcmp(args[1], "-r") == 0) {
-            rm_r_vfs(args[2]);
-            log_event(current_user, "rm -r", args[2], "success");
+            audit_legacy(current_user, "rm -r", args[2], rm_r_vfs(args[2]));
+        }
+        else if (strcmp(args[0], "ln") == 0 && arg_count == 3) {
+            int rc = ln_vfs(args[1], args[2]);
+            audit_command(current_user, "ln", args[2], rc == 0 ? "success" : "failed");
+        }
+        else if (strcmp(args[0], "import") == 0 && arg_count == 3) {
+            // import HOSTPATH VFSPATH -- copy a host directory tree in
+            if (!is_logged_in()) {
+                printf("Please login first.\n");
+                audit_command("(none)", "import", args[2], "failed_no_login");
+            } else {
+                int rc = import_vfs(args[1], args[2]);
+                audit_command(current_user, "import", args[2], rc == 0 ? "success" : "failed");
+            }
+        }
+        else if (strcmp(args[0], "export") == 0 && arg_count == 3) {
+            // export VFSPATH OUT.tar -- stream a subtree as a ustar archive
+            if (!is_logged_in()) {
+                printf("Please login first.\n");
+                audit_command("(none)", "export", args[1], "failed_no_login");
+            } else {
+                int rc = export_vfs(args[1], args[2]);
+                audit_command(current_user, "export", args[1], rc == 0 ? "success" : "failed");
+            }
+        }
+        else if (strcmp(args[0], "store") == 0 && arg_count <= 2) {
+            // store [on|off] -- content store status, or switch it
+            int rc = store_vfs(arg_count == 2 ? args[1] : NULL);
+            audit_command(current_user, "store", arg_count == 2 ? args[1] : "-", rc == 0 ? "success" : "failed");
         }
         else if (strcmp(args[0], "read") == 0 && arg_count == 2) {
             read_vfs(args[1]);
-            log_event(current_user, "read", args[1], "success");
+            audit_command(current_user, "read", args[1], "success");
         }
         else if (strcmp(args[0], "tree") == 0) {
             tree();
-            log_event(current_user, "tree", "-", "success");
+            audit_command(current_user, "tree", "-", "success");
         }
         else if (strcmp(args[0], "save") == 0) {
-            save_vfs();
-            log_event(current_user, "save", "-", "success");
+            int rc = save_vfs();
+            audit_command(current_user, "save", "-", rc == 0 ? "success" : "failed");
         }
         else if (strcmp(args[0], "load") == 0) {
-            load_vfs();
-            log_event(current_user, "load", "-", "success");
+            audit_legacy(current_user, "load", "-", load_vfs());
+        }
+        else if (strcmp(args[0], "reload") == 0) {
+            int rc = reload_vfs();
+            audit_command(current_user, "reload", "-", rc == 0 ? "success" : "failed");
+        }
+        else if (strcmp(args[0], "stats") == 0 && arg_count == 1) {
+            stats_report(stdout);
+            audit_command(current_user, "stats", "-", "success");
+        }
+        else if (strcmp(args[0], "stats") == 0 && arg_count >= 3 && strcmp(args[1], "dump") == 0) {
+            // stats dump <file> <seconds> | stats dump off
+            if (strcmp(args[2], "off") == 0) {
+                stats_dump_stop();
+                printf("Stats dump stopped.\n");
+                audit_command(current_user, "stats dump", "off", "success");
+            } else if (arg_count == 4 && atoi(args[3]) > 0 && stats_dump_start(args[2], atoi(args[3])) == 0) {
+                printf("Dumping stats to '%s' every %d s.\n", args[2], atoi(args[3]));
+                audit_command(current_user, "stats dump", args[2], "success");
+            } else {
+                printf("Usage: stats dump <file> <seconds> | stats dump off\n");
+                audit_command(current_user, "stats dump", args[2], "failed");
+            }
+        }
+        else if (strcmp(args[0], "metrics") == 0 && arg_count == 1) {
+            metrics_write_prometheus(stdout);
+            audit_command(current_user, "metrics", "-", "success");
+        }
+        else if (strcmp(args[0], "metrics") == 0 && arg_count >= 3 && strcmp(args[1], "dump") == 0) {
+            // metrics dump <file> <seconds> | metrics dump off
+            if (strcmp(args[2], "off") == 0) {
+                metrics_dump_stop();
+                printf("Metrics dump stopped.\n");
+                audit_command(current_user, "metrics dump", "off", "success");
+            } else if (arg_count == 4 && atoi(args[3]) > 0 && metrics_dump_start(args[2], atoi(args[3])) == 0) {
+                printf("Writing metrics to '%s' every %d s.\n", args[2], atoi(args[3]));
+                audit_command(current_user, "metrics dump", args[2], "success");
+            } else {
+                printf("Usage: metrics dump <file> <seconds> | metrics dump off\n");
+                audit_command(current_user, "metrics dump", args[2], "failed");
+            }
+        }
+        else if (strcmp(args[0], "scan") == 0 && arg_count >= 2) {
+            // scan world-writable | owner USER | readable USER [--bench]
+            int bench = strcmp(args[arg_count - 1], "--bench") == 0;
+            int n = arg_count - bench;
+            scan_vfs(args[1], n >= 3 ? args[2] : NULL, bench);
+            audit_command(current_user, "scan", args[1], "success");
+        }
+        else if (strcmp(args[0], "grep") == 0 && arg_count >= 2) {
+            // grep PATTERN [PATH] [--bench]
+            int bench = strcmp(args[arg_count - 1], "--bench") == 0;
+            int n = arg_count - bench;
+            if (n < 2 || n > 3) {
+                printf("Usage: grep <pattern> [path] [--bench]\n");
+                audit_command(current_user, "grep", "-", "failed");
+            } else {
+                grep_vfs(args[1], n == 3 ? args[2] : NULL, bench);
+                audit_command(current_user, "grep", args[1], "success");
+            }
+        }
+        else if (strcmp(args[0], "index") == 0 && arg_count <= 2) {
+            // index [on|off] -- word index status, or switch it
+            index_vfs(arg_count == 2 ? args[1] : NULL);
+            audit_command(current_user, "index", arg_count == 2 ? args[1] : "-", "success");
+        }
+        else if (strcmp(args[0], "search") == 0 && arg_count >= 2) {
+            // search WORD... -- files containing every word (needs the word index)
+            char query[MAX_INPUT] = "";
+            for (int i = 1; i < arg_count; ++i) {
+                strcat(query, args[i]);
+                if (i != arg_count - 1) strcat(query, " ");
+            }
+            search_vfs(query);
+            audit_command(current_user, "search", args[1], "success");
+        }
+        else if (strcmp(args[0], "du") == 0 && arg_count <= 2) {
+            du_vfs(arg_count == 2 ? args[1] : NULL);
+            audit_command(current_user, "du", arg_count == 2 ? args[1] : "-", "success");
+        }
+        else if (strcmp(args[0], "quota") == 0 && arg_count <= 2) {
+            // quota [USER] -- defaults to the logged-in user
+            const char* who = arg_count == 2 ? args[1] : current_user;
+            quota_vfs(*who ? who : "(none)");
+            audit_command(current_user, "quota", who, "success");
+        }
+        else if (strcmp(args[0], "quota") == 0 && arg_count == 5 && strcmp(args[1], "set") == 0) {
+            // quota set USER MAX_INODES MAX_BYTES (0 = unlimited)
+            quota_set_vfs(args[2], atoll(args[3]), atoll(args[4]));
+            audit_command(current_user, "quota set", args[2], "success");
         }
         else if (strcmp(args[0], "chown") == 0 && arg_count >= 3) {
             char new_owner[50] = "", new_group[50] = "";
@@ -165,17 +341,17 @@ int main() {
             } else {
                 strcpy(new_owner, args[1]);
             }
-            chown_vfs(new_owner, new_group, args[2]);
-            log_event(current_user, "chown", args[2], "success");
+            audit_legacy(current_user, "chown", args[2], chown_vfs(new_owner, new_group, args[2]));
         }
         else if (strcmp(args[0], "chmod") == 0 && arg_count == 3) {
-            chmod_vfs(args[1], args[2]);
-            log_event(current_user, "chmod", args[1], "success");
+            audit_legacy(current_user, "chmod", args[1], chmod_vfs(args[1], args[2]));
         }
         else {
             printf("Unknown command: %s\n", args[0]);
-            log_event(current_user, "unknown_command", args[0], "failed");
+            audit_command(current_user, "unknown_command", args[0], "failed");
         }
+
+        if (cmd_action) metrics_observe(cmd_action, cmd_result, stats_now_ns() - started);
     }
     return 0;
 }
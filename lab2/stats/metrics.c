@@ -0,0 +1,153 @@
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+#include "periodic.h"
+
+// One histogram per (command, result). Series are only created by the
+// command loop; the dump thread reads them through relaxed atomics.
+typedef struct Series {
+    char command[32];
+    char result[48];
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t buckets[HIST_BUCKETS];
+} Series;
+
+static Series* series[METRICS_MAX_SERIES];
+static int nseries = 0;
+
+// Exported "le" bounds in seconds (1-2.5-5 steps, 1us .. 100s)
+static const double export_bounds[] = {
+    1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4,
+    1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5,
+    1, 2.5, 5, 10, 25, 50, 100
+};
+
+// --- bucket math ---
+static int bucket_of(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)((v >> shift) & (HIST_SUB - 1));
+}
+
+static uint64_t bucket_lower(int b) {
+    if (b < HIST_SUB) return (uint64_t)b;
+    int shift = b / HIST_SUB - 1;
+    return (uint64_t)(HIST_SUB + b % HIST_SUB) << shift;
+}
+
+// Exclusive upper bound
+static uint64_t bucket_upper(int b) {
+    if (b < HIST_SUB) return (uint64_t)b + 1;
+    int shift = b / HIST_SUB - 1;
+    return bucket_lower(b) + ((uint64_t)1 << shift);
+}
+
+static uint64_t load(const uint64_t* p) {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static void bump(uint64_t* p, uint64_t delta) {
+    __atomic_store_n(p, *p + delta, __ATOMIC_RELAXED);
+}
+
+static Series* find_series(const char* command, const char* result, int create) {
+    int n = __atomic_load_n(&nseries, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; ++i) {
+        if (strcmp(series[i]->command, command) == 0 && strcmp(series[i]->result, result) == 0)
+            return series[i];
+    }
+    if (!create || n == METRICS_MAX_SERIES) return NULL;
+    Series* s = (Series*)calloc(1, sizeof(Series));
+    if (!s) return NULL;
+    snprintf(s->command, sizeof(s->command), "%s", command);
+    snprintf(s->result, sizeof(s->result), "%s", result);
+    series[n] = s;
+    __atomic_store_n(&nseries, n + 1, __ATOMIC_RELEASE);
+    return s;
+}
+
+// === Recording ===
+void metrics_observe(const char* command, const char* result, uint64_t ns) {
+    Series* s = find_series(command ? command : "(none)", result ? result : "(none)", 1);
+    if (!s) return;
+    bump(&s->buckets[bucket_of(ns)], 1);
+    bump(&s->sum_ns, ns);
+    bump(&s->count, 1);
+}
+
+uint64_t metrics_quantile(const char* command, const char* result, double q) {
+    Series* s = find_series(command, result, 0);
+    if (!s) return 0;
+    uint64_t total = load(&s->count);
+    if (!total) return 0;
+    uint64_t rank = (uint64_t)(q * (double)(total - 1)) + 1, seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; ++b) {
+        seen += load(&s->buckets[b]);
+        if (seen >= rank) return (bucket_lower(b) + bucket_upper(b) - 1) / 2;
+    }
+    return 0;
+}
+
+// === Prometheus exposition ===
+static void write_label(FILE* fp, const char* v) {
+    for (; *v; ++v) {
+        if (*v == '\\' || *v == '"') fputc('\\', fp);
+        if (*v == '\n') { fputs("\\n", fp); continue; }
+        fputc(*v, fp);
+    }
+}
+
+static void write_labels(FILE* fp, const Series* s) {
+    fputs("command=\"", fp);
+    write_label(fp, s->command);
+    fputs("\",result=\"", fp);
+    write_label(fp, s->result);
+    fputc('"', fp);
+}
+
+void metrics_write_prometheus(FILE* fp) {
+    fputs("# HELP vfs_command_duration_seconds Wall time of simulator commands.\n", fp);
+    fputs("# TYPE vfs_command_duration_seconds histogram\n", fp);
+    int n = __atomic_load_n(&nseries, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; ++i) {
+        const Series* s = series[i];
+        // Fold the fine buckets into the exported bounds: a bucket counts
+        // towards `le` once its whole range is <= le
+        uint64_t cumulative = 0;
+        int b = 0;
+        size_t nb = sizeof(export_bounds) / sizeof(export_bounds[0]);
+        for (size_t k = 0; k < nb; ++k) {
+            uint64_t le_ns = (uint64_t)(export_bounds[k] * 1e9 + 0.5);
+            while (b < HIST_BUCKETS && bucket_upper(b) - 1 <= le_ns) cumulative += load(&s->buckets[b++]);
+            fputs("vfs_command_duration_seconds_bucket{", fp);
+            write_labels(fp, s);
+            fprintf(fp, ",le=\"%g\"} %llu\n", export_bounds[k], (unsigned long long)cumulative);
+        }
+        // +Inf/_count from the buckets too, so they never trail a bucket
+        // that a concurrent observe() already bumped
+        while (b < HIST_BUCKETS) cumulative += load(&s->buckets[b++]);
+        uint64_t count = cumulative;
+        fputs("vfs_command_duration_seconds_bucket{", fp);
+        write_labels(fp, s);
+        fprintf(fp, ",le=\"+Inf\"} %llu\n", (unsigned long long)count);
+        fputs("vfs_command_duration_seconds_sum{", fp);
+        write_labels(fp, s);
+        fprintf(fp, "} %.9f\n", (double)load(&s->sum_ns) / 1e9);
+        fputs("vfs_command_duration_seconds_count{", fp);
+        write_labels(fp, s);
+        fprintf(fp, "} %llu\n", (unsigned long long)count);
+    }
+}
+
+// === Periodic dump ===
+static PeriodicDump metrics_dump = PERIODIC_DUMP_INIT(metrics_write_prometheus);
+
+int metrics_dump_start(const char* path, int seconds) {
+    return periodic_start(&metrics_dump, path, seconds);
+}
+
+void metrics_dump_stop(void) {
+    periodic_stop(&metrics_dump);
+}
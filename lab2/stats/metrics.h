@@ -0,0 +1,29 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Per-command latency histograms, labelled by command and result.
+// Buckets are log-linear (HDR style): 16 linear sub-buckets per power of
+// two, so any recorded value is within ~6% of its bucket bounds.
+#define HIST_SUB_BITS 4
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS  ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+#define METRICS_MAX_SERIES 256
+
+// Record one command that took `ns` nanoseconds
+void metrics_observe(const char* command, const char* result, uint64_t ns);
+
+// Value at quantile q (0..1) for a series, in ns (0 if unknown)
+uint64_t metrics_quantile(const char* command, const char* result, double q);
+
+// Prometheus text exposition of all series
+void metrics_write_prometheus(FILE* fp);
+
+// Rewrite `path` in Prometheus format every `seconds`; <= 0 stops
+int metrics_dump_start(const char* path, int seconds);
+void metrics_dump_stop(void);
+
+#endif // METRICS_H
@@ -0,0 +1,61 @@
+#include "periodic.h"
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+// Write to a temp file and rename, so readers never see a partial dump
+static void dump_once(PeriodicDump* pd, const char* path) {
+    char tmp[600];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* fp = fopen(tmp, "w");
+    if (!fp) return;
+    pd->report(fp);
+    if (fclose(fp) == 0) rename(tmp, path);
+}
+
+static void* dump_main(void* arg) {
+    PeriodicDump* pd = (PeriodicDump*)arg;
+    pthread_mutex_lock(&pd->lock);
+    while (!pd->stop) {
+        char path[sizeof(pd->path)];
+        memcpy(path, pd->path, sizeof(path));
+        pthread_mutex_unlock(&pd->lock);
+        dump_once(pd, path);
+        pthread_mutex_lock(&pd->lock);
+
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += pd->interval;
+        while (!pd->stop && pthread_cond_timedwait(&pd->cv, &pd->lock, &until) != ETIMEDOUT) {}
+    }
+    pthread_mutex_unlock(&pd->lock);
+    return NULL;
+}
+
+void periodic_stop(PeriodicDump* pd) {
+    pthread_mutex_lock(&pd->lock);
+    if (!pd->running) {
+        pthread_mutex_unlock(&pd->lock);
+        return;
+    }
+    pd->stop = 1;
+    pthread_cond_signal(&pd->cv);
+    pthread_mutex_unlock(&pd->lock);
+    pthread_join(pd->thread, NULL);
+    pd->running = 0;
+}
+
+int periodic_start(PeriodicDump* pd, const char* path, int seconds) {
+    periodic_stop(pd);
+    if (seconds <= 0) return 0;
+    if (!path || !*path || strlen(path) >= sizeof(pd->path)) return -1;
+
+    pthread_mutex_lock(&pd->lock);
+    snprintf(pd->path, sizeof(pd->path), "%s", path);
+    pd->interval = seconds;
+    pd->stop = 0;
+    int rc = pthread_create(&pd->thread, NULL, dump_main, pd);
+    pd->running = (rc == 0);
+    pthread_mutex_unlock(&pd->lock);
+    return rc == 0 ? 0 : -1;
+}
@@ -0,0 +1,27 @@
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+// A background thread that rewrites a file with a report every N seconds.
+// The file is replaced atomically (temp file + rename).
+typedef struct PeriodicDump {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    int running;
+    int stop;
+    int interval;
+    char path[512];
+    void (*report)(FILE* fp);
+} PeriodicDump;
+
+#define PERIODIC_DUMP_INIT(fn) \
+    { .lock = PTHREAD_MUTEX_INITIALIZER, .cv = PTHREAD_COND_INITIALIZER, .report = (fn) }
+
+// (Re)start dumping to path; seconds <= 0 just stops. Returns 0 on success.
+int periodic_start(PeriodicDump* pd, const char* path, int seconds);
+void periodic_stop(PeriodicDump* pd);
+
+#endif // PERIODIC_H
@@ -0,0 +1,107 @@
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "periodic.h"
+#include "../virtual-file-system/vfs.h"
+#include "../virtual-file-system/reaper.h"
+#include "../virtual-file-system/inode.h"
+
+// Every thread's block, newest first. Blocks are never freed, so counts
+// from threads that have exited still add up.
+static StatBlock* blocks = NULL;
+static pthread_mutex_t blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread StatBlock* my_block = NULL;
+
+static int64_t gauges[GAUGE_COUNT];
+
+StatBlock* stats_thread_block(void) {
+    if (my_block) return my_block;
+    static StatBlock fallback;
+    StatBlock* b = (StatBlock*)calloc(1, sizeof(StatBlock));
+    if (!b) return &fallback; // counts get lost rather than crash
+    pthread_mutex_lock(&blocks_lock);
+    b->next = blocks;
+    __atomic_store_n(&blocks, b, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&blocks_lock);
+    my_block = b;
+    return b;
+}
+
+void stats_gauge_set(GaugeId id, int64_t value) {
+    __atomic_store_n(&gauges[id], value, __ATOMIC_RELAXED);
+}
+
+int64_t stats_get(StatId id) {
+    int64_t sum = 0;
+    for (StatBlock* b = __atomic_load_n(&blocks, __ATOMIC_ACQUIRE); b; b = b->next) {
+        sum += __atomic_load_n(&b->v[id], __ATOMIC_RELAXED);
+    }
+    return sum;
+}
+
+uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void report_lookup(FILE* fp, const char* name, StatId hit, StatId miss) {
+    int64_t h = stats_get(hit), m = stats_get(miss);
+    double rate = (h + m) ? 100.0 * (double)h / (double)(h + m) : 0.0;
+    fprintf(fp, "%-22s hit=%lld miss=%lld (%.1f%% hit)\n", name, (long long)h, (long long)m, rate);
+}
+
+static void report_timed(FILE* fp, const char* name, StatId calls, StatId ns) {
+    int64_t c = stats_get(calls), t = stats_get(ns);
+    fprintf(fp, "%-22s calls=%lld total_ms=%.3f avg_ms=%.3f\n", name, (long long)c,
+            (double)t / 1e6, c ? (double)t / 1e6 / (double)c : 0.0);
+}
+
+void stats_report(FILE* fp) {
+    int64_t dirs = stats_get(STAT_DIRS), files = stats_get(STAT_FILES);
+    fprintf(fp, "%-22s dirs=%lld files=%lld\n", "nodes:", (long long)dirs, (long long)files);
+    fprintf(fp, "%-22s dir=%lld (%zu each) file=%lld (%zu each) index=%lld inode_table=%zu\n", "node_bytes:",
+            (long long)(dirs * (int64_t)sizeof(Directory)), sizeof(Directory),
+            (long long)(files * (int64_t)sizeof(File)), sizeof(File),
+            (long long)stats_get(STAT_INDEX_BYTES), inode_table_bytes());
+    fprintf(fp, "%-22s %lld\n", "content_bytes:", (long long)stats_get(STAT_CONTENT_BYTES));
+    fprintf(fp, "%-22s users=%lld groups=%lld memberships=%lld\n", "user_group_tables:",
+            (long long)__atomic_load_n(&gauges[GAUGE_USERS], __ATOMIC_RELAXED),
+            (long long)__atomic_load_n(&gauges[GAUGE_GROUPS], __ATOMIC_RELAXED),
+            (long long)__atomic_load_n(&gauges[GAUGE_MEMBERS], __ATOMIC_RELAXED));
+    // log_event() appends synchronously, so nothing ever queues
+    fprintf(fp, "%-22s %d\n", "audit_queue_depth:", 0);
+    fprintf(fp, "%-22s %zu\n", "reaper_pending:", reaper_pending());
+    report_timed(fp, "save_vfs:", STAT_SAVE_CALLS, STAT_SAVE_NS);
+    report_timed(fp, "load_vfs:", STAT_LOAD_CALLS, STAT_LOAD_NS);
+    int64_t load_ns = stats_get(STAT_LOAD_NS), parse_ns = stats_get(STAT_LOAD_PARSE_NS);
+    int64_t load_bytes = stats_get(STAT_LOAD_BYTES);
+    fprintf(fp, "%-22s %.1f MB/s (%.3f MB, parse_ms=%.3f link_ms=%.3f)\n", "load_throughput:",
+            load_ns ? (double)load_bytes / 1e6 / ((double)load_ns / 1e9) : 0.0, (double)load_bytes / 1e6,
+            (double)parse_ns / 1e6, (double)(load_ns - parse_ns) / 1e6);
+    report_lookup(fp, "find_subdir:", STAT_FIND_SUBDIR_HIT, STAT_FIND_SUBDIR_MISS);
+    report_lookup(fp, "find_file:", STAT_FIND_FILE_HIT, STAT_FIND_FILE_MISS);
+    report_lookup(fp, "user_in_group:", STAT_USER_IN_GROUP_HIT, STAT_USER_IN_GROUP_MISS);
+}
+
+// === Periodic dump ===
+static void dump_report(FILE* fp) {
+    time_t now = time(NULL);
+    char ts[64];
+    struct tm tm;
+    strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", localtime_r(&now, &tm));
+    fprintf(fp, "%-22s %s\n", "time:", ts);
+    stats_report(fp);
+}
+
+static PeriodicDump stats_dump = PERIODIC_DUMP_INIT(dump_report);
+
+int stats_dump_start(const char* path, int seconds) {
+    return periodic_start(&stats_dump, path, seconds);
+}
+
+void stats_dump_stop(void) {
+    periodic_stop(&stats_dump);
+}
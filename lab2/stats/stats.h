@@ -0,0 +1,69 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Runtime counters. Each thread bumps its own block with plain relaxed
+// stores (no locks, no shared cache lines); readers sum over all blocks.
+typedef enum {
+    STAT_DIRS,                 // live Directory nodes
+    STAT_FILES,                // live File nodes
+    STAT_INDEX_BYTES,          // bytes held by directory index entries
+    STAT_CONTENT_BYTES,        // bytes of file content
+    STAT_SAVE_CALLS,
+    STAT_SAVE_NS,
+    STAT_LOAD_CALLS,
+    STAT_LOAD_NS,
+    STAT_LOAD_BYTES,           // bytes of vfs.txt parsed
+    STAT_LOAD_PARSE_NS,        // part of STAT_LOAD_NS spent mapping + parsing
+    STAT_FIND_SUBDIR_HIT,
+    STAT_FIND_SUBDIR_MISS,
+    STAT_FIND_FILE_HIT,
+    STAT_FIND_FILE_MISS,
+    STAT_USER_IN_GROUP_HIT,
+    STAT_USER_IN_GROUP_MISS,
+    STAT_COUNT
+} StatId;
+
+// Values owned by one writer and published as a whole
+typedef enum {
+    GAUGE_USERS,
+    GAUGE_GROUPS,
+    GAUGE_MEMBERS,
+    GAUGE_COUNT
+} GaugeId;
+
+typedef struct StatBlock {
+    int64_t v[STAT_COUNT];
+    struct StatBlock* next;
+} StatBlock;
+
+StatBlock* stats_thread_block(void);
+
+static inline void stats_add(StatId id, int64_t delta) {
+    StatBlock* b = stats_thread_block();
+    __atomic_store_n(&b->v[id], b->v[id] + delta, __ATOMIC_RELAXED);
+}
+
+static inline void stats_inc(StatId id) {
+    stats_add(id, 1);
+}
+
+void stats_gauge_set(GaugeId id, int64_t value);
+
+// Sum of a counter over all threads
+int64_t stats_get(StatId id);
+
+// Monotonic clock in nanoseconds, for timing sections
+uint64_t stats_now_ns(void);
+
+// Human-readable report ("key: value" lines)
+void stats_report(FILE* fp);
+
+// Rewrite `path` with the report every `seconds` from a background
+// thread; seconds <= 0 stops it. Returns 0 on success.
+int stats_dump_start(const char* path, int seconds);
+void stats_dump_stop(void);
+
+#endif // STATS_H
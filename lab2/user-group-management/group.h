@@ -1,8 +1,13 @@
 #ifndef GROUP_H
 #define GROUP_H
 
+#include <stdbool.h>
+
 // Create a user and assign them to multiple groups
 void addgroup(const char *arg);
 void delgroup(const char *groupname);
 
+// Check if a group exists
+bool group_present(const char *groupname);
+
 #endif // GROUP_H
\ No newline at end of file
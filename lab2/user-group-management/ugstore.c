@@ -0,0 +1,840 @@
+#include "ugstore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../stats/stats.h"
+#include "../virtual-file-system/hash.h"
+
+#define UG_MAGIC      0x31534755u   // "UGS1"
+#define UG_IDX_MAGIC  0x31584955u   // "UIX1"
+#define UG_JNL_MAGIC  0x314C4E4Au   // "JNL1"
+#define UG_VERSION    1
+
+#define UG_KEY_MAX    100           // "user\0group" fits 49 + 1 + 49 + 1
+#define UG_NIL        0xFFFFFFFFu
+
+#define IDX_EMPTY     0u            // slots hold record id + 1
+#define IDX_TOMB      0xFFFFFFFFu
+#define IDX_MIN_CAP   1024u
+#define IDX_HDR_SIZE  64
+
+#define MIGRATE_USERS  "users.txt"
+#define MIGRATE_GROUPS "groups.txt"
+
+enum { REC_FREE = 0, REC_USER = 1, REC_GROUP = 2, REC_MEMBER = 3 };
+
+// Fixed-size record (128 bytes). Links are record ids, UG_NIL = none:
+//   USER/GROUP: link[0]/link[1] = head/tail of its membership chain
+//   MEMBER:     link[0]/link[1] = next/prev in the user's chain,
+//               link[2]/link[3] = next/prev in the group's chain
+//   FREE:       link[0] = next free record
+typedef struct UgRecord {
+    uint32_t kind;
+    uint32_t link[4];
+    uint32_t aux[2];            // reserved, zero
+    char key[UG_KEY_MAX];       // "name", or "user\0group" for MEMBER
+} UgRecord;
+
+typedef struct UgHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rec_count;         // records allocated (high-water mark)
+    uint32_t free_head;
+    uint32_t users;
+    uint32_t groups;
+    uint32_t members;
+    uint32_t idx_capacity;      // index slots, power of two
+    uint32_t idx_used;          // live + tombstone slots
+    uint32_t flags;             // UG_FLAG_*
+    uint32_t pad[6];
+} UgHeader;
+
+#define UG_FLAG_MIGRATED 1u     // text files imported (or nothing to import)
+
+#define DAT_HDR_SIZE ((off_t)sizeof(UgHeader))
+#define REC_OFF(id)  (DAT_HDR_SIZE + (off_t)(id) * (off_t)sizeof(UgRecord))
+#define SLOT_OFF(s)  ((off_t)IDX_HDR_SIZE + (off_t)(s) * 4)
+
+// Open store state
+static int dat_fd = -1;
+static int idx_fd = -1;
+static UgHeader hdr;
+
+static void publish_counts(void) {
+    stats_gauge_set(GAUGE_USERS, hdr.users);
+    stats_gauge_set(GAUGE_GROUPS, hdr.groups);
+    stats_gauge_set(GAUGE_MEMBERS, hdr.members);
+}
+
+// --- raw I/O ---
+static int read_full(int fd, void* buf, size_t n, off_t off) {
+    char* p = (char*)buf;
+    while (n > 0) {
+        ssize_t r = pread(fd, p, n, off);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return 0;
+        p += r; n -= (size_t)r; off += r;
+    }
+    return 1;
+}
+
+static int write_full(int fd, const void* buf, size_t n, off_t off) {
+    const char* p = (const char*)buf;
+    while (n > 0) {
+        ssize_t w = pwrite(fd, p, n, off);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return 0;
+        p += w; n -= (size_t)w; off += w;
+    }
+    return 1;
+}
+
+// --- keys ---
+static int valid_name(const char* name) {
+    if (!name || !*name || strlen(name) >= UG_NAME_MAX) return 0;
+    for (const char* p = name; *p; ++p) {
+        if (isspace((unsigned char)*p)) return 0;
+    }
+    return 1;
+}
+
+// Zero-padded key: "name", or "user\0group" for memberships
+static void make_key(char key[UG_KEY_MAX], const char* a, const char* b) {
+    memset(key, 0, UG_KEY_MAX);
+    size_t la = strlen(a);
+    memcpy(key, a, la);
+    if (b) memcpy(key + la + 1, b, strlen(b));
+}
+
+static uint32_t key_hash(uint32_t kind, const char key[UG_KEY_MAX]) {
+    uint32_t h = (FNV1A32_INIT ^ kind) * FNV1A32_PRIME;
+    size_t len = UG_KEY_MAX;
+    while (len > 0 && key[len - 1] == '\0') --len;
+    return fnv1a32_update(h, key, len);
+}
+
+// === Transactions ===
+// The write set holds after-images of records and index slots, hashed by
+// id/slot; reads inside the transaction see them before going to disk.
+typedef struct TxRec {
+    uint32_t id;
+    UgRecord rec;
+    struct TxRec* next;        // commit order
+    struct TxRec* hnext;       // bucket chain
+} TxRec;
+
+typedef struct TxSlot {
+    uint32_t slot;
+    uint32_t val;
+    uint32_t hnext;            // bucket chain, index + 1 (0 = end)
+} TxSlot;
+
+typedef struct Tx {
+    UgHeader hdr;
+    TxRec* recs;
+    size_t nrec;
+    TxRec** rbuckets;
+    size_t nrbuckets;
+    TxSlot* slots;
+    size_t nslot, slot_cap;
+    uint32_t* sbuckets;        // index + 1 into slots (0 = empty)
+    size_t nsbuckets;
+} Tx;
+
+static size_t mix(uint32_t v, size_t nbuckets) {
+    return (size_t)((v * 2654435761u) & (uint32_t)(nbuckets - 1));
+}
+
+static void tx_begin(Tx* tx) {
+    memset(tx, 0, sizeof(*tx));
+    tx->hdr = hdr;
+}
+
+static void tx_end(Tx* tx) {
+    while (tx->recs) {
+        TxRec* r = tx->recs;
+        tx->recs = r->next;
+        free(r);
+    }
+    free(tx->rbuckets);
+    free(tx->slots);
+    free(tx->sbuckets);
+    memset(tx, 0, sizeof(*tx));
+}
+
+static TxRec* tx_lookup(Tx* tx, uint32_t id) {
+    if (!tx->nrbuckets) return NULL;
+    for (TxRec* r = tx->rbuckets[mix(id, tx->nrbuckets)]; r; r = r->hnext) {
+        if (r->id == id) return r;
+    }
+    return NULL;
+}
+
+// Keep about one entry per bucket
+static int tx_grow_rbuckets(Tx* tx) {
+    if (tx->nrec < tx->nrbuckets) return 1;
+    size_t n = tx->nrbuckets ? 2 * tx->nrbuckets : 64;
+    TxRec** b = (TxRec**)calloc(n, sizeof(TxRec*));
+    if (!b) return 0;
+    for (TxRec* r = tx->recs; r; r = r->next) {
+        size_t h = mix(r->id, n);
+        r->hnext = b[h];
+        b[h] = r;
+    }
+    free(tx->rbuckets);
+    tx->rbuckets = b;
+    tx->nrbuckets = n;
+    return 1;
+}
+
+// Read a record as the transaction currently sees it
+static int tx_peek(Tx* tx, uint32_t id, UgRecord* out) {
+    TxRec* r = tx_lookup(tx, id);
+    if (r) { *out = r->rec; return 1; }
+    return read_full(dat_fd, out, sizeof(*out), REC_OFF(id));
+}
+
+// Record pointer for modification; stays valid until tx_end
+static UgRecord* tx_rec(Tx* tx, uint32_t id) {
+    TxRec* r = tx_lookup(tx, id);
+    if (r) return &r->rec;
+    if (!tx_grow_rbuckets(tx)) return NULL;
+    r = (TxRec*)calloc(1, sizeof(TxRec));
+    if (!r) return NULL;
+    r->id = id;
+    if (id < hdr.rec_count && !read_full(dat_fd, &r->rec, sizeof(r->rec), REC_OFF(id))) {
+        free(r);
+        return NULL;
+    }
+    r->next = tx->recs;
+    tx->recs = r;
+    size_t h = mix(id, tx->nrbuckets);
+    r->hnext = tx->rbuckets[h];
+    tx->rbuckets[h] = r;
+    tx->nrec++;
+    return &r->rec;
+}
+
+static TxSlot* tx_slot_lookup(Tx* tx, uint32_t slot) {
+    if (!tx->nsbuckets) return NULL;
+    for (uint32_t i = tx->sbuckets[mix(slot, tx->nsbuckets)]; i; i = tx->slots[i - 1].hnext) {
+        if (tx->slots[i - 1].slot == slot) return &tx->slots[i - 1];
+    }
+    return NULL;
+}
+
+static uint32_t tx_slot_get(Tx* tx, uint32_t slot) {
+    TxSlot* ts = tx_slot_lookup(tx, slot);
+    if (ts) return ts->val;
+    uint32_t v = IDX_EMPTY;
+    read_full(idx_fd, &v, sizeof(v), SLOT_OFF(slot));
+    return v;
+}
+
+static void tx_slot_set(Tx* tx, uint32_t slot, uint32_t val) {
+    TxSlot* ts = tx_slot_lookup(tx, slot);
+    if (ts) { ts->val = val; return; }
+
+    if (tx->nslot == tx->slot_cap) {
+        size_t cap = tx->slot_cap ? 2 * tx->slot_cap : 64;
+        TxSlot* sl = (TxSlot*)realloc(tx->slots, cap * sizeof(TxSlot));
+        uint32_t* b = (uint32_t*)calloc(cap, sizeof(uint32_t));
+        if (sl) tx->slots = sl;
+        if (!sl || !b) { free(b); return; }
+        // Rehash into `cap` buckets (one per possible entry)
+        for (size_t i = 0; i < tx->nslot; ++i) {
+            size_t h = mix(tx->slots[i].slot, cap);
+            tx->slots[i].hnext = b[h];
+            b[h] = (uint32_t)(i + 1);
+        }
+        free(tx->sbuckets);
+        tx->sbuckets = b;
+        tx->nsbuckets = cap;
+        tx->slot_cap = cap;
+    }
+    TxSlot* n = &tx->slots[tx->nslot];
+    size_t h = mix(slot, tx->nsbuckets);
+    n->slot = slot;
+    n->val = val;
+    n->hnext = tx->sbuckets[h];
+    tx->sbuckets[h] = (uint32_t)(++tx->nslot);
+}
+
+// Find a key; *slot_out gets its slot, or the slot to insert it into
+static uint32_t tx_find(Tx* tx, uint32_t kind, const char key[UG_KEY_MAX], uint32_t* slot_out) {
+    uint32_t mask = tx->hdr.idx_capacity - 1;
+    uint32_t s = key_hash(kind, key) & mask;
+    uint32_t first_tomb = UG_NIL;
+    for (uint32_t probes = 0; probes <= mask; ++probes, s = (s + 1) & mask) {
+        uint32_t v = tx_slot_get(tx, s);
+        if (v == IDX_EMPTY) break;
+        if (v == IDX_TOMB) {
+            if (first_tomb == UG_NIL) first_tomb = s;
+            continue;
+        }
+        UgRecord rec;
+        if (!tx_peek(tx, v - 1, &rec)) break;
+        if (rec.kind == kind && memcmp(rec.key, key, UG_KEY_MAX) == 0) {
+            if (slot_out) *slot_out = s;
+            return v - 1;
+        }
+    }
+    if (slot_out) *slot_out = (first_tomb != UG_NIL) ? first_tomb : s;
+    return UG_NIL;
+}
+
+static void tx_index_put(Tx* tx, uint32_t slot, uint32_t id) {
+    if (tx_slot_get(tx, slot) == IDX_EMPTY) tx->hdr.idx_used++;
+    tx_slot_set(tx, slot, id + 1);
+}
+
+static uint32_t tx_alloc(Tx* tx, uint32_t kind, const char key[UG_KEY_MAX]) {
+    uint32_t id;
+    UgRecord* r;
+    if (tx->hdr.free_head != UG_NIL) {
+        id = tx->hdr.free_head;
+        r = tx_rec(tx, id);
+        if (!r) return UG_NIL;
+        tx->hdr.free_head = r->link[0];
+    } else {
+        id = tx->hdr.rec_count++;
+        r = tx_rec(tx, id);
+        if (!r) return UG_NIL;
+    }
+    memset(r, 0, sizeof(*r));
+    r->kind = kind;
+    for (int i = 0; i < 4; ++i) r->link[i] = UG_NIL;
+    memcpy(r->key, key, UG_KEY_MAX);
+    return id;
+}
+
+static void tx_release(Tx* tx, uint32_t id, uint32_t slot) {
+    UgRecord* r = tx_rec(tx, id);
+    if (!r) return;
+    memset(r, 0, sizeof(*r));
+    r->kind = REC_FREE;
+    r->link[0] = tx->hdr.free_head;
+    tx->hdr.free_head = id;
+    tx_slot_set(tx, slot, IDX_TOMB);
+}
+
+// --- journal image: [magic nrec nslot checksum] header recs slots ---
+typedef struct JnlHead {
+    uint32_t magic;
+    uint32_t nrec;
+    uint32_t nslot;
+    uint32_t checksum;
+} JnlHead;
+
+static uint32_t checksum(const unsigned char* p, size_t n) {
+    return fnv1a32_update(FNV1A32_INIT, p, n);
+}
+
+static int apply_image(const unsigned char* img, size_t len) {
+    JnlHead jh;
+    if (len < sizeof(jh)) return 0;
+    memcpy(&jh, img, sizeof(jh));
+    size_t need = sizeof(jh) + sizeof(UgHeader) +
+                  (size_t)jh.nrec * (4 + sizeof(UgRecord)) + (size_t)jh.nslot * 8;
+    if (jh.magic != UG_JNL_MAGIC || len != need) return 0;
+    if (checksum(img + sizeof(jh), len - sizeof(jh)) != jh.checksum) return 0;
+
+    const unsigned char* p = img + sizeof(jh);
+    UgHeader h;
+    memcpy(&h, p, sizeof(h));
+    p += sizeof(h);
+    for (uint32_t i = 0; i < jh.nrec; ++i) {
+        uint32_t id;
+        memcpy(&id, p, 4);
+        if (!write_full(dat_fd, p + 4, sizeof(UgRecord), REC_OFF(id))) return 0;
+        p += 4 + sizeof(UgRecord);
+    }
+    for (uint32_t i = 0; i < jh.nslot; ++i) {
+        uint32_t sv[2];
+        memcpy(sv, p, 8);
+        if (!write_full(idx_fd, &sv[1], 4, SLOT_OFF(sv[0]))) return 0;
+        p += 8;
+    }
+    if (!write_full(dat_fd, &h, sizeof(h), 0)) return 0;
+    if (fsync(dat_fd) != 0 || fsync(idx_fd) != 0) return 0;
+    hdr = h;
+    publish_counts();
+    return 1;
+}
+
+// Atomic commit: journal (fsync) -> in-place writes (fsync) -> drop journal
+static UgStatus tx_commit(Tx* tx) {
+    size_t len = sizeof(JnlHead) + sizeof(UgHeader) +
+                 tx->nrec * (4 + sizeof(UgRecord)) + tx->nslot * 8;
+    unsigned char* img = (unsigned char*)malloc(len);
+    if (!img) return UG_IOERR;
+
+    unsigned char* p = img + sizeof(JnlHead);
+    memcpy(p, &tx->hdr, sizeof(UgHeader));
+    p += sizeof(UgHeader);
+    for (TxRec* r = tx->recs; r; r = r->next) {
+        memcpy(p, &r->id, 4);
+        memcpy(p + 4, &r->rec, sizeof(UgRecord));
+        p += 4 + sizeof(UgRecord);
+    }
+    for (size_t i = 0; i < tx->nslot; ++i) {
+        memcpy(p, &tx->slots[i].slot, 4);
+        memcpy(p + 4, &tx->slots[i].val, 4);
+        p += 8;
+    }
+    JnlHead jh = { UG_JNL_MAGIC, (uint32_t)tx->nrec, (uint32_t)tx->nslot, 0 };
+    jh.checksum = checksum(img + sizeof(jh), len - sizeof(jh));
+    memcpy(img, &jh, sizeof(jh));
+
+    UgStatus st = UG_IOERR;
+    int jfd = open(UGSTORE_JOURNAL, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (jfd >= 0) {
+        int ok = write_full(jfd, img, len, 0) && fsync(jfd) == 0;
+        close(jfd);
+        if (ok && apply_image(img, len)) {
+            unlink(UGSTORE_JOURNAL);
+            st = UG_OK;
+        }
+    }
+    free(img);
+    return st;
+}
+
+// Redo a journal left behind by an interrupted commit; a torn journal
+// (bad size or checksum) means the commit never happened.
+static void recover_journal(void) {
+    int jfd = open(UGSTORE_JOURNAL, O_RDONLY);
+    if (jfd < 0) return;
+    struct stat st;
+    if (fstat(jfd, &st) == 0 && st.st_size > 0) {
+        unsigned char* img = (unsigned char*)malloc((size_t)st.st_size);
+        if (img && read_full(jfd, img, (size_t)st.st_size, 0)) {
+            apply_image(img, (size_t)st.st_size);
+        }
+        free(img);
+    }
+    close(jfd);
+    unlink(UGSTORE_JOURNAL);
+}
+
+// === Index maintenance ===
+// Build a fresh index of `cap` slots from the records and swap it in.
+static int index_rebuild(uint32_t cap) {
+    uint32_t* slots = (uint32_t*)calloc(cap, sizeof(uint32_t));
+    if (!slots) return 0;
+
+    uint32_t live = 0;
+    UgRecord batch[256];
+    for (uint32_t base = 0; base < hdr.rec_count; base += 256) {
+        uint32_t n = hdr.rec_count - base < 256 ? hdr.rec_count - base : 256;
+        if (!read_full(dat_fd, batch, n * sizeof(UgRecord), REC_OFF(base))) { free(slots); return 0; }
+        for (uint32_t i = 0; i < n; ++i) {
+            if (batch[i].kind == REC_FREE) continue;
+            uint32_t s = key_hash(batch[i].kind, batch[i].key) & (cap - 1);
+            while (slots[s] != IDX_EMPTY) s = (s + 1) & (cap - 1);
+            slots[s] = base + i + 1;
+            ++live;
+        }
+    }
+
+    unsigned char ih[IDX_HDR_SIZE] = {0};
+    uint32_t magic = UG_IDX_MAGIC;
+    memcpy(ih, &magic, 4);
+    memcpy(ih + 4, &cap, 4);
+    int fd = open(UGSTORE_INDEX ".tmp", O_RDWR | O_CREAT | O_TRUNC, 0644);
+    int ok = fd >= 0 && write_full(fd, ih, sizeof(ih), 0) &&
+             write_full(fd, slots, (size_t)cap * 4, IDX_HDR_SIZE) && fsync(fd) == 0;
+    free(slots);
+    if (!ok || rename(UGSTORE_INDEX ".tmp", UGSTORE_INDEX) != 0) {
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    if (idx_fd >= 0) close(idx_fd);
+    idx_fd = fd;
+
+    // A crash before this commit leaves a capacity mismatch, which makes
+    // the next open rebuild again
+    Tx tx;
+    tx_begin(&tx);
+    tx.hdr.idx_capacity = cap;
+    tx.hdr.idx_used = live;
+    UgStatus st = tx_commit(&tx);
+    tx_end(&tx);
+    return st == UG_OK;
+}
+
+// Rebuilt indexes start at a load factor of at most 1/4
+static uint32_t index_cap_for(uint64_t keys) {
+    uint32_t cap = IDX_MIN_CAP;
+    while ((uint64_t)cap < keys * 4) cap *= 2;
+    return cap;
+}
+
+// Keep the load factor (including tombstones) at or below 1/2
+static int ensure_index_room(uint32_t extra) {
+    if ((uint64_t)(hdr.idx_used + extra) * 2 <= hdr.idx_capacity) return 1;
+    return index_rebuild(index_cap_for((uint64_t)hdr.users + hdr.groups + hdr.members + extra));
+}
+
+static int index_valid(void) {
+    uint32_t ih[2];
+    struct stat st;
+    if (!read_full(idx_fd, ih, sizeof(ih), 0) || fstat(idx_fd, &st) != 0) return 0;
+    return ih[0] == UG_IDX_MAGIC && ih[1] == hdr.idx_capacity &&
+           st.st_size == SLOT_OFF(hdr.idx_capacity);
+}
+
+// === Open / migrate ===
+static void migrate_from_text(void);
+
+static int store_open(void) {
+    if (dat_fd >= 0) return 1;
+
+    int created = 0;
+    dat_fd = open(UGSTORE_DATA, O_RDWR);
+    if (dat_fd < 0 && errno == ENOENT) {
+        dat_fd = open(UGSTORE_DATA, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (dat_fd < 0) return 0;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = UG_MAGIC;
+        hdr.version = UG_VERSION;
+        hdr.free_head = UG_NIL;
+        if (!write_full(dat_fd, &hdr, sizeof(hdr), 0) || fsync(dat_fd) != 0) {
+            close(dat_fd);
+            dat_fd = -1;
+            unlink(UGSTORE_DATA);
+            return 0;
+        }
+        unlink(UGSTORE_JOURNAL);
+        created = 1;
+    }
+    if (dat_fd < 0) return 0;
+
+    idx_fd = open(UGSTORE_INDEX, O_RDWR | O_CREAT, 0644);
+    if (idx_fd < 0) {
+        close(dat_fd);
+        dat_fd = -1;
+        return 0;
+    }
+    if (!created) recover_journal();
+
+    if (!read_full(dat_fd, &hdr, sizeof(hdr), 0) || hdr.magic != UG_MAGIC || hdr.version != UG_VERSION) {
+        fprintf(stderr, "ugstore: %s is not a valid store\n", UGSTORE_DATA);
+        close(dat_fd);
+        if (idx_fd >= 0) close(idx_fd);
+        dat_fd = idx_fd = -1;
+        return 0;
+    }
+    if (!index_valid() && !index_rebuild(index_cap_for((uint64_t)hdr.users + hdr.groups + hdr.members))) {
+        close(dat_fd);
+        close(idx_fd);
+        dat_fd = idx_fd = -1;
+        return 0;
+    }
+    if (!(hdr.flags & UG_FLAG_MIGRATED)) migrate_from_text();
+    publish_counts();
+    return 1;
+}
+
+// === Operations (inside a transaction) ===
+static void chain_append(Tx* tx, uint32_t owner_id, uint32_t mid, int nx) {
+    int pv = nx + 1;
+    UgRecord* owner = tx_rec(tx, owner_id);
+    UgRecord* m = tx_rec(tx, mid);
+    m->link[nx] = UG_NIL;
+    m->link[pv] = owner->link[1];
+    if (owner->link[1] != UG_NIL) tx_rec(tx, owner->link[1])->link[nx] = mid;
+    else owner->link[0] = mid;
+    owner->link[1] = mid;
+}
+
+static void chain_remove(Tx* tx, uint32_t owner_id, uint32_t mid, int nx) {
+    int pv = nx + 1;
+    UgRecord* owner = tx_rec(tx, owner_id);
+    UgRecord* m = tx_rec(tx, mid);
+    uint32_t next = m->link[nx], prev = m->link[pv];
+    if (prev != UG_NIL) tx_rec(tx, prev)->link[nx] = next;
+    else owner->link[0] = next;
+    if (next != UG_NIL) tx_rec(tx, next)->link[pv] = prev;
+    else owner->link[1] = prev;
+}
+
+// Create a record for key unless it exists; returns its id
+static uint32_t tx_ensure(Tx* tx, uint32_t kind, const char* a, const char* b, int* created) {
+    char key[UG_KEY_MAX];
+    uint32_t slot;
+    make_key(key, a, b);
+    uint32_t id = tx_find(tx, kind, key, &slot);
+    if (created) *created = 0;
+    if (id != UG_NIL) return id;
+    id = tx_alloc(tx, kind, key);
+    if (id == UG_NIL) return UG_NIL;
+    tx_index_put(tx, slot, id);
+    if (kind == REC_USER) tx->hdr.users++;
+    else if (kind == REC_GROUP) tx->hdr.groups++;
+    else tx->hdr.members++;
+    if (created) *created = 1;
+    return id;
+}
+
+static int tx_join(Tx* tx, uint32_t uid, uint32_t gid, const char* user, const char* group) {
+    int created;
+    uint32_t mid = tx_ensure(tx, REC_MEMBER, user, group, &created);
+    if (mid == UG_NIL) return -1;
+    if (!created) return 0;
+    chain_append(tx, uid, mid, 0);
+    chain_append(tx, gid, mid, 2);
+    return 1;
+}
+
+static void tx_leave(Tx* tx, uint32_t uid, uint32_t gid, const char* user, const char* group) {
+    char key[UG_KEY_MAX];
+    uint32_t slot;
+    make_key(key, user, group);
+    uint32_t mid = tx_find(tx, REC_MEMBER, key, &slot);
+    if (mid == UG_NIL) return;
+    chain_remove(tx, uid, mid, 0);
+    chain_remove(tx, gid, mid, 2);
+    tx_release(tx, mid, slot);
+    tx->hdr.members--;
+}
+
+static uint32_t tx_find_name(Tx* tx, uint32_t kind, const char* name, uint32_t* slot) {
+    char key[UG_KEY_MAX];
+    make_key(key, name, NULL);
+    return tx_find(tx, kind, key, slot);
+}
+
+// === Public API ===
+UgStatus ug_add_user(const char* user, bool* group_created) {
+    if (group_created) *group_created = false;
+    if (!valid_name(user)) return UG_INVALID;
+    if (!store_open() || !ensure_index_room(3)) return UG_IOERR;
+
+    Tx tx;
+    tx_begin(&tx);
+    UgStatus st = UG_EXISTS;
+    if (tx_find_name(&tx, REC_USER, user, NULL) == UG_NIL) {
+        int gnew = 0;
+        uint32_t uid = tx_ensure(&tx, REC_USER, user, NULL, NULL);
+        uint32_t gid = tx_ensure(&tx, REC_GROUP, user, NULL, &gnew);
+        st = (uid == UG_NIL || gid == UG_NIL || tx_join(&tx, uid, gid, user, user) < 0)
+                 ? UG_IOERR : tx_commit(&tx);
+        if (st == UG_OK && group_created) *group_created = gnew;
+    }
+    tx_end(&tx);
+    return st;
+}
+
+UgStatus ug_add_group(const char* group) {
+    if (!valid_name(group)) return UG_INVALID;
+    if (!store_open() || !ensure_index_room(1)) return UG_IOERR;
+
+    Tx tx;
+    tx_begin(&tx);
+    int created;
+    UgStatus st;
+    if (tx_ensure(&tx, REC_GROUP, group, NULL, &created) == UG_NIL) st = UG_IOERR;
+    else st = created ? tx_commit(&tx) : UG_EXISTS;
+    tx_end(&tx);
+    return st;
+}
+
+UgStatus ug_add_member(const char* user, const char* group) {
+    if (!valid_name(user) || !valid_name(group)) return UG_INVALID;
+    if (!store_open() || !ensure_index_room(1)) return UG_IOERR;
+
+    Tx tx;
+    tx_begin(&tx);
+    UgStatus st = UG_NOENT;
+    uint32_t uid = tx_find_name(&tx, REC_USER, user, NULL);
+    uint32_t gid = tx_find_name(&tx, REC_GROUP, group, NULL);
+    if (uid != UG_NIL && gid != UG_NIL) {
+        int r = tx_join(&tx, uid, gid, user, group);
+        st = r < 0 ? UG_IOERR : (r == 0 ? UG_EXISTS : tx_commit(&tx));
+    }
+    tx_end(&tx);
+    return st;
+}
+
+UgStatus ug_del_user(const char* user, bool* group_removed) {
+    if (group_removed) *group_removed = false;
+    if (!valid_name(user)) return UG_INVALID;
+    if (!store_open()) return UG_IOERR;
+
+    Tx tx;
+    tx_begin(&tx);
+    uint32_t uslot;
+    uint32_t uid = tx_find_name(&tx, REC_USER, user, &uslot);
+    if (uid == UG_NIL) { tx_end(&tx); return UG_NOENT; }
+
+    // Leave every group on the user's chain
+    for (;;) {
+        UgRecord u, m;
+        if (!tx_peek(&tx, uid, &u) || u.link[0] == UG_NIL) break;
+        if (!tx_peek(&tx, u.link[0], &m)) break;
+        const char* group = m.key + strlen(m.key) + 1;
+        uint32_t gid = tx_find_name(&tx, REC_GROUP, group, NULL);
+        if (gid == UG_NIL) break;
+        tx_leave(&tx, uid, gid, user, group);
+    }
+    tx_release(&tx, uid, uslot);
+    tx.hdr.users--;
+
+    // Drop the personal group once it is empty (like deluser on Linux)
+    uint32_t gslot;
+    uint32_t gid = tx_find_name(&tx, REC_GROUP, user, &gslot);
+    if (gid != UG_NIL) {
+        UgRecord g;
+        if (tx_peek(&tx, gid, &g) && g.link[0] == UG_NIL) {
+            tx_release(&tx, gid, gslot);
+            tx.hdr.groups--;
+            if (group_removed) *group_removed = true;
+        }
+    }
+    UgStatus st = tx_commit(&tx);
+    if (st != UG_OK && group_removed) *group_removed = false;
+    tx_end(&tx);
+    return st;
+}
+
+UgStatus ug_del_group(const char* group) {
+    if (!valid_name(group)) return UG_INVALID;
+    if (!store_open()) return UG_IOERR;
+
+    Tx tx;
+    tx_begin(&tx);
+    uint32_t gslot;
+    uint32_t gid = tx_find_name(&tx, REC_GROUP, group, &gslot);
+    if (gid == UG_NIL) { tx_end(&tx); return UG_NOENT; }
+
+    for (;;) {
+        UgRecord g, m;
+        if (!tx_peek(&tx, gid, &g) || g.link[0] == UG_NIL) break;
+        if (!tx_peek(&tx, g.link[0], &m)) break;
+        char user[UG_NAME_MAX];
+        size_t n = strnlen(m.key, UG_NAME_MAX - 1);
+        memcpy(user, m.key, n);
+        user[n] = '\0';
+        uint32_t uid = tx_find_name(&tx, REC_USER, user, NULL);
+        if (uid == UG_NIL) break;
+        tx_leave(&tx, uid, gid, user, group);
+    }
+    tx_release(&tx, gid, gslot);
+    tx.hdr.groups--;
+    UgStatus st = tx_commit(&tx);
+    tx_end(&tx);
+    return st;
+}
+
+static bool exists(uint32_t kind, const char* a, const char* b) {
+    if (!valid_name(a) || (b && !valid_name(b)) || !store_open()) return false;
+    char key[UG_KEY_MAX];
+    make_key(key, a, b);
+    Tx tx;
+    tx_begin(&tx);
+    bool found = tx_find(&tx, kind, key, NULL) != UG_NIL;
+    tx_end(&tx);
+    return found;
+}
+
+bool ug_user_exists(const char* user) {
+    return exists(REC_USER, user, NULL);
+}
+
+bool ug_group_exists(const char* group) {
+    return exists(REC_GROUP, group, NULL);
+}
+
+bool ug_is_member(const char* user, const char* group) {
+    return exists(REC_MEMBER, user, group);
+}
+
+int ug_user_groups(const char* user, char groups[][UG_NAME_MAX], int max) {
+    if (!valid_name(user) || !store_open()) return 0;
+    Tx tx;
+    tx_begin(&tx);
+    int count = 0;
+    UgRecord u, m;
+    uint32_t uid = tx_find_name(&tx, REC_USER, user, NULL);
+    if (uid != UG_NIL && tx_peek(&tx, uid, &u)) {
+        for (uint32_t mid = u.link[0]; mid != UG_NIL && count < max; mid = m.link[0]) {
+            if (!tx_peek(&tx, mid, &m)) break;
+            snprintf(groups[count++], UG_NAME_MAX, "%s", m.key + strlen(m.key) + 1);
+        }
+    }
+    tx_end(&tx);
+    return count;
+}
+
+void ug_counts(size_t* users, size_t* groups, size_t* members) {
+    int ok = store_open();
+    if (users) *users = ok ? hdr.users : 0;
+    if (groups) *groups = ok ? hdr.groups : 0;
+    if (members) *members = ok ? hdr.members : 0;
+}
+
+// === Migration from users.txt / groups.txt ===
+// users.txt: "user group..."; groups.txt: "group member...". Runs as a
+// single transaction that also sets UG_FLAG_MIGRATED, so it happens once.
+static void migrate_from_text(void) {
+    FILE* uf = fopen(MIGRATE_USERS, "r");
+    FILE* gf = fopen(MIGRATE_GROUPS, "r");
+
+    // Size the index for every token up front so the transaction fits
+    char line[512];
+    uint32_t tokens = 0;
+    FILE* files[2] = { uf, gf };
+    for (int i = 0; i < 2; ++i) {
+        if (!files[i]) continue;
+        while (fgets(line, sizeof(line), files[i])) {
+            for (char* t = strtok(line, " \t\r\n"); t; t = strtok(NULL, " \t\r\n")) tokens += 2;
+        }
+        rewind(files[i]);
+    }
+    if (!ensure_index_room(tokens)) {
+        if (uf) fclose(uf);
+        if (gf) fclose(gf);
+        return;
+    }
+
+    Tx tx;
+    tx_begin(&tx);
+    tx.hdr.flags |= UG_FLAG_MIGRATED;
+    if (uf) {
+        while (fgets(line, sizeof(line), uf)) {
+            char* user = strtok(line, " \t\r\n");
+            if (!valid_name(user)) continue;
+            uint32_t uid = tx_ensure(&tx, REC_USER, user, NULL, NULL);
+            for (char* g = strtok(NULL, " \t\r\n"); g && uid != UG_NIL; g = strtok(NULL, " \t\r\n")) {
+                if (!valid_name(g)) continue;
+                uint32_t gid = tx_ensure(&tx, REC_GROUP, g, NULL, NULL);
+                if (gid != UG_NIL) tx_join(&tx, uid, gid, user, g);
+            }
+        }
+    }
+    if (gf) {
+        while (fgets(line, sizeof(line), gf)) {
+            char* group = strtok(line, " \t\r\n");
+            if (!valid_name(group)) continue;
+            uint32_t gid = tx_ensure(&tx, REC_GROUP, group, NULL, NULL);
+            for (char* u = strtok(NULL, " \t\r\n"); u && gid != UG_NIL; u = strtok(NULL, " \t\r\n")) {
+                if (!valid_name(u)) continue;
+                uint32_t uid = tx_find_name(&tx, REC_USER, u, NULL);
+                if (uid != UG_NIL) tx_join(&tx, uid, gid, u, group);
+            }
+        }
+    }
+    if (tx_commit(&tx) == UG_OK && (uf || gf)) {
+        printf("Migrated %u users and %u groups into %s.\n", hdr.users, hdr.groups, UGSTORE_DATA);
+    }
+    tx_end(&tx);
+    if (uf) fclose(uf);
+    if (gf) fclose(gf);
+}
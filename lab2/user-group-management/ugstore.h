@@ -0,0 +1,55 @@
+#ifndef UGSTORE_H
+#define UGSTORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Record-oriented store for users, groups and memberships.
+//
+// ugstore.dat holds a header and fixed-size records, ugstore.idx a hash
+// index (key -> record id) that can always be rebuilt from the records.
+// Every change is one transaction: the after-images of the touched
+// records and index slots go to ugstore.jnl first, then are written in
+// place, so each admin command costs O(1) I/O (O(k) for k memberships).
+// On first use the store is migrated from users.txt/groups.txt.
+
+#define UG_NAME_MAX 50   // including the terminating NUL
+
+#define UGSTORE_DATA    "ugstore.dat"
+#define UGSTORE_INDEX   "ugstore.idx"
+#define UGSTORE_JOURNAL "ugstore.jnl"
+
+typedef enum {
+    UG_OK = 0,
+    UG_EXISTS,
+    UG_NOENT,       // user/group named in the call does not exist
+    UG_INVALID,     // bad name
+    UG_IOERR
+} UgStatus;
+
+// Create a user plus membership of the same-named group, creating that
+// group if needed (*group_created tells which).
+UgStatus ug_add_user(const char* user, bool* group_created);
+UgStatus ug_add_group(const char* group);
+
+// UG_NOENT if either side is missing, UG_EXISTS if already a member
+UgStatus ug_add_member(const char* user, const char* group);
+
+// Remove a user and all their memberships. The user's personal group is
+// removed too if nobody else is left in it (*group_removed).
+UgStatus ug_del_user(const char* user, bool* group_removed);
+
+// Remove a group and all its memberships
+UgStatus ug_del_group(const char* group);
+
+bool ug_user_exists(const char* user);
+bool ug_group_exists(const char* group);
+bool ug_is_member(const char* user, const char* group);
+
+// Groups of a user in the order they were joined (primary first)
+int ug_user_groups(const char* user, char groups[][UG_NAME_MAX], int max);
+
+// Table sizes
+void ug_counts(size_t* users, size_t* groups, size_t* members);
+
+#endif // UGSTORE_H
@@ -6,14 +6,12 @@
 // Create a user and assign them to their own primary group
 void adduser(const char *arg);
 
-// Delete user from users.txt and remove them from all groups in groups.txt
+// Delete a user and remove them from all groups
 void deluser(const char *username);
 
 // Check if a user exists
 int user_present(const char* username);
 
-bool user_value_exists(const char* filename, const char* value);
-
 // Check if a user belongs to a specific group
 bool user_in_group(const char* username, const char* groupname);
 
@@ -0,0 +1,146 @@
+#include "dirindex.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../stats/stats.h"
+
+// --- helpers ---
+static size_t entry_size(int level) {
+    return sizeof(IndexEntry) + level * sizeof(IndexEntry*);
+}
+
+static IndexEntry* new_entry(int level) {
+    IndexEntry* e = (IndexEntry*)calloc(1, entry_size(level));
+    if (e) {
+        e->level = level;
+        stats_add(STAT_INDEX_BYTES, (int64_t)entry_size(level));
+    }
+    return e;
+}
+
+static void free_entry(IndexEntry* e) {
+    stats_add(STAT_INDEX_BYTES, -(int64_t)entry_size(e->level));
+    free(e);
+}
+
+// Geometric level with p = 1/4 (xorshift, no need for rand()'s quality)
+static int random_level(void) {
+    static __thread uint32_t state = 2463534242u; // per thread: reload builds trees off the session thread
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    int level = 1;
+    uint32_t bits = state;
+    while (level < DIR_INDEX_MAX_LEVEL && (bits & 3) == 0) {
+        ++level;
+        bits >>= 2;
+    }
+    return level;
+}
+
+// Fill update[] with the last entry < key on every level
+static IndexEntry* find_less(const DirIndex* idx, const char* key, IndexEntry** update) {
+    IndexEntry* x = idx->head;
+    for (int i = idx->level - 1; i >= 0; --i) {
+        while (x->forward[i] && strcmp(x->forward[i]->name, key) < 0) x = x->forward[i];
+        if (update) update[i] = x;
+    }
+    return x;
+}
+
+// === Lifecycle ===
+void dir_index_init(DirIndex* idx) {
+    idx->head = new_entry(DIR_INDEX_MAX_LEVEL);
+    idx->level = 1;
+    idx->count = 0;
+}
+
+void dir_index_free(DirIndex* idx) {
+    if (!idx->head) return;
+    IndexEntry* e = idx->head->forward[0];
+    while (e) {
+        IndexEntry* next = e->forward[0];
+        free_entry(e);
+        e = next;
+    }
+    free_entry(idx->head);
+    idx->head = NULL;
+    idx->count = 0;
+}
+
+// === Updates ===
+int dir_index_insert(DirIndex* idx, const char* name, int is_dir, void* node) {
+    IndexEntry* update[DIR_INDEX_MAX_LEVEL];
+    find_less(idx, name, update);
+
+    int level = random_level();
+    if (level > idx->level) {
+        for (int i = idx->level; i < level; ++i) update[i] = idx->head;
+        idx->level = level;
+    }
+    IndexEntry* e = new_entry(level);
+    if (!e) return 0;
+    e->name = name;
+    e->is_dir = is_dir;
+    e->node = node;
+    for (int i = 0; i < level; ++i) {
+        e->forward[i] = update[i]->forward[i];
+        update[i]->forward[i] = e;
+    }
+    idx->count++;
+    return 1;
+}
+
+int dir_index_remove(DirIndex* idx, const char* name, const void* node) {
+    IndexEntry* update[DIR_INDEX_MAX_LEVEL];
+    find_less(idx, name, update);
+
+    // Locate the exact entry inside the run of equal names
+    IndexEntry* target = update[0]->forward[0];
+    while (target && target->node != node && strcmp(target->name, name) == 0) target = target->forward[0];
+    if (!target || target->node != node) return 0;
+
+    for (int i = 0; i < target->level; ++i) {
+        IndexEntry* x = update[i];
+        while (x->forward[i] != target) x = x->forward[i];
+        x->forward[i] = target->forward[i];
+    }
+    free_entry(target);
+    while (idx->level > 1 && !idx->head->forward[idx->level - 1]) idx->level--;
+    idx->count--;
+    return 1;
+}
+
+// === Queries ===
+void* dir_index_find(const DirIndex* idx, const char* name, int is_dir) {
+    IndexEntry* e = find_less(idx, name, NULL)->forward[0];
+    for (; e && strcmp(e->name, name) == 0; e = e->forward[0]) {
+        if (e->is_dir == is_dir) return e->node;
+    }
+    return NULL;
+}
+
+IndexEntry* dir_index_first(const DirIndex* idx) {
+    return idx->head->forward[0];
+}
+
+IndexEntry* dir_index_seek(const DirIndex* idx, const char* key, int inclusive) {
+    IndexEntry* e = find_less(idx, key, NULL)->forward[0];
+    if (!inclusive) {
+        while (e && strcmp(e->name, key) == 0) e = e->forward[0];
+    }
+    return e;
+}
+
+size_t dir_index_prefix(const DirIndex* idx, const char* prefix, size_t limit,
+                        void (*visit)(const IndexEntry* e, void* ctx), void* ctx) {
+    size_t len = strlen(prefix);
+    size_t n = 0;
+    for (IndexEntry* e = dir_index_seek(idx, prefix, 1); e; e = e->forward[0]) {
+        if (strncmp(e->name, prefix, len) != 0) break;
+        if (limit && n >= limit) break;
+        visit(e, ctx);
+        ++n;
+    }
+    return n;
+}
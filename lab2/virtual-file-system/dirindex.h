@@ -0,0 +1,54 @@
+#ifndef DIRINDEX_H
+#define DIRINDEX_H
+
+#include <stddef.h>
+
+#define DIR_INDEX_MAX_LEVEL 16
+
+// One entry of a directory's ordered index (a skip list node).
+// `name` points at the name stored in the File/Directory itself.
+typedef struct IndexEntry {
+    const char* name;
+    int is_dir;
+    void* node;            // Directory* or File*
+    int level;
+    struct IndexEntry* forward[];
+} IndexEntry;
+
+// Per-directory ordered index over subdirs and files, sorted by name.
+// Lookups, seeks and removals are O(log n).
+typedef struct DirIndex {
+    IndexEntry* head;
+    int level;
+    size_t count;
+} DirIndex;
+
+void dir_index_init(DirIndex* idx);
+void dir_index_free(DirIndex* idx);
+
+// Insert an entry; an equal name is placed before existing equals so that
+// lookups return the most recently added node, like the sibling lists do.
+int dir_index_insert(DirIndex* idx, const char* name, int is_dir, void* node);
+
+// Remove the entry for exactly `node`. Returns 1 if it was found.
+int dir_index_remove(DirIndex* idx, const char* name, const void* node);
+
+// Find the node named `name` of the given kind (1 = dir, 0 = file).
+void* dir_index_find(const DirIndex* idx, const char* name, int is_dir);
+
+// First entry in name order (NULL if empty).
+IndexEntry* dir_index_first(const DirIndex* idx);
+
+// First entry whose name is > key (or >= key when inclusive).
+IndexEntry* dir_index_seek(const DirIndex* idx, const char* key, int inclusive);
+
+static inline IndexEntry* dir_index_next(const IndexEntry* e) {
+    return e->forward[0];
+}
+
+// Call visit() for every entry whose name starts with prefix, in order,
+// stopping after `limit` entries (0 = no limit). Returns entries visited.
+size_t dir_index_prefix(const DirIndex* idx, const char* prefix, size_t limit,
+                        void (*visit)(const IndexEntry* e, void* ctx), void* ctx);
+
+#endif // DIRINDEX_H
@@ -0,0 +1,173 @@
+#include "glob.h"
+#include <stdlib.h>
+#include <string.h>
+
+// One position of the pattern: `*`, or a set of bytes matching one char
+typedef struct Token {
+    int star;
+    uint8_t set[32];
+} Token;
+
+// --- helpers ---
+static void set_add(uint8_t* set, unsigned char c) { set[c >> 3] |= (uint8_t)(1u << (c & 7)); }
+static int set_has(const uint8_t* set, unsigned char c) { return (set[c >> 3] >> (c & 7)) & 1; }
+
+// Parse "[...]" at p (p[0] == '['); returns the char after ']', or NULL
+// if the class is unterminated (the '[' is then an ordinary char)
+static const char* parse_class(const char* p, uint8_t* set) {
+    memset(set, 0, 32);
+    const char* q = p + 1;
+    int negate = *q == '!' || *q == '^';
+    if (negate) ++q;
+    const char* first = q;
+    for (; *q && (*q != ']' || q == first); ++q) {
+        unsigned char lo = (unsigned char)*q;
+        if (lo == '\\' && q[1]) lo = (unsigned char)*++q;
+        if (q[1] == '-' && q[2] && q[2] != ']') {
+            unsigned char hi = (unsigned char)q[2];
+            q += 2;
+            if (hi == '\\' && q[1]) hi = (unsigned char)*++q;
+            for (unsigned c = lo; c <= hi; ++c) set_add(set, (unsigned char)c);
+        } else {
+            set_add(set, lo);
+        }
+    }
+    if (*q != ']') return NULL;
+    if (negate) {
+        for (int i = 0; i < 32; ++i) set[i] = (uint8_t)~set[i];
+    }
+    set[0] &= (uint8_t)~1u; // never NUL
+    return q + 1;
+}
+
+// Next token at *pp; returns 0 at the end. *literal gets the char of a
+// literal token, 0 for a wildcard.
+static int next_token(const char** pp, Token* t, int* literal) {
+    const char* p = *pp;
+    if (!*p) return 0;
+    memset(t, 0, sizeof(*t));
+    *literal = 0;
+    if (*p == '*') {
+        t->star = 1;
+        while (*p == '*') ++p;
+    } else if (*p == '?') {
+        memset(t->set, 0xff, sizeof(t->set));
+        t->set[0] &= (uint8_t)~1u;
+        ++p;
+    } else if (*p == '[' && parse_class(p, t->set)) {
+        p = parse_class(p, t->set);
+    } else {
+        if (*p == '\\' && p[1]) ++p;
+        *literal = (unsigned char)*p;
+        set_add(t->set, (unsigned char)*p++);
+    }
+    *pp = p;
+    return 1;
+}
+
+// Add the positions reachable by letting a `*` match nothing
+static uint64_t closure(const Token* tok, int n, uint64_t s) {
+    for (int i = 0; i < n; ++i) {
+        if (((s >> i) & 1) && tok[i].star) s |= 1ull << (i + 1);
+    }
+    return s;
+}
+
+static uint64_t step(const Token* tok, int n, uint64_t s, unsigned char c) {
+    uint64_t t = 0;
+    for (int i = 0; i < n; ++i) {
+        if (!((s >> i) & 1)) continue;
+        if (tok[i].star) t |= 1ull << i;
+        else if (set_has(tok[i].set, c)) t |= 1ull << (i + 1);
+    }
+    return closure(tok, n, t);
+}
+
+// === Public ===
+int glob_has_magic(const char* s) {
+    return strpbrk(s, "*?[\\") != NULL;
+}
+
+int glob_compile(Glob* g, const char* pattern) {
+    memset(g, 0, sizeof(*g));
+    const char* p = pattern;
+    Token t;
+    int literal;
+
+    // Literal prefix
+    for (const char* q = p; next_token(&q, &t, &literal) && literal; p = q) {
+        if (g->prefix_len + 1 >= sizeof(g->prefix)) return -1;
+        g->prefix[g->prefix_len++] = (char)literal;
+    }
+    g->prefix[g->prefix_len] = '\0';
+
+    Token tok[GLOB_MAX_TOKENS];
+    int n = 0;
+    while (next_token(&p, &t, &literal)) {
+        if (n == GLOB_MAX_TOKENS) return -1;
+        tok[n++] = t;
+    }
+
+    // Bytes that every token treats alike share a class
+    uint64_t sig_of_class[256];
+    for (int c = 0; c < 256; ++c) {
+        uint64_t sig = 0;
+        for (int i = 0; i < n; ++i) {
+            if (!tok[i].star && set_has(tok[i].set, (unsigned char)c)) sig |= 1ull << i;
+        }
+        int k = 0;
+        while (k < g->nclasses && sig_of_class[k] != sig) ++k;
+        if (k == g->nclasses) sig_of_class[g->nclasses++] = sig;
+        g->byte_class[c] = (uint8_t)k;
+    }
+    unsigned char rep[256];
+    for (int c = 255; c >= 0; --c) rep[g->byte_class[c]] = (unsigned char)c;
+
+    // Subset construction; state i is the set of pattern positions reached
+    uint64_t sets[GLOB_MAX_STATES];
+    g->next = (uint16_t*)calloc((size_t)GLOB_MAX_STATES * g->nclasses, sizeof(uint16_t));
+    g->accept = (uint8_t*)calloc(GLOB_MAX_STATES, 1);
+    if (!g->next || !g->accept) {
+        glob_free(g);
+        return -1;
+    }
+    sets[0] = 0;
+    sets[1] = closure(tok, n, 1);
+    g->nstates = 2;
+    g->start = 1;
+    for (int s = 1; s < g->nstates; ++s) {
+        g->accept[s] = (uint8_t)((sets[s] >> n) & 1);
+        for (int k = 0; k < g->nclasses; ++k) {
+            uint64_t to = step(tok, n, sets[s], rep[k]);
+            int d = 0;
+            while (d < g->nstates && sets[d] != to) ++d;
+            if (d == g->nstates) {
+                if (d == GLOB_MAX_STATES) {
+                    glob_free(g);
+                    return -1;
+                }
+                sets[g->nstates++] = to;
+            }
+            g->next[s * g->nclasses + k] = (uint16_t)d;
+        }
+    }
+    return 0;
+}
+
+void glob_free(Glob* g) {
+    free(g->next);
+    free(g->accept);
+    g->next = NULL;
+    g->accept = NULL;
+}
+
+int glob_match(const Glob* g, const char* name) {
+    if (name[0] == '.' && g->prefix[0] != '.') return 0;
+    if (strncmp(name, g->prefix, g->prefix_len) != 0) return 0;
+    int s = g->start;
+    for (const unsigned char* p = (const unsigned char*)name + g->prefix_len; *p; ++p) {
+        s = g->next[s * g->nclasses + g->byte_class[*p]];
+        if (!s) return 0;
+    }
+    return g->accept[s];
+}
@@ -0,0 +1,42 @@
+#ifndef GLOB_H
+#define GLOB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Shell wildcards over the names of one directory: `*`, `?`, `[abc]`,
+// `[a-z]`, `[!x]` (or `[^x]`), and `\` to quote the next character.
+//
+// A pattern is compiled once. The literal text before its first wildcard
+// becomes `prefix`, which callers feed to the directory's name index
+// (dir_index_seek) so only names that start with it are ever looked at.
+// The rest is turned into a DFA over byte classes, so matching a
+// candidate is one table lookup per remaining byte.
+//
+// As in the shell, a leading '.' is only matched by a literal '.'.
+
+#define GLOB_MAX_TOKENS 63     // wildcards and literals after the prefix
+#define GLOB_MAX_STATES 256
+
+typedef struct Glob {
+    char prefix[128];          // literal text every match starts with
+    size_t prefix_len;
+    uint8_t byte_class[256];   // byte -> column of `next`
+    int nclasses;
+    int nstates;               // state 0 rejects everything
+    int start;
+    uint16_t* next;            // nstates * nclasses transitions
+    uint8_t* accept;
+} Glob;
+
+// 1 if `s` contains a wildcard (otherwise it only names itself)
+int glob_has_magic(const char* s);
+
+// 0 on success; -1 if the pattern is too long or too complex
+int glob_compile(Glob* g, const char* pattern);
+void glob_free(Glob* g);
+
+// Whole-name match
+int glob_match(const Glob* g, const char* name);
+
+#endif // GLOB_H
@@ -0,0 +1,208 @@
+#define _GNU_SOURCE
+#include "grep.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "workers.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GREP_X86 1
+#endif
+
+// === Kernels ===
+static const char* find_scalar(const char* hay, size_t len, const char* pat, size_t plen) {
+    for (size_t i = 0; i + plen <= len; ++i) {
+        size_t k = 0;
+        while (k < plen && hay[i + k] == pat[k]) ++k;
+        if (k == plen) return hay + i;
+    }
+    return NULL;
+}
+
+#ifdef GREP_X86
+// Candidates are positions where both the first and the last byte of the
+// pattern line up; the bytes in between are checked with memcmp. After
+// the last full block the scalar loop takes the tail. plen >= 2 (one
+// byte goes to memchr).
+static const char* find_sse2(const char* hay, size_t len, const char* pat, size_t plen) {
+    const __m128i first = _mm_set1_epi8(pat[0]);
+    const __m128i last = _mm_set1_epi8(pat[plen - 1]);
+    size_t i = 0;
+    for (; i + plen - 1 + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(hay + i + plen - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                                  _mm_cmpeq_epi8(b, last)));
+        for (; mask; mask &= mask - 1) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(hay + at + 1, pat + 1, plen - 2) == 0) return hay + at;
+        }
+    }
+    return find_scalar(hay + i, len - i, pat, plen);
+}
+
+__attribute__((target("avx2")))
+static const char* find_avx2(const char* hay, size_t len, const char* pat, size_t plen) {
+    const __m256i first = _mm256_set1_epi8(pat[0]);
+    const __m256i last = _mm256_set1_epi8(pat[plen - 1]);
+    size_t i = 0;
+    for (; i + plen - 1 + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(hay + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(hay + i + plen - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                                                        _mm256_cmpeq_epi8(b, last)));
+        for (; mask; mask &= mask - 1) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(hay + at + 1, pat + 1, plen - 2) == 0) return hay + at;
+        }
+    }
+    return find_scalar(hay + i, len - i, pat, plen);
+}
+#endif
+
+// === Dispatch ===
+int grep_impl_supported(GrepImpl impl) {
+    switch (impl) {
+    case GREP_IMPL_SCALAR:
+    case GREP_IMPL_LIBC: return 1;
+#ifdef GREP_X86
+    case GREP_IMPL_SSE2: return __builtin_cpu_supports("sse2");
+    case GREP_IMPL_AVX2: return __builtin_cpu_supports("avx2");
+#else
+    default: return 0;
+#endif
+    }
+    return 0;
+}
+
+GrepImpl grep_best_impl(void) {
+    if (grep_impl_supported(GREP_IMPL_AVX2)) return GREP_IMPL_AVX2;
+    if (grep_impl_supported(GREP_IMPL_SSE2)) return GREP_IMPL_SSE2;
+    return GREP_IMPL_LIBC;
+}
+
+const char* grep_impl_name(GrepImpl impl) {
+    switch (impl) {
+    case GREP_IMPL_SCALAR: return "scalar";
+    case GREP_IMPL_LIBC: return "memmem";
+    case GREP_IMPL_SSE2: return "sse2";
+    case GREP_IMPL_AVX2: return "avx2";
+    }
+    return "?";
+}
+
+const char* grep_find(GrepImpl impl, const char* hay, size_t len, const char* pat, size_t plen) {
+    if (plen == 0) return hay;
+    if (plen > len) return NULL;
+    if (plen == 1 && impl != GREP_IMPL_SCALAR) return (const char*)memchr(hay, pat[0], len);
+    switch (impl) {
+    case GREP_IMPL_LIBC: return (const char*)memmem(hay, len, pat, plen);
+#ifdef GREP_X86
+    case GREP_IMPL_SSE2: return find_sse2(hay, len, pat, plen);
+    case GREP_IMPL_AVX2: return find_avx2(hay, len, pat, plen);
+#endif
+    default: return find_scalar(hay, len, pat, plen);
+    }
+}
+
+// === Files ===
+typedef struct GrepJob {
+    const char* const* data;
+    const uint32_t* size;
+    size_t begin, end;     // files [begin, end)
+    const char* pat;
+    size_t plen;
+    GrepImpl impl;
+    GrepHit* hits;
+    size_t nhits, cap;
+    int oom;
+} GrepJob;
+
+static void add_hit(GrepJob* j, uint32_t file, uint32_t line, size_t start, size_t len) {
+    if (j->nhits == j->cap) {
+        size_t cap = j->cap ? j->cap * 2 : 64;
+        GrepHit* h = (GrepHit*)realloc(j->hits, cap * sizeof(GrepHit));
+        if (!h) {
+            j->oom = 1;
+            return;
+        }
+        j->hits = h;
+        j->cap = cap;
+    }
+    j->hits[j->nhits++] = (GrepHit){ file, line, (uint32_t)start, (uint32_t)len };
+}
+
+// Each match is widened to its line; the search resumes after that line,
+// so a line is reported once however often it matches
+static void* grep_run(void* arg) {
+    GrepJob* j = (GrepJob*)arg;
+    for (size_t f = j->begin; f < j->end && !j->oom; ++f) {
+        const char* s = j->data[f];
+        size_t len = j->size[f], pos = 0, counted = 0;
+        uint32_t line = 1;
+        while (pos < len) {
+            const char* m = grep_find(j->impl, s + pos, len - pos, j->pat, j->plen);
+            if (!m) break;
+            size_t at = (size_t)(m - s);
+            for (; counted < at; ++counted) line += s[counted] == '\n';
+            size_t start = at;
+            while (start > 0 && s[start - 1] != '\n') --start;
+            const char* nl = (const char*)memchr(s + at, '\n', len - at);
+            size_t end = nl ? (size_t)(nl - s) : len;
+            add_hit(j, (uint32_t)f, line, start, end - start);
+            pos = end + 1;
+        }
+    }
+    return NULL;
+}
+
+int grep_thread_count(uint64_t bytes, int threads) {
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > GREP_MAX_THREADS) threads = GREP_MAX_THREADS;
+    uint64_t by_size = bytes / GREP_MIN_BYTES + 1;
+    if ((uint64_t)threads > by_size) threads = (int)by_size;
+    return threads < 1 ? 1 : threads;
+}
+
+long grep_files(const char* const* data, const uint32_t* size, size_t n, const char* pat,
+                GrepImpl impl, int threads, GrepHit** hits) {
+    *hits = NULL;
+    if (!grep_impl_supported(impl)) impl = GREP_IMPL_SCALAR;
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; ++i) total += size[i];
+    threads = grep_thread_count(total, threads);
+
+    // Contiguous runs of files, cut at even byte offsets
+    GrepJob jobs[GREP_MAX_THREADS];
+    memset(jobs, 0, sizeof(jobs));
+    size_t f = 0;
+    uint64_t seen = 0;
+    for (int t = 0; t < threads; ++t) {
+        uint64_t target = total / (uint64_t)threads * (uint64_t)(t + 1);
+        jobs[t] = (GrepJob){ data, size, f, f, pat, strlen(pat), impl, NULL, 0, 0, 0 };
+        while (f < n && (t == threads - 1 || seen < target)) seen += size[f++];
+        jobs[t].end = f;
+    }
+
+    workers_run(grep_run, jobs, sizeof(GrepJob), threads);
+
+    size_t count = 0;
+    int oom = 0;
+    for (int t = 0; t < threads; ++t) {
+        count += jobs[t].nhits;
+        oom |= jobs[t].oom;
+    }
+    GrepHit* all = oom ? NULL : (GrepHit*)malloc(count * sizeof(GrepHit) + 1);
+    if (all) {
+        size_t at = 0;
+        for (int t = 0; t < threads; ++t) {
+            if (jobs[t].nhits) memcpy(all + at, jobs[t].hits, jobs[t].nhits * sizeof(GrepHit));
+            at += jobs[t].nhits;
+        }
+    }
+    for (int t = 0; t < threads; ++t) free(jobs[t].hits);
+    if (!all) return -1;
+    *hits = all;
+    return (long)count;
+}
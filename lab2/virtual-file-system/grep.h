@@ -0,0 +1,50 @@
+#ifndef GREP_H
+#define GREP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Literal substring search over file contents. The SIMD kernels compare
+// the pattern's first and last byte against 16 (SSE2) or 32 (AVX2)
+// positions at once and only memcmp the candidates both agree on; the
+// best one is picked at runtime, as in scan.h. The file set is cut into
+// contiguous runs of about equal bytes, one per thread, so the hits come
+// out in file order without sorting.
+
+#define GREP_MAX_THREADS 16
+#define GREP_MIN_BYTES (256 * 1024)   // per thread; less is searched inline
+
+typedef enum {
+    GREP_IMPL_SCALAR,   // byte-at-a-time compare, the plain sequential scan
+    GREP_IMPL_LIBC,     // memmem()
+    GREP_IMPL_SSE2,
+    GREP_IMPL_AVX2
+} GrepImpl;
+
+GrepImpl grep_best_impl(void);
+int grep_impl_supported(GrepImpl impl);
+const char* grep_impl_name(GrepImpl impl);
+
+// First occurrence of pat in hay[0..len), or NULL
+const char* grep_find(GrepImpl impl, const char* hay, size_t len, const char* pat, size_t plen);
+
+// One matching line: file index, 1-based line number, and the line's
+// bytes within that file's content (without the '\n')
+typedef struct GrepHit {
+    uint32_t file;
+    uint32_t line;
+    uint32_t start, len;
+} GrepHit;
+
+// Threads grep_files would use for `bytes` of content when asked for
+// `threads` (<= 0: one per CPU)
+int grep_thread_count(uint64_t bytes, int threads);
+
+// Search data[i] (size[i] bytes) for every i < n with up to `threads`
+// threads (<= 0: one per CPU). One hit per matching line, in file and
+// line order, in *hits (caller frees). Returns the number of hits, or -1
+// if out of memory.
+long grep_files(const char* const* data, const uint32_t* size, size_t n, const char* pat,
+                GrepImpl impl, int threads, GrepHit** hits);
+
+#endif // GREP_H
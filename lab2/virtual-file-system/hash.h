@@ -0,0 +1,36 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// FNV-1a, the hash behind every in-memory table here (and ugstore's on-disk
+// index and checksums, so its output must never change). The 32-bit form
+// can be fed in pieces: start from FNV1A32_INIT and pass each result back.
+
+#define FNV1A32_INIT  2166136261u
+#define FNV1A32_PRIME 16777619u
+#define FNV1A64_INIT  1469598103934665603ull
+#define FNV1A64_PRIME 1099511628211ull
+
+static inline uint32_t fnv1a32_update(uint32_t h, const void* p, size_t n) {
+    const unsigned char* b = (const unsigned char*)p;
+    for (size_t i = 0; i < n; ++i) h = (h ^ b[i]) * FNV1A32_PRIME;
+    return h;
+}
+
+// NUL-terminated string
+static inline uint32_t fnv1a32_str(const char* s) {
+    uint32_t h = FNV1A32_INIT;
+    for (; *s; ++s) h = (h ^ (unsigned char)*s) * FNV1A32_PRIME;
+    return h;
+}
+
+static inline uint64_t fnv1a64(const void* p, size_t n) {
+    const unsigned char* b = (const unsigned char*)p;
+    uint64_t h = FNV1A64_INIT;
+    for (size_t i = 0; i < n; ++i) h = (h ^ b[i]) * FNV1A64_PRIME;
+    return h;
+}
+
+#endif // HASH_H
@@ -0,0 +1,225 @@
+#include "import.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "loader.h"
+
+#define IMPORT_MAX_THREADS 8
+
+// A directory waiting to be read: its path relative to the import root
+typedef struct WalkJob {
+    char* rel;
+    ImportNode* node;
+    struct WalkJob* next;
+} WalkJob;
+
+typedef struct Walk {
+    int root_fd;
+    WalkJob* queue;
+    size_t pending;        // queued + being read
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    ImportTree* tree;
+} Walk;
+
+// --- helpers ---
+// Names the VFS can hold: they are written space-separated to vfs.txt
+static int usable_name(const char* name) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= sizeof(((ImportNode*)0)->name)) return 0;
+    for (const char* p = name; *p; ++p) {
+        if ((unsigned char)*p <= ' ' || *p == '/') return 0;
+    }
+    return 1;
+}
+
+static int mode_digits(mode_t m) {
+    return (int)(((m >> 6) & 7) * 100 + ((m >> 3) & 7) * 10 + (m & 7));
+}
+
+// Content is kept as one line of text: control characters become spaces
+// and files with NUL bytes (binary) come in empty.
+static char* read_content(int dfd, const char* name, size_t* len_out) {
+    *len_out = 0;
+    int fd = openat(dfd, name, O_RDONLY | O_NOFOLLOW | O_NOCTTY);
+    if (fd < 0) return NULL;
+    char buf[LOADER_CONTENT_MAX];
+    size_t len = 0;
+    while (len < sizeof(buf)) {
+        ssize_t n = read(fd, buf + len, sizeof(buf) - len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        len += (size_t)n;
+    }
+    close(fd);
+    if (len == 0 || memchr(buf, '\0', len)) return NULL;
+    for (size_t i = 0; i < len; ++i) {
+        if ((unsigned char)buf[i] < ' ') buf[i] = ' ';
+    }
+    char* s = (char*)malloc(len + 1);
+    if (!s) return NULL;
+    memcpy(s, buf, len);
+    s[len] = '\0';
+    *len_out = len;
+    return s;
+}
+
+static void push_job(Walk* w, char* rel, ImportNode* node) {
+    WalkJob* job = (WalkJob*)malloc(sizeof(WalkJob));
+    if (!job) {
+        free(rel);
+        __atomic_add_fetch(&w->tree->skipped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    job->rel = rel;
+    job->node = node;
+    pthread_mutex_lock(&w->lock);
+    job->next = w->queue;
+    w->queue = job;
+    w->pending++;
+    pthread_cond_signal(&w->cv);
+    pthread_mutex_unlock(&w->lock);
+}
+
+// Read one directory: files are loaded here, subdirectories become jobs.
+// Only this thread links children under job->node.
+static void read_dir(Walk* w, WalkJob* job) {
+    ImportTree* tree = w->tree;
+    int dfd = openat(w->root_fd, job->rel, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    DIR* d = dfd >= 0 ? fdopendir(dfd) : NULL;
+    if (!d) {
+        if (dfd >= 0) close(dfd);
+        __atomic_add_fetch(&tree->skipped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+        struct stat st;
+        if (!usable_name(e->d_name) || fstatat(dfd, e->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 ||
+            !(S_ISDIR(st.st_mode) || S_ISREG(st.st_mode))) {
+            __atomic_add_fetch(&tree->skipped, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        ImportNode* n = (ImportNode*)calloc(1, sizeof(ImportNode));
+        if (!n) {
+            __atomic_add_fetch(&tree->skipped, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        strcpy(n->name, e->d_name);
+        n->is_dir = S_ISDIR(st.st_mode);
+        n->uid = st.st_uid;
+        n->gid = st.st_gid;
+        n->perm = mode_digits(st.st_mode);
+        n->next = job->node->children;
+        job->node->children = n;
+
+        if (n->is_dir) {
+            size_t len = strlen(job->rel) + 1 + strlen(e->d_name) + 1;
+            char* rel = (char*)malloc(len);
+            if (rel) {
+                snprintf(rel, len, "%s/%s", job->rel, e->d_name);
+                push_job(w, rel, n);
+            }
+            __atomic_add_fetch(&tree->dirs, 1, __ATOMIC_RELAXED);
+        } else {
+            size_t len;
+            n->content = read_content(dfd, e->d_name, &len);
+            __atomic_add_fetch(&tree->files, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&tree->bytes, len, __ATOMIC_RELAXED);
+        }
+    }
+    closedir(d);
+}
+
+static void* walk_worker(void* arg) {
+    Walk* w = (Walk*)arg;
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (!w->queue && w->pending > 0) pthread_cond_wait(&w->cv, &w->lock);
+        if (!w->queue) break; // nothing queued and nothing in flight: done
+        WalkJob* job = w->queue;
+        w->queue = job->next;
+        pthread_mutex_unlock(&w->lock);
+
+        read_dir(w, job);
+        free(job->rel);
+        free(job);
+
+        pthread_mutex_lock(&w->lock);
+        if (--w->pending == 0) pthread_cond_broadcast(&w->cv);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+// === Public ===
+int import_walk(const char* host_path, int threads, ImportTree* out) {
+    memset(out, 0, sizeof(*out));
+    int fd = open(host_path, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return -1;
+    struct stat st;
+    out->root = (ImportNode*)calloc(1, sizeof(ImportNode));
+    char* rel = strdup(".");
+    if (!out->root || !rel || fstat(fd, &st) != 0) {
+        free(rel);
+        close(fd);
+        import_tree_free(out);
+        errno = ENOMEM;
+        return -1;
+    }
+    out->root->is_dir = 1;
+    out->root->uid = st.st_uid;
+    out->root->gid = st.st_gid;
+    out->root->perm = mode_digits(st.st_mode);
+
+    Walk w;
+    w.root_fd = fd;
+    w.queue = NULL;
+    w.pending = 0;
+    w.tree = out;
+    pthread_mutex_init(&w.lock, NULL);
+    pthread_cond_init(&w.cv, NULL);
+    push_job(&w, rel, out->root);
+
+    // Mostly waiting on the kernel, so use a few threads even on one CPU
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN) * 2;
+    if (threads > IMPORT_MAX_THREADS) threads = IMPORT_MAX_THREADS;
+    if (threads < 1) threads = 1;
+    pthread_t tids[IMPORT_MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; ++i) {
+        if (pthread_create(&tids[started], NULL, walk_worker, &w) == 0) ++started;
+    }
+    walk_worker(&w);
+    for (int i = 0; i < started; ++i) pthread_join(tids[i], NULL);
+
+    pthread_mutex_destroy(&w.lock);
+    pthread_cond_destroy(&w.cv);
+    close(fd);
+    return 0;
+}
+
+void import_tree_free(ImportTree* tree) {
+    // Iterative: splice children onto a work list linked through `next`
+    ImportNode* stack = tree->root;
+    while (stack) {
+        ImportNode* n = stack;
+        stack = n->next;
+        while (n->children) {
+            ImportNode* c = n->children;
+            n->children = c->next;
+            c->next = stack;
+            stack = c;
+        }
+        free(n->content);
+        free(n);
+    }
+    tree->root = NULL;
+}
@@ -0,0 +1,36 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Parallel walk of a host directory into a staging tree. Directories are
+// read by a pool of threads (openat relative to the import root, so deep
+// trees need no long paths); nothing touches the VFS until the caller
+// turns the staging tree into nodes in one pass.
+
+typedef struct ImportNode {
+    char name[100];
+    int is_dir;
+    uid_t uid;             // host ids; mapped to VFS names by the caller
+    gid_t gid;
+    int perm;              // permission digits, e.g. 644
+    char* content;         // files only; NULL when empty
+    struct ImportNode* children;
+    struct ImportNode* next;
+} ImportNode;
+
+typedef struct ImportTree {
+    ImportNode* root;
+    size_t dirs;           // not counting the root
+    size_t files;
+    size_t bytes;          // content bytes kept
+    size_t skipped;        // symlinks, devices, unreadable or unnamable entries
+} ImportTree;
+
+// Walk host_path with up to `threads` workers (0 = pick). Returns 0 on
+// success, -1 with errno set if host_path is not a readable directory.
+int import_walk(const char* host_path, int threads, ImportTree* out);
+void import_tree_free(ImportTree* tree);
+
+#endif // IMPORT_H
@@ -0,0 +1,328 @@
+#include "inode.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "hash.h"
+#include "quota.h"
+#include "store.h"
+#include "wordindex.h"
+#include "../stats/stats.h"
+
+InodeTable inodes = { 0 };
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+void inode_lock(void) { pthread_mutex_lock(&lock); }
+void inode_unlock(void) { pthread_mutex_unlock(&lock); }
+
+// Accounting generations (see inode_acct_begin). Written under the lock.
+// charge() reads them without it for an inode the caller owns: acct_live
+// only changes on the session thread, the others only between builds.
+static uint16_t acct_live = 0;         // usage goes to the live quota table
+static uint16_t acct_last = 0;         // last generation handed out
+static uint16_t acct_pending = 0;      // the build whose usage goes to acct_ledger
+static QuotaLedger* acct_ledger = NULL;
+static __thread int acct_building = 0; // this thread's inodes belong to acct_pending
+
+// --- helpers ---
+// Each column is one address-space reservation sized for INODE_MAX slots;
+// pages are only backed once touched. Columns therefore never move.
+static void* reserve(size_t bytes) {
+    void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+#define RESERVE(arr) do { \
+        if (!((arr) = reserve((size_t)INODE_MAX * sizeof(*(arr))))) return 0; \
+    } while (0)
+
+// Caller holds lock. The first call reserves every column; later ones
+// only raise cap (kept doubling so inode_table_bytes tracks what is used).
+static int grow_table(void) {
+    if (inodes.cap == 0) {
+        RESERVE(inodes.perm);
+        RESERVE(inodes.mode);
+        RESERVE(inodes.is_dir);
+        RESERVE(inodes.uid);
+        RESERVE(inodes.gid);
+        RESERVE(inodes.nlink);
+        RESERVE(inodes.size);
+        RESERVE(inodes.data);
+        RESERVE(inodes.acct);
+        RESERVE(inodes.extent);
+        RESERVE(inodes.entry);
+        RESERVE(inodes.free_slots);
+        inodes.used = 1; // slot 0 is INODE_NONE, never live
+        inodes.cap = 1024;
+        return 1;
+    }
+    if (inodes.cap >= INODE_MAX) return 0;
+    inodes.cap = inodes.cap * 2 < INODE_MAX ? inodes.cap * 2 : INODE_MAX;
+    return 1;
+}
+
+// Usage of ino goes where its generation is counted: the live table, the
+// ledger of the tree being built, or nowhere (an old or discarded tree)
+static void charge(uint32_t ino, const char* owner, int64_t count, int64_t bytes) {
+    if (inodes.acct[ino] == acct_live) quota_charge(owner, count, bytes);
+    else if (acct_ledger && inodes.acct[ino] == acct_pending) quota_ledger_charge(acct_ledger, owner, count, bytes);
+}
+
+// Caller holds lock
+static void release(uint32_t ino) {
+    int64_t bytes = inodes.size[ino];
+    wordindex_update(ino, inode_data(ino), inodes.size[ino], "", 0);
+    charge(ino, ident_name(inodes.uid[ino]), -1, -bytes);
+    stats_add(STAT_CONTENT_BYTES, -bytes);
+    free(inodes.data[ino]);
+    inodes.data[ino] = NULL;
+    store_free(inodes.extent[ino], inodes.size[ino]);
+    inodes.extent[ino] = 0;
+    inodes.entry[ino] = NULL;
+    inodes.size[ino] = 0;
+    inodes.free_slots[inodes.free_count++] = ino;
+    inodes.live--;
+}
+
+// === Lifecycle ===
+uint32_t inode_alloc(int is_dir, const char* owner, const char* group, int perm) {
+    uint32_t uid = ident_intern(owner), gid = ident_intern(group);
+    pthread_mutex_lock(&lock);
+    uint32_t ino;
+    if (inodes.free_count) {
+        ino = inodes.free_slots[--inodes.free_count];
+    } else {
+        if (inodes.used >= inodes.cap && !grow_table()) {
+            pthread_mutex_unlock(&lock);
+            return INODE_NONE;
+        }
+        ino = inodes.used++;
+    }
+    inode_set_perm(ino, perm);
+    inodes.is_dir[ino] = (uint8_t)(is_dir != 0);
+    inodes.uid[ino] = uid;
+    inodes.gid[ino] = gid;
+    inodes.nlink[ino] = 1;
+    inodes.size[ino] = 0;
+    inodes.data[ino] = NULL;
+    inodes.extent[ino] = 0;
+    inodes.entry[ino] = NULL;
+    inodes.acct[ino] = acct_building ? acct_pending : acct_live;
+    inodes.live++;
+    charge(ino, owner, 1, 0);
+    pthread_mutex_unlock(&lock);
+    return ino;
+}
+
+void inode_link(uint32_t ino) {
+    pthread_mutex_lock(&lock);
+    inodes.nlink[ino]++;
+    pthread_mutex_unlock(&lock);
+}
+
+uint32_t inode_unlink(uint32_t ino) {
+    pthread_mutex_lock(&lock);
+    uint32_t left = --inodes.nlink[ino];
+    if (left == 0) release(ino);
+    pthread_mutex_unlock(&lock);
+    return left;
+}
+
+void inode_set_perm(uint32_t ino, int perm) {
+    inodes.perm[ino] = (uint16_t)perm;
+    inodes.mode[ino] = (uint16_t)((perm / 100 % 10) << 6 | (perm / 10 % 10) << 3 | (perm % 10));
+}
+
+// === Content ===
+// Content goes to the store while it is open, else to the heap. Store
+// extents are never rewritten in place: the snapshot may still name the
+// old one. `reindex`: the words changed (not just where they live).
+static int put_content(uint32_t ino, const char* data, size_t len, int to_store, int reindex) {
+    char* copy = NULL;
+    uint32_t block = 0;
+    if (len && to_store) {
+        block = store_alloc(len);
+        if (!block) return 0;
+        memcpy(store_ptr(block), data, len);
+        store_ptr(block)[len] = '\0';
+        store_dirty(block, len);
+    } else if (len) {
+        copy = (char*)malloc(len + 1);
+        if (!copy) return 0;
+        memcpy(copy, data, len);
+        copy[len] = '\0';
+    }
+    if (reindex) wordindex_update(ino, inode_data(ino), inodes.size[ino], data, len);
+    free(inodes.data[ino]);
+    store_free(inodes.extent[ino], inodes.size[ino]);
+    inodes.data[ino] = copy;
+    inodes.extent[ino] = block;
+    return 1;
+}
+
+static void charge_size(uint32_t ino, size_t len) {
+    int64_t delta = (int64_t)len - (int64_t)inodes.size[ino];
+    inodes.size[ino] = (uint32_t)len;
+    stats_add(STAT_CONTENT_BYTES, delta);
+    charge(ino, inode_owner(ino), 0, delta);
+}
+
+int inode_set_data(uint32_t ino, const char* data) {
+    size_t len = strlen(data);
+    // put_content frees the old extent by the old size
+    if (!put_content(ino, data, len, store_is_open(), 1)) return 0;
+    charge_size(ino, len);
+    return 1;
+}
+
+void inode_adopt_extent(uint32_t ino, uint32_t block, uint32_t size) {
+    wordindex_update(ino, inode_data(ino), inodes.size[ino], store_ptr(block), size);
+    put_content(ino, "", 0, 0, 0);
+    inodes.extent[ino] = block;
+    charge_size(ino, size);
+}
+
+const char* inode_data(uint32_t ino) {
+    if (inodes.extent[ino]) return store_ptr(inodes.extent[ino]);
+    return inodes.data[ino] ? inodes.data[ino] : "";
+}
+
+long inode_store_migrate(int to_store) {
+    long moved = 0;
+    pthread_mutex_lock(&lock); // includes subtrees waiting for the reaper
+    for (uint32_t ino = 1; ino < inodes.used; ++ino) {
+        if (!inodes.nlink[ino] || inodes.is_dir[ino] || !inodes.size[ino]) continue;
+        if ((inodes.extent[ino] != 0) == (to_store != 0)) continue;
+        if (!put_content(ino, inode_data(ino), inodes.size[ino], to_store, 0)) {
+            moved = -1;
+            break;
+        }
+        ++moved;
+    }
+    pthread_mutex_unlock(&lock);
+    return moved;
+}
+
+// === Ownership ===
+void inode_chown(uint32_t ino, const char* owner, const char* group) {
+    if (owner && *owner) {
+        charge(ino, inode_owner(ino), -1, -(int64_t)inodes.size[ino]);
+        charge(ino, owner, 1, inodes.size[ino]);
+        inodes.uid[ino] = ident_intern(owner);
+    }
+    if (group && *group) inodes.gid[ino] = ident_intern(group);
+}
+
+size_t inode_table_bytes(void) {
+    size_t per_slot = sizeof(*inodes.perm) + sizeof(*inodes.mode) + sizeof(*inodes.is_dir) +
+                      sizeof(*inodes.uid) + sizeof(*inodes.gid) + sizeof(*inodes.nlink) + sizeof(*inodes.size) +
+                      sizeof(*inodes.data) + sizeof(*inodes.extent) + sizeof(*inodes.entry) +
+                      sizeof(*inodes.acct) + sizeof(*inodes.free_slots);
+    return (size_t)inodes.cap * per_slot;
+}
+
+// === Accounting generations ===
+void inode_acct_begin(QuotaLedger* ledger) {
+    pthread_mutex_lock(&lock);
+    if (acct_ledger) quota_ledger_free(acct_ledger);
+    if (++acct_last == acct_live) ++acct_last;
+    acct_pending = acct_last;
+    acct_ledger = ledger;
+    acct_building = 1;
+    pthread_mutex_unlock(&lock);
+}
+
+void inode_acct_end(void) {
+    acct_building = 0;
+}
+
+void inode_acct_adopt(void) {
+    pthread_mutex_lock(&lock);
+    if (acct_ledger) {
+        acct_live = acct_pending;
+        quota_ledger_adopt(acct_ledger);
+        acct_ledger = NULL;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void inode_acct_discard(void) {
+    pthread_mutex_lock(&lock);
+    quota_ledger_free(acct_ledger);
+    acct_ledger = NULL;
+    pthread_mutex_unlock(&lock);
+}
+
+// === Interned names ===
+// Names live in fixed chunks that never move, so ident_name() can be
+// called from any thread without the lock. The hash (name -> id + 1)
+// is only touched by ident_intern() under the lock.
+#define IDENT_CHUNK     256
+#define IDENT_MAX_CHUNKS 4096
+
+static char** ident_chunks[IDENT_MAX_CHUNKS];
+static uint32_t ident_count = 0;
+static uint32_t* ident_slots = NULL;
+static uint32_t ident_slot_cap = 0;
+static pthread_mutex_t ident_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Caller holds ident_lock. Keeps the load factor at most 1/2.
+static int ident_rehash(void) {
+    uint32_t n = ident_slot_cap ? ident_slot_cap * 2 : 64;
+    uint32_t* slots = (uint32_t*)calloc(n, sizeof(uint32_t));
+    if (!slots) return 0;
+    for (uint32_t id = 0; id < ident_count; ++id) {
+        uint32_t i = fnv1a32_str(ident_name(id)) & (n - 1);
+        while (slots[i]) i = (i + 1) & (n - 1);
+        slots[i] = id + 1;
+    }
+    free(ident_slots);
+    ident_slots = slots;
+    ident_slot_cap = n;
+    return 1;
+}
+
+uint32_t ident_intern(const char* name) {
+    pthread_mutex_lock(&ident_lock);
+    if ((ident_count + 1) * 2 > ident_slot_cap && !ident_rehash() && !ident_slot_cap) {
+        pthread_mutex_unlock(&ident_lock);
+        return 0;
+    }
+    uint32_t i = fnv1a32_str(name) & (ident_slot_cap - 1);
+    for (; ident_slots[i]; i = (i + 1) & (ident_slot_cap - 1)) {
+        uint32_t id = ident_slots[i] - 1;
+        if (strcmp(ident_name(id), name) == 0) {
+            pthread_mutex_unlock(&ident_lock);
+            return id;
+        }
+    }
+
+    uint32_t id = ident_count;
+    uint32_t chunk = id / IDENT_CHUNK;
+    char* copy = strdup(name);
+    if (chunk >= IDENT_MAX_CHUNKS || !copy) {
+        free(copy);
+        pthread_mutex_unlock(&ident_lock);
+        return 0; // out of ids: fall back to the first name ever interned
+    }
+    if (!ident_chunks[chunk]) {
+        char** c = (char**)calloc(IDENT_CHUNK, sizeof(char*));
+        if (!c) {
+            free(copy);
+            pthread_mutex_unlock(&ident_lock);
+            return 0;
+        }
+        __atomic_store_n(&ident_chunks[chunk], c, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&ident_chunks[chunk][id % IDENT_CHUNK], copy, __ATOMIC_RELEASE);
+    ident_slots[i] = id + 1;
+    __atomic_store_n(&ident_count, id + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&ident_lock);
+    return id;
+}
+
+const char* ident_name(uint32_t id) {
+    if (id >= __atomic_load_n(&ident_count, __ATOMIC_ACQUIRE)) return "?";
+    char** chunk = __atomic_load_n(&ident_chunks[id / IDENT_CHUNK], __ATOMIC_ACQUIRE);
+    return chunk[id % IDENT_CHUNK];
+}
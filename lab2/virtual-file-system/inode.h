@@ -0,0 +1,99 @@
+#ifndef INODE_H
+#define INODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "quota.h"
+
+// Inode table: node metadata lives in parallel arrays indexed by inode
+// number (structure of arrays), so a scan over one field walks contiguous
+// memory. Directory entries only carry a name and an inode number, which
+// is what lets several names share one file (hard links).
+//
+// The columns never move (see grow_table), so a slot can be read
+// without the lock by the thread that owns the node; allocation and
+// anything touching slots another thread may own take inode_lock(). That
+// is what lets reload build a whole tree on a background thread.
+
+#define INODE_NONE 0                // never handed out
+#define INODE_MAX  (1u << 25)       // slots reserved per column
+
+typedef struct InodeTable {
+    uint16_t* perm;        // permission digits as chmod takes them, e.g. 754
+    uint16_t* mode;        // the same as permission bits (0754), for scan.c
+    uint8_t* is_dir;
+    uint32_t* uid;         // interned owner name, see ident_name()
+    uint32_t* gid;         // interned group name
+    uint32_t* nlink;       // entries naming this inode; 0 = free slot
+    uint32_t* size;        // content bytes
+    char** data;           // heap content, NULL when empty or in the store
+    uint32_t* extent;      // first block of the content in store.c, 0 if none
+    void** entry;          // one entry naming it (Directory* or File*)
+    uint16_t* acct;        // accounting generation (see inode_acct_begin)
+    uint32_t cap;          // slots allocated
+    uint32_t used;         // high-water mark
+    uint32_t* free_slots;  // released inode numbers, reused first
+    uint32_t free_count;
+    uint32_t live;
+} InodeTable;
+
+extern InodeTable inodes;
+
+void inode_lock(void);
+void inode_unlock(void);
+
+// New inode with one link and no content; INODE_NONE on allocation failure
+uint32_t inode_alloc(int is_dir, const char* owner, const char* group, int perm);
+
+// Add a name for ino
+void inode_link(uint32_t ino);
+
+// Drop a name; the inode and its content are released with the last one.
+// Returns the links left. Takes the lock itself.
+uint32_t inode_unlink(uint32_t ino);
+
+// Change the permission digits (keeps perm and mode in step)
+void inode_set_perm(uint32_t ino, int perm);
+
+// Replace the content; 0 if out of memory (content unchanged)
+int inode_set_data(uint32_t ino, const char* data);
+
+// Content as a string ("" when empty)
+const char* inode_data(uint32_t ino);
+
+// Content lives in the store (see store.h) while it is open; these move
+// it. inode_adopt_extent takes over an extent a snapshot names (the
+// caller has claimed it). inode_store_migrate moves every live file's
+// content into (to_store) or out of the store; returns the files moved,
+// or -1 if it ran out of space (those already moved stay moved).
+void inode_adopt_extent(uint32_t ino, uint32_t block, uint32_t size);
+long inode_store_migrate(int to_store);
+
+// Change owner and/or group (NULL or "" keeps the current one)
+void inode_chown(uint32_t ino, const char* owner, const char* group);
+
+// Bytes held by the table itself (not content)
+size_t inode_table_bytes(void);
+
+// === Accounting generations ===
+// Quota usage of a tree built off to the side (load, reload) goes to a
+// ledger (quota.h) until the tree replaces the live one. inode_acct_begin
+// starts a generation for every inode the calling thread allocates until
+// inode_acct_end, charged to `ledger`. At the swap, inode_acct_adopt makes
+// that generation live and adopts the ledger; inode_acct_discard drops it
+// if the tree is thrown away. Inodes of any other generation (the old
+// tree, a discarded build) are released without touching usage.
+void inode_acct_begin(QuotaLedger* ledger);
+void inode_acct_end(void);
+void inode_acct_adopt(void);
+void inode_acct_discard(void);
+
+// === Interned user/group names ===
+// Owners and groups are stored as small ids; names are kept once.
+uint32_t ident_intern(const char* name);
+const char* ident_name(uint32_t id);
+
+static inline const char* inode_owner(uint32_t ino) { return ident_name(inodes.uid[ino]); }
+static inline const char* inode_group(uint32_t ino) { return ident_name(inodes.gid[ino]); }
+
+#endif // INODE_H
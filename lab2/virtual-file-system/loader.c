@@ -0,0 +1,233 @@
+#include "loader.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "workers.h"
+
+#define LOADER_MAX_THREADS 16
+#define LOADER_MIN_CHUNK   (256 * 1024)   // smaller files are not worth a thread
+
+// --- tokenizing ---
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Next space-separated token in [*s, end); 0 if the line has no more
+static int next_token(const char** s, const char* end, TextSlice* tok) {
+    const char* p = *s;
+    while (p < end && is_blank(*p)) ++p;
+    if (p == end) return 0;
+    const char* stop = (const char*)memchr(p, ' ', (size_t)(end - p));
+    if (!stop) stop = end;
+    const char* q = stop;
+    while (q > p && is_blank(q[-1])) --q; // trailing \r or tab before the separator
+    tok->p = p;
+    tok->len = (size_t)(q - p);
+    *s = stop;
+    return 1;
+}
+
+// Like %d / %lld: optional sign, at least one digit
+static int parse_ll(TextSlice t, long long* out) {
+    size_t i = 0;
+    int neg = 0;
+    if (i < t.len && (t.p[i] == '-' || t.p[i] == '+')) neg = t.p[i++] == '-';
+    if (i == t.len || t.p[i] < '0' || t.p[i] > '9') return 0;
+    long long v = 0;
+    for (; i < t.len && t.p[i] >= '0' && t.p[i] <= '9'; ++i) v = v * 10 + (t.p[i] - '0');
+    *out = neg ? -v : v;
+    return 1;
+}
+
+static int is_word(TextSlice t, const char* w) {
+    size_t n = strlen(w);
+    return t.len == n && memcmp(t.p, w, n) == 0;
+}
+
+static TextRecord* push(TextChunk* c) {
+    if (c->count == c->cap) {
+        size_t n = c->cap ? c->cap * 2 : 1024;
+        TextRecord* r = (TextRecord*)realloc(c->records, n * sizeof(TextRecord));
+        if (!r) {
+            c->failed = 1;
+            return NULL;
+        }
+        c->records = r;
+        c->cap = n;
+    }
+    TextRecord* rec = &c->records[c->count++];
+    memset(rec, 0, sizeof(*rec));
+    return rec;
+}
+
+// One line [s, end) without its '\n'. Returns 0 once the chunk must stop.
+static int parse_line(TextChunk* c, const char* s, const char* end) {
+    TextSlice type, t[6];
+    long long v;
+    if (!next_token(&s, end, &type)) return 1; // blank line
+
+    if (is_word(type, "FILE")) {
+        // path owner group perm content...; short lines are skipped
+        int n = 0;
+        while (n < 4 && next_token(&s, end, &t[n])) ++n;
+        if (n < 4 || !parse_ll(t[3], &v)) return 1;
+        TextRecord* r = push(c);
+        if (!r) return 0;
+        r->type = REC_FILE;
+        r->path = t[0];
+        r->owner = t[1];
+        r->group = t[2];
+        r->perm = (int)v;
+        // Content is everything after the run of spaces following perm
+        const char* p = s;
+        if (p < end && *p == ' ') {
+            while (p < end && *p == ' ') ++p;
+        } else {
+            p = end;
+        }
+        const char* cr = (const char*)memchr(p, '\r', (size_t)(end - p));
+        size_t len = (size_t)((cr ? cr : end) - p);
+        r->content.p = p;
+        r->content.len = len > LOADER_CONTENT_MAX ? LOADER_CONTENT_MAX : len;
+        return 1;
+    }
+
+    RecordType rt;
+    int need;
+    if (is_word(type, "DIR")) { rt = REC_DIR; need = 4; }
+    else if (is_word(type, "LINK")) { rt = REC_LINK; need = 2; }
+    else if (is_word(type, "GEN")) { rt = REC_GEN; need = 1; }
+    else if (is_word(type, "QUOTA")) { rt = REC_QUOTA; need = 3; }
+    else if (is_word(type, "STORE")) { rt = REC_STORE; need = 1; }
+    else if (is_word(type, "DATA")) { rt = REC_DATA; need = 6; }
+    else if (is_word(type, "INDEX")) { rt = REC_INDEX; need = 1; }
+    else return 1; // unknown line
+
+    TextRecord* r = push(c);
+    if (!r) return 0;
+    int n = 0;
+    while (n < need && next_token(&s, end, &t[n])) ++n;
+    r->type = REC_STOP;
+    if (n < need) return 0;
+
+    switch (rt) {
+    case REC_DIR:
+        if (!parse_ll(t[3], &v)) return 0;
+        r->path = t[0];
+        r->owner = t[1];
+        r->group = t[2];
+        r->perm = (int)v;
+        break;
+    case REC_LINK:
+        r->path = t[0];
+        r->content = t[1];
+        break;
+    case REC_GEN:
+        if (!parse_ll(t[0], &r->a)) return 0;
+        break;
+    case REC_QUOTA:
+        if (!parse_ll(t[1], &r->a) || !parse_ll(t[2], &r->b)) return 0;
+        r->path = t[0];
+        break;
+    case REC_STORE:
+    case REC_INDEX:
+        r->path = t[0];
+        break;
+    case REC_DATA:
+        if (!parse_ll(t[3], &v) || !parse_ll(t[4], &r->a) || !parse_ll(t[5], &r->b)) return 0;
+        r->path = t[0];
+        r->owner = t[1];
+        r->group = t[2];
+        r->perm = (int)v;
+        break;
+    default:
+        return 0;
+    }
+    r->type = rt;
+    return 1;
+}
+
+typedef struct ChunkJob {
+    const char* begin;
+    const char* end;
+    TextChunk* out;
+} ChunkJob;
+
+static void* parse_chunk(void* arg) {
+    ChunkJob* job = (ChunkJob*)arg;
+    const char* s = job->begin;
+    while (s < job->end) {
+        const char* nl = (const char*)memchr(s, '\n', (size_t)(job->end - s));
+        const char* eol = nl ? nl : job->end;
+        if (!parse_line(job->out, s, eol)) break;
+        s = eol + 1;
+    }
+    return NULL;
+}
+
+// === Public ===
+int text_image_load(const char* path, int threads, TextImage* img) {
+    memset(img, 0, sizeof(*img));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    img->size = (size_t)st.st_size;
+    if (img->size == 0) {
+        close(fd);
+        return 0;
+    }
+    img->map = mmap(NULL, img->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (img->map == MAP_FAILED) {
+        img->map = NULL;
+        return -1;
+    }
+    madvise(img->map, img->size, MADV_SEQUENTIAL);
+
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > LOADER_MAX_THREADS) threads = LOADER_MAX_THREADS;
+    size_t by_size = img->size / LOADER_MIN_CHUNK + 1;
+    if ((size_t)threads > by_size) threads = (int)by_size;
+    if (threads < 1) threads = 1;
+
+    img->chunks = (TextChunk*)calloc((size_t)threads, sizeof(TextChunk));
+    ChunkJob jobs[LOADER_MAX_THREADS];
+    if (!img->chunks) {
+        text_image_free(img);
+        return -1;
+    }
+    img->nchunks = threads;
+
+    // Cut at the first '\n' at or after each even split point
+    const char* base = (const char*)img->map;
+    const char* end = base + img->size;
+    const char* s = base;
+    for (int i = 0; i < threads; ++i) {
+        const char* e = (i == threads - 1) ? end : base + img->size / (size_t)threads * (size_t)(i + 1);
+        if (e < s) e = s;
+        if (e < end) {
+            const char* nl = (const char*)memchr(e, '\n', (size_t)(end - e));
+            e = nl ? nl + 1 : end;
+        }
+        jobs[i].begin = s;
+        jobs[i].end = e;
+        jobs[i].out = &img->chunks[i];
+        s = e;
+    }
+    workers_run(parse_chunk, jobs, sizeof(ChunkJob), threads);
+    return 0;
+}
+
+void text_image_free(TextImage* img) {
+    for (int i = 0; i < img->nchunks; ++i) free(img->chunks[i].records);
+    free(img->chunks);
+    if (img->map) munmap(img->map, img->size);
+    memset(img, 0, sizeof(*img));
+}
@@ -0,0 +1,63 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Parallel front end for the vfs.txt text format. The file is mmapped,
+// cut into line-aligned chunks and each chunk is tokenized on its own
+// thread into records whose fields point straight into the mapping (no
+// copies). Linking the records into the tree is left to the caller, in
+// file order.
+
+#define LOADER_CONTENT_MAX 1023   // longer FILE content is cut, as it always was
+
+typedef enum {
+    REC_GEN,
+    REC_QUOTA,
+    REC_DIR,
+    REC_FILE,
+    REC_LINK,
+    REC_STORE,   // contents of DATA lines live in this data file
+    REC_DATA,    // FILE whose content is an extent in the store
+    REC_INDEX,   // the word index saved with this snapshot
+    REC_STOP     // malformed GEN/QUOTA/DIR/LINK/STORE/DATA/INDEX line: loading stops here
+} RecordType;
+
+typedef struct TextSlice {
+    const char* p;
+    size_t len;
+} TextSlice;
+
+typedef struct TextRecord {
+    RecordType type;
+    int perm;
+    TextSlice path;        // QUOTA: the owner; STORE: the data file; INDEX: the index file
+    TextSlice owner;
+    TextSlice group;
+    TextSlice content;     // LINK: the target path
+    long long a, b;        // GEN: a = generation; QUOTA: a = inodes, b = bytes;
+                           // DATA: a = first block, b = size
+} TextRecord;
+
+typedef struct TextChunk {
+    TextRecord* records;
+    size_t count;
+    size_t cap;
+    int failed;            // out of memory while parsing
+} TextChunk;
+
+typedef struct TextImage {
+    void* map;
+    size_t size;
+    TextChunk* chunks;
+    int nchunks;
+} TextImage;
+
+// Map and parse `path` with up to `threads` workers (0 = one per CPU).
+// Returns 0 on success, -1 if the file cannot be opened or mapped (an
+// empty file is a success with no records).
+int text_image_load(const char* path, int threads, TextImage* img);
+void text_image_free(TextImage* img);
+
+#endif // LOADER_H
@@ -0,0 +1,87 @@
+#include "outbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define OUTBUF_KEEP_MAX (8u * 1024 * 1024)
+
+OutBuf session_out = { NULL, 0, 0 };
+
+// Make room for n more bytes; doubling keeps appends amortised O(1)
+static int reserve(OutBuf* ob, size_t n) {
+    if (ob->len + n <= ob->cap) return 1;
+    size_t cap = ob->cap ? ob->cap : 64 * 1024;
+    while (cap < ob->len + n) cap *= 2;
+    char* data = (char*)realloc(ob->data, cap);
+    if (!data) return 0;
+    ob->data = data;
+    ob->cap = cap;
+    return 1;
+}
+
+void out_write(OutBuf* ob, const char* s, size_t n) {
+    if (!reserve(ob, n)) return;
+    memcpy(ob->data + ob->len, s, n);
+    ob->len += n;
+}
+
+void out_puts(OutBuf* ob, const char* s) {
+    out_write(ob, s, strlen(s));
+}
+
+void out_putc(OutBuf* ob, char c) {
+    if (!reserve(ob, 1)) return;
+    ob->data[ob->len++] = c;
+}
+
+void out_indent(OutBuf* ob, size_t n) {
+    if (!reserve(ob, n)) return;
+    memset(ob->data + ob->len, ' ', n);
+    ob->len += n;
+}
+
+void out_mode(OutBuf* ob, int perm, int is_dir) {
+    if (!reserve(ob, 10)) return;
+    char* p = ob->data + ob->len;
+    int digits[3] = { perm / 100, (perm / 10) % 10, perm % 10 };
+    *p++ = is_dir ? 'd' : '-';
+    for (int i = 0; i < 3; ++i) {
+        *p++ = (digits[i] & 4) ? 'r' : '-';
+        *p++ = (digits[i] & 2) ? 'w' : '-';
+        *p++ = (digits[i] & 1) ? 'x' : '-';
+    }
+    ob->len += 10;
+}
+
+void out_uint(OutBuf* ob, unsigned long long v) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[sizeof(tmp) - 1 - n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    out_write(ob, tmp + sizeof(tmp) - n, n);
+}
+
+void out_flush(OutBuf* ob) {
+    // Anything printf'd earlier (e.g. the prompt) must come out first
+    fflush(stdout);
+    size_t off = 0;
+    while (off < ob->len) {
+        ssize_t w = write(STDOUT_FILENO, ob->data + off, ob->len - off);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        off += (size_t)w;
+    }
+    ob->len = 0;
+    // Don't pin a huge buffer after a one-off big listing
+    if (ob->cap > OUTBUF_KEEP_MAX) {
+        free(ob->data);
+        ob->data = NULL;
+        ob->cap = 0;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stddef.h>
+
+// Growable output buffer. Listing commands format into it and hand the
+// whole result to the terminal with a single write().
+typedef struct OutBuf {
+    char* data;
+    size_t len;
+    size_t cap;
+} OutBuf;
+
+// The buffer shared by all commands of the current session
+extern OutBuf session_out;
+
+void out_write(OutBuf* ob, const char* s, size_t n);
+void out_puts(OutBuf* ob, const char* s);
+void out_putc(OutBuf* ob, char c);
+
+// Append `n` spaces
+void out_indent(OutBuf* ob, size_t n);
+
+// Append a 10-char mode string like "drwxr-xr-x" for perm (e.g. 755)
+void out_mode(OutBuf* ob, int perm, int is_dir);
+
+// Append an unsigned decimal number
+void out_uint(OutBuf* ob, unsigned long long v);
+
+// Write everything to stdout (after flushing stdio) and empty the buffer
+void out_flush(OutBuf* ob);
+
+#endif // OUTBUF_H
@@ -0,0 +1,195 @@
+#include "quota.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "hash.h"
+
+typedef struct QuotaEntry {
+    char owner[50];
+    QuotaUsage q;
+    int limited;           // ledger only: a limit was set for this owner
+    struct QuotaEntry* next;
+} QuotaEntry;
+
+// Chained hash table keyed by owner name; entries are never removed, so
+// an owner's limits survive their last file being deleted.
+typedef struct QuotaTable {
+    QuotaEntry** buckets;
+    size_t bucket_count;
+    size_t entry_count;
+} QuotaTable;
+
+struct QuotaLedger {
+    QuotaTable t;
+};
+
+// The live table and every ledger share one lock: the reaper may charge
+// a ledger while the loader fills it.
+static QuotaTable live = { NULL, 0, 0 };
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+// --- helpers ---
+static void grow(QuotaTable* t) {
+    size_t n = t->bucket_count ? t->bucket_count * 2 : 64;
+    QuotaEntry** nb = (QuotaEntry**)calloc(n, sizeof(QuotaEntry*));
+    if (!nb) return; // keep the old table, chains just get longer
+    for (size_t i = 0; i < t->bucket_count; ++i) {
+        QuotaEntry* e = t->buckets[i];
+        while (e) {
+            QuotaEntry* next = e->next;
+            size_t b = fnv1a32_str(e->owner) & (n - 1);
+            e->next = nb[b];
+            nb[b] = e;
+            e = next;
+        }
+    }
+    free(t->buckets);
+    t->buckets = nb;
+    t->bucket_count = n;
+}
+
+// Caller holds lock. Returns NULL only if `create` is 0 or allocation fails.
+static QuotaEntry* lookup(QuotaTable* t, const char* owner, int create) {
+    if (t->bucket_count) {
+        for (QuotaEntry* e = t->buckets[fnv1a32_str(owner) & (t->bucket_count - 1)]; e; e = e->next) {
+            if (strcmp(e->owner, owner) == 0) return e;
+        }
+    }
+    if (!create) return NULL;
+    if (t->entry_count >= t->bucket_count) grow(t);
+    if (!t->bucket_count) return NULL;
+
+    QuotaEntry* e = (QuotaEntry*)calloc(1, sizeof(QuotaEntry));
+    if (!e) return NULL;
+    strncpy(e->owner, owner, sizeof(e->owner) - 1);
+    size_t b = fnv1a32_str(e->owner) & (t->bucket_count - 1);
+    e->next = t->buckets[b];
+    t->buckets[b] = e;
+    t->entry_count++;
+    return e;
+}
+
+// Caller holds lock
+static void table_charge(QuotaTable* t, const char* owner, int64_t inodes, int64_t bytes) {
+    QuotaEntry* e = lookup(t, owner, 1);
+    if (e) {
+        e->q.inodes += inodes;
+        e->q.bytes += bytes;
+    }
+}
+
+static void table_free(QuotaTable* t) {
+    for (size_t i = 0; i < t->bucket_count; ++i) {
+        QuotaEntry* e = t->buckets[i];
+        while (e) {
+            QuotaEntry* next = e->next;
+            free(e);
+            e = next;
+        }
+    }
+    free(t->buckets);
+}
+
+// === Accounting ===
+void quota_charge(const char* owner, int64_t inodes, int64_t bytes) {
+    pthread_mutex_lock(&lock);
+    table_charge(&live, owner, inodes, bytes);
+    pthread_mutex_unlock(&lock);
+}
+
+void quota_transfer(const char* from, const char* to, int64_t inodes, int64_t bytes) {
+    if (strcmp(from, to) == 0) return;
+    quota_charge(from, -inodes, -bytes);
+    quota_charge(to, inodes, bytes);
+}
+
+int quota_allows(const char* owner, int64_t inodes, int64_t bytes) {
+    pthread_mutex_lock(&lock);
+    QuotaEntry* e = lookup(&live, owner, 0);
+    int ok = 1;
+    if (e) {
+        if (inodes > 0 && e->q.max_inodes && e->q.inodes + inodes > e->q.max_inodes) ok = 0;
+        if (bytes > 0 && e->q.max_bytes && e->q.bytes + bytes > e->q.max_bytes) ok = 0;
+    }
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+// === Limits ===
+void quota_set_limit(const char* owner, int64_t max_inodes, int64_t max_bytes) {
+    pthread_mutex_lock(&lock);
+    QuotaEntry* e = lookup(&live, owner, 1);
+    if (e) {
+        e->q.max_inodes = max_inodes;
+        e->q.max_bytes = max_bytes;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+QuotaUsage quota_get(const char* owner) {
+    QuotaUsage q = { 0, 0, 0, 0 };
+    pthread_mutex_lock(&lock);
+    QuotaEntry* e = lookup(&live, owner, 0);
+    if (e) q = e->q;
+    pthread_mutex_unlock(&lock);
+    return q;
+}
+
+void quota_foreach_limit(void (*visit)(const char* owner, const QuotaUsage* q, void* ctx), void* ctx) {
+    pthread_mutex_lock(&lock);
+    for (size_t i = 0; i < live.bucket_count; ++i) {
+        for (QuotaEntry* e = live.buckets[i]; e; e = e->next) {
+            if (e->q.max_inodes || e->q.max_bytes) visit(e->owner, &e->q, ctx);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+// === Ledgers ===
+QuotaLedger* quota_ledger_new(void) {
+    return (QuotaLedger*)calloc(1, sizeof(QuotaLedger));
+}
+
+void quota_ledger_charge(QuotaLedger* l, const char* owner, int64_t inodes, int64_t bytes) {
+    pthread_mutex_lock(&lock);
+    table_charge(&l->t, owner, inodes, bytes);
+    pthread_mutex_unlock(&lock);
+}
+
+void quota_ledger_set_limit(QuotaLedger* l, const char* owner, int64_t max_inodes, int64_t max_bytes) {
+    pthread_mutex_lock(&lock);
+    QuotaEntry* e = lookup(&l->t, owner, 1);
+    if (e) {
+        e->q.max_inodes = max_inodes;
+        e->q.max_bytes = max_bytes;
+        e->limited = 1;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void quota_ledger_adopt(QuotaLedger* l) {
+    pthread_mutex_lock(&lock);
+    for (size_t i = 0; i < live.bucket_count; ++i) {
+        for (QuotaEntry* e = live.buckets[i]; e; e = e->next) e->q.inodes = e->q.bytes = 0;
+    }
+    for (size_t i = 0; i < l->t.bucket_count; ++i) {
+        for (QuotaEntry* from = l->t.buckets[i]; from; from = from->next) {
+            QuotaEntry* e = lookup(&live, from->owner, 1);
+            if (!e) continue;
+            e->q.inodes = from->q.inodes;
+            e->q.bytes = from->q.bytes;
+            if (from->limited) {
+                e->q.max_inodes = from->q.max_inodes;
+                e->q.max_bytes = from->q.max_bytes;
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    quota_ledger_free(l);
+}
+
+void quota_ledger_free(QuotaLedger* l) {
+    if (!l) return;
+    table_free(&l->t);
+    free(l);
+}
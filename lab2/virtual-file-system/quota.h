@@ -0,0 +1,46 @@
+#ifndef QUOTA_H
+#define QUOTA_H
+
+#include <stdint.h>
+
+// Per-owner usage, kept current by every create/write/delete/chown so a
+// quota check is a hash lookup instead of a tree walk. A limit of 0 means
+// unlimited. Safe to call from the reaper thread.
+typedef struct QuotaUsage {
+    int64_t inodes;
+    int64_t bytes;
+    int64_t max_inodes;
+    int64_t max_bytes;
+} QuotaUsage;
+
+// Add (or with negative values remove) usage for owner
+void quota_charge(const char* owner, int64_t inodes, int64_t bytes);
+
+// Move usage from one owner to another (chown)
+void quota_transfer(const char* from, const char* to, int64_t inodes, int64_t bytes);
+
+// 1 if owner can take `inodes` more inodes and `bytes` more bytes
+int quota_allows(const char* owner, int64_t inodes, int64_t bytes);
+
+void quota_set_limit(const char* owner, int64_t max_inodes, int64_t max_bytes);
+
+// Usage and limits of owner (all zero if never seen)
+QuotaUsage quota_get(const char* owner);
+
+// Visit every owner that has a limit set (for the snapshot)
+void quota_foreach_limit(void (*visit)(const char* owner, const QuotaUsage* q, void* ctx), void* ctx);
+
+// A ledger holds the usage and limits of a tree built off to the side
+// (load, reload) until it replaces the live tree, so the live usage is
+// not counted twice meanwhile and a build that is thrown away changes
+// nothing. Adopting it makes its usage the live usage (owners not in it
+// drop to zero), applies its limits and frees it.
+typedef struct QuotaLedger QuotaLedger;
+
+QuotaLedger* quota_ledger_new(void);   // NULL if out of memory
+void quota_ledger_charge(QuotaLedger* l, const char* owner, int64_t inodes, int64_t bytes);
+void quota_ledger_set_limit(QuotaLedger* l, const char* owner, int64_t max_inodes, int64_t max_bytes);
+void quota_ledger_adopt(QuotaLedger* l);
+void quota_ledger_free(QuotaLedger* l);
+
+#endif // QUOTA_H
@@ -0,0 +1,156 @@
+#include "reaper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "inode.h"
+#include "../stats/stats.h"
+
+// Detached subtrees waiting for the reaper, chained through Directory.next
+// (a detached root is no longer on any sibling list, so the link is free).
+static Directory* pending = NULL;
+static size_t pending_count = 0;
+static int started = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t idle_cv = PTHREAD_COND_INITIALIZER;
+
+// Take f off the ring of links to its inode. Live links elsewhere in
+// the tree may share the ring, hence the lock.
+static void unalias(File* f) {
+    inode_lock();
+    if (inodes.entry[f->ino] == f) inodes.entry[f->ino] = f->alias != f ? f->alias : NULL;
+    File* a = f;
+    while (a->alias != f) a = a->alias;
+    a->alias = f->alias;
+    inode_unlock();
+}
+
+// Free up to `budget` nodes from the work stack. Directories are expanded
+// by splicing their subdirs onto the stack, so there is no recursion.
+static size_t reap_some(Directory** stack, size_t budget) {
+    size_t freed = 0;
+    while (*stack && freed < budget) {
+        Directory* dir = *stack;
+        while (dir->files && freed < budget) {
+            File* f = dir->files;
+            dir->files = f->next;
+            unalias(f);
+            inode_unlink(f->ino);
+            stats_add(STAT_FILES, -1);
+            free(f);
+            ++freed;
+        }
+        if (dir->files) break; // budget spent mid-directory; resume next tick
+
+        *stack = dir->next;
+        // Children stop pointing at dir before it goes: a write through a
+        // live link may still walk up from a file in there (alias_charge)
+        inode_lock();
+        while (dir->subdirs) {
+            Directory* d = dir->subdirs;
+            dir->subdirs = d->next;
+            d->parent = NULL;
+            d->next = *stack;
+            *stack = d;
+        }
+        inode_unlock();
+        dir_index_free(&dir->index);
+        inode_unlink(dir->ino);
+        stats_add(STAT_DIRS, -1);
+        free(dir);
+        ++freed;
+    }
+    return freed;
+}
+
+// On Linux a nice value set for a thread id applies to that thread only
+void background_priority(void) {
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), REAPER_NICE);
+}
+
+static void* reaper_main(void* arg) {
+    (void)arg;
+    background_priority();
+    Directory* stack = NULL;
+    size_t taken = 0;   // subtrees moved onto our stack, not yet finished
+
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (!pending && !stack) {
+            pending_count -= taken;
+            taken = 0;
+            pthread_cond_broadcast(&idle_cv);
+            pthread_cond_wait(&work_cv, &lock);
+        }
+        // Take the whole pending list in one go
+        while (pending) {
+            Directory* d = pending;
+            pending = d->next;
+            d->next = stack;
+            stack = d;
+            ++taken;
+        }
+        pthread_mutex_unlock(&lock);
+
+        reap_some(&stack, REAPER_TICK_BUDGET);
+        if (stack) {
+            // Bounded tick: leave the allocator to the session for a moment
+            struct timespec pause = { 0, 1000000 };
+            nanosleep(&pause, NULL);
+        }
+
+        pthread_mutex_lock(&lock);
+    }
+    return NULL;
+}
+
+void reaper_start(void) {
+    pthread_mutex_lock(&lock);
+    if (!started) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, reaper_main, NULL) == 0) {
+            pthread_detach(tid);
+            started = 1;
+        } else {
+            perror("reaper: pthread_create");
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void reaper_defer(Directory* dir) {
+    if (!dir) return;
+    pthread_mutex_lock(&lock);
+    if (!started) {
+        // No thread: fall back to freeing inline (still iterative)
+        pthread_mutex_unlock(&lock);
+        dir->next = NULL;
+        Directory* stack = dir;
+        while (stack) reap_some(&stack, (size_t)-1);
+        return;
+    }
+    dir->next = pending;
+    pending = dir;
+    pending_count++;
+    pthread_cond_signal(&work_cv);
+    pthread_mutex_unlock(&lock);
+}
+
+size_t reaper_pending(void) {
+    pthread_mutex_lock(&lock);
+    size_t n = pending_count;
+    pthread_mutex_unlock(&lock);
+    return n;
+}
+
+void reaper_drain(void) {
+    pthread_mutex_lock(&lock);
+    while (started && pending_count > 0) pthread_cond_wait(&idle_cv, &lock);
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,29 @@
+#ifndef REAPER_H
+#define REAPER_H
+
+#include <stddef.h>
+#include "vfs.h"
+
+// Nodes freed per tick before the reaper yields
+#define REAPER_TICK_BUDGET 4096
+
+// Nice value of background work, so it does not preempt the session
+#define REAPER_NICE 10
+
+// Lower the calling thread's priority to REAPER_NICE (reaper, reload).
+void background_priority(void);
+
+// Start the background reaper thread (idempotent).
+void reaper_start(void);
+
+// Hand over a subtree that is already unlinked from the tree. O(1); the
+// nodes are freed later by the reaper, iteratively and in bounded ticks.
+void reaper_defer(Directory* dir);
+
+// Subtrees handed over but not yet fully freed.
+size_t reaper_pending(void);
+
+// Block until everything handed over so far has been freed.
+void reaper_drain(void);
+
+#endif // REAPER_H
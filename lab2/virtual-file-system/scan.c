@@ -0,0 +1,172 @@
+#include "scan.h"
+#include "inode.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+// Permission bit a class needs for "readable"
+#define R_OWNER 0400
+#define R_GROUP 0040
+#define R_OTHER 0004
+#define W_OTHER 0002
+
+// === Scalar ===
+static int in_groups(const ScanQuery* q, uint32_t gid) {
+    for (int k = 0; k < q->ngids; ++k) {
+        if (q->gids[k] == gid) return 1;
+    }
+    return 0;
+}
+
+static int match_one(const ScanQuery* q, uint32_t i) {
+    if (!inodes.nlink[i]) return 0;
+    switch (q->kind) {
+    case SCAN_WORLD_WRITABLE:
+        return (inodes.mode[i] & W_OTHER) != 0;
+    case SCAN_OWNED_BY:
+        return inodes.uid[i] == q->uid;
+    case SCAN_READABLE_BY:
+        if (inodes.uid[i] == q->uid) return (inodes.mode[i] & R_OWNER) != 0;
+        if (in_groups(q, inodes.gid[i])) return (inodes.mode[i] & R_GROUP) != 0;
+        return (inodes.mode[i] & R_OTHER) != 0;
+    }
+    return 0;
+}
+
+// Bits for inodes [base, end), end - base <= 64
+static uint64_t word_scalar(const ScanQuery* q, uint32_t base, uint32_t end) {
+    uint64_t word = 0;
+    for (uint32_t i = base; i < end; ++i) {
+        if (match_one(q, i)) word |= 1ull << (i - base);
+    }
+    return word;
+}
+
+#ifdef SCAN_X86
+// === SSE2: 4 inodes per step ===
+// Each step builds a lane mask of rejects (dead slot or predicate false);
+// the word gets the complement of its sign bits.
+static uint64_t word_sse2(const ScanQuery* q, uint32_t base) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i uid = _mm_set1_epi32((int)q->uid);
+    uint64_t word = 0;
+    for (int k = 0; k < 64; k += 4) {
+        uint32_t i = base + (uint32_t)k;
+        __m128i reject = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(inodes.nlink + i)), zero);
+        if (q->kind == SCAN_OWNED_BY) {
+            __m128i own = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(inodes.uid + i)), uid);
+            reject = _mm_or_si128(reject, _mm_andnot_si128(own, _mm_set1_epi32(-1)));
+        } else {
+            __m128i mode = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(inodes.mode + i)), zero);
+            __m128i need = _mm_set1_epi32(W_OTHER);
+            if (q->kind == SCAN_READABLE_BY) {
+                __m128i own = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(inodes.uid + i)), uid);
+                __m128i gid = _mm_loadu_si128((const __m128i*)(inodes.gid + i));
+                __m128i grp = zero;
+                for (int g = 0; g < q->ngids; ++g) {
+                    grp = _mm_or_si128(grp, _mm_cmpeq_epi32(gid, _mm_set1_epi32((int)q->gids[g])));
+                }
+                // owner beats group beats other, as in get_user_type()
+                need = _mm_or_si128(_mm_and_si128(grp, _mm_set1_epi32(R_GROUP)),
+                                    _mm_andnot_si128(grp, _mm_set1_epi32(R_OTHER)));
+                need = _mm_or_si128(_mm_and_si128(own, _mm_set1_epi32(R_OWNER)),
+                                    _mm_andnot_si128(own, need));
+            }
+            reject = _mm_or_si128(reject, _mm_cmpeq_epi32(_mm_and_si128(mode, need), zero));
+        }
+        word |= (uint64_t)(~_mm_movemask_ps(_mm_castsi128_ps(reject)) & 0xF) << k;
+    }
+    return word;
+}
+
+// === AVX2: 8 inodes per step ===
+__attribute__((target("avx2")))
+static uint64_t word_avx2(const ScanQuery* q, uint32_t base) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i uid = _mm256_set1_epi32((int)q->uid);
+    uint64_t word = 0;
+    for (int k = 0; k < 64; k += 8) {
+        uint32_t i = base + (uint32_t)k;
+        __m256i reject = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(inodes.nlink + i)), zero);
+        if (q->kind == SCAN_OWNED_BY) {
+            __m256i own = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(inodes.uid + i)), uid);
+            reject = _mm256_or_si256(reject, _mm256_andnot_si256(own, _mm256_set1_epi32(-1)));
+        } else {
+            __m256i mode = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(inodes.mode + i)));
+            __m256i need = _mm256_set1_epi32(W_OTHER);
+            if (q->kind == SCAN_READABLE_BY) {
+                __m256i own = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(inodes.uid + i)), uid);
+                __m256i gid = _mm256_loadu_si256((const __m256i*)(inodes.gid + i));
+                __m256i grp = zero;
+                for (int g = 0; g < q->ngids; ++g) {
+                    grp = _mm256_or_si256(grp, _mm256_cmpeq_epi32(gid, _mm256_set1_epi32((int)q->gids[g])));
+                }
+                need = _mm256_blendv_epi8(_mm256_set1_epi32(R_OTHER), _mm256_set1_epi32(R_GROUP), grp);
+                need = _mm256_blendv_epi8(need, _mm256_set1_epi32(R_OWNER), own);
+            }
+            reject = _mm256_or_si256(reject, _mm256_cmpeq_epi32(_mm256_and_si256(mode, need), zero));
+        }
+        word |= (uint64_t)(~_mm256_movemask_ps(_mm256_castsi256_ps(reject)) & 0xFF) << k;
+    }
+    return word;
+}
+#endif
+
+// === Dispatch ===
+int scan_impl_supported(ScanImpl impl) {
+    switch (impl) {
+    case SCAN_IMPL_SCALAR: return 1;
+#ifdef SCAN_X86
+    case SCAN_IMPL_SSE2: return __builtin_cpu_supports("sse2");
+    case SCAN_IMPL_AVX2: return __builtin_cpu_supports("avx2");
+#else
+    default: return 0;
+#endif
+    }
+    return 0;
+}
+
+ScanImpl scan_best_impl(void) {
+    if (scan_impl_supported(SCAN_IMPL_AVX2)) return SCAN_IMPL_AVX2;
+    if (scan_impl_supported(SCAN_IMPL_SSE2)) return SCAN_IMPL_SSE2;
+    return SCAN_IMPL_SCALAR;
+}
+
+const char* scan_impl_name(ScanImpl impl) {
+    switch (impl) {
+    case SCAN_IMPL_SCALAR: return "scalar";
+    case SCAN_IMPL_SSE2: return "sse2";
+    case SCAN_IMPL_AVX2: return "avx2";
+    }
+    return "?";
+}
+
+size_t scan_bitmap_words(void) {
+    return (inodes.used + 63) / 64;
+}
+
+size_t scan_inodes(const ScanQuery* q, ScanImpl impl, uint64_t* bits) {
+    if (!scan_impl_supported(impl)) impl = SCAN_IMPL_SCALAR;
+    size_t matches = 0;
+    uint32_t used = inodes.used;
+    for (uint32_t base = 0; base < used; base += 64) {
+        uint64_t word;
+        if (base + 64 > used) {
+            word = word_scalar(q, base, used); // tail: the columns end at `used`
+        } else {
+            switch (impl) {
+#ifdef SCAN_X86
+            case SCAN_IMPL_SSE2: word = word_sse2(q, base); break;
+            case SCAN_IMPL_AVX2: word = word_avx2(q, base); break;
+#endif
+            default: word = word_scalar(q, base, base + 64); break;
+            }
+        }
+        bits[base / 64] = word;
+        matches += (size_t)__builtin_popcountll(word);
+    }
+    return matches;
+}
@@ -0,0 +1,44 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Metadata queries over the whole inode table. The kernels read the
+// packed mode/uid/gid/nlink columns (inode.h) a block at a time instead
+// of walking the tree, with SSE2/AVX2 versions picked at runtime.
+
+#define SCAN_MAX_GROUPS 64
+
+typedef enum {
+    SCAN_WORLD_WRITABLE,   // o+w set
+    SCAN_OWNED_BY,         // uid == query uid
+    SCAN_READABLE_BY       // same rules as get_user_type()/has_permission()
+} ScanKind;
+
+typedef struct ScanQuery {
+    ScanKind kind;
+    uint32_t uid;                       // interned user (OWNED_BY, READABLE_BY)
+    uint32_t gids[SCAN_MAX_GROUPS];     // the user's groups (READABLE_BY)
+    int ngids;
+} ScanQuery;
+
+typedef enum {
+    SCAN_IMPL_SCALAR,
+    SCAN_IMPL_SSE2,
+    SCAN_IMPL_AVX2
+} ScanImpl;
+
+// Best implementation this CPU supports
+ScanImpl scan_best_impl(void);
+int scan_impl_supported(ScanImpl impl);
+const char* scan_impl_name(ScanImpl impl);
+
+// Words needed for a bitmap with one bit per inode slot
+size_t scan_bitmap_words(void);
+
+// Set bit i of `bits` for every live inode i matching q (other bits are
+// cleared). Caller holds inode_lock(). Returns the number of matches.
+size_t scan_inodes(const ScanQuery* q, ScanImpl impl, uint64_t* bits);
+
+#endif // SCAN_H
@@ -0,0 +1,380 @@
+#include "store.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define STORE_MAGIC     "VFSDATA1"
+#define STORE_INITIAL   (1024 * 1024)   // bytes of a new data file
+#define DIRTY_MAX       4096            // ranges kept before collapsing to one
+
+typedef struct StoreHeader {
+    char magic[8];
+    uint32_t block_size;
+} StoreHeader;
+
+typedef struct Extent {
+    uint32_t block;
+    uint32_t n;
+} Extent;
+
+typedef struct ExtentList {
+    Extent* v;
+    size_t n;
+    size_t cap;
+} ExtentList;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int fd = -1;
+static char* base = NULL;          // start of the STORE_MAX reservation
+static size_t cap = 0;             // blocks mapped (= file size / STORE_BLOCK)
+static uint32_t top = 0;           // blocks from here on were never handed out
+static uint64_t* used = NULL;      // one bit per block
+static uint8_t* refs = NULL;       // holders of the extent starting at a block
+static size_t used_blocks = 0;
+static int grown = 0;              // file size changed since the last sync
+static ExtentList classes[STORE_CLASSES + 1]; // [k]: free extents of k blocks
+static ExtentList large;           // free extents over STORE_CLASSES blocks
+static ExtentList pending;         // freed since the last commit
+static ExtentList dirty;           // written since the last sync
+
+// --- helpers (caller holds lock) ---
+static int list_push(ExtentList* l, uint32_t block, uint32_t n) {
+    if (l->n == l->cap) {
+        size_t c = l->cap ? l->cap * 2 : 64;
+        Extent* v = (Extent*)realloc(l->v, c * sizeof(Extent));
+        if (!v) return 0;
+        l->v = v;
+        l->cap = c;
+    }
+    l->v[l->n++] = (Extent){ block, n };
+    return 1;
+}
+
+static void list_free(ExtentList* l) {
+    free(l->v);
+    memset(l, 0, sizeof(*l));
+}
+
+static void set_bits(uint32_t block, uint32_t n, int on) {
+    for (uint32_t b = block; b < block + n; ++b) {
+        if (on) used[b / 64] |= 1ull << (b % 64);
+        else used[b / 64] &= ~(1ull << (b % 64));
+    }
+}
+
+static int bits_clear(uint32_t block, uint32_t n) {
+    for (uint32_t b = block; b < block + n; ++b) {
+        if (used[b / 64] & (1ull << (b % 64))) return 0;
+    }
+    return 1;
+}
+
+// A free extent goes back on its list; one that does not fit is simply
+// lost until the next rebuild
+static void put_free(uint32_t block, uint32_t n) {
+    if (n == 0) return;
+    list_push(n <= STORE_CLASSES ? &classes[n] : &large, block, n);
+}
+
+// Map more of the file into the reservation
+static int grow(size_t need) {
+    size_t n = cap;
+    while (n < need) n *= 2;
+    if (n * STORE_BLOCK > STORE_MAX) return 0;
+    size_t words = (n + 63) / 64, old_words = (cap + 63) / 64;
+    uint64_t* bits = (uint64_t*)realloc(used, words * sizeof(uint64_t));
+    if (!bits) return 0;
+    used = bits;
+    memset(used + old_words, 0, (words - old_words) * sizeof(uint64_t));
+    uint8_t* r = (uint8_t*)realloc(refs, n);
+    if (!r) return 0;
+    refs = r;
+    memset(refs + cap, 0, n - cap);
+
+    size_t old_bytes = cap * STORE_BLOCK, bytes = n * STORE_BLOCK;
+    if (ftruncate(fd, (off_t)bytes) != 0) return 0;
+    if (mmap(base + old_bytes, bytes - old_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+             (off_t)old_bytes) == MAP_FAILED) {
+        return 0;
+    }
+    cap = n;
+    grown = 1;
+    return 1;
+}
+
+// Next free extent of n blocks; 0 if none can be had
+static uint32_t take(uint32_t n) {
+    // Exact size, then split the smallest larger class
+    for (uint32_t k = n; k <= STORE_CLASSES; ++k) {
+        if (!classes[k].n) continue;
+        Extent e = classes[k].v[--classes[k].n];
+        put_free(e.block + n, k - n);
+        return e.block;
+    }
+    for (size_t i = 0; i < large.n; ++i) {
+        if (large.v[i].n < n) continue;
+        Extent e = large.v[i];
+        large.v[i] = large.v[--large.n];
+        put_free(e.block + n, e.n - n);
+        return e.block;
+    }
+    if ((size_t)top + n > cap && !grow((size_t)top + n)) return 0;
+    uint32_t block = top;
+    top += n;
+    return block;
+}
+
+// === Lifecycle ===
+int store_open(const char* path, int create) {
+    pthread_mutex_lock(&lock);
+    if (fd >= 0) {
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+    int f = open(path, O_RDWR | O_CREAT | (create ? O_TRUNC : 0), 0644);
+    struct stat st;
+    if (f < 0 || fstat(f, &st) != 0) {
+        int err = errno;
+        if (f >= 0) close(f);
+        pthread_mutex_unlock(&lock);
+        errno = err;
+        return -1;
+    }
+    void* res = mmap(NULL, STORE_MAX, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (res == MAP_FAILED) {
+        int err = errno;
+        close(f);
+        pthread_mutex_unlock(&lock);
+        errno = err;
+        return -1;
+    }
+    fd = f;
+    base = (char*)res;
+    cap = 0;
+
+    size_t bytes = (size_t)st.st_size / STORE_BLOCK * STORE_BLOCK;
+    int fresh = bytes < sizeof(StoreHeader);
+    if (fresh) bytes = STORE_INITIAL;
+    if (bytes > STORE_MAX) bytes = STORE_MAX;
+    size_t words = (bytes / STORE_BLOCK + 63) / 64;
+    used = (uint64_t*)calloc(words, sizeof(uint64_t));
+    refs = (uint8_t*)calloc(bytes / STORE_BLOCK, 1);
+    int ok = used != NULL && refs != NULL && (!fresh || ftruncate(fd, (off_t)bytes) == 0) &&
+             mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+    if (ok) {
+        StoreHeader* h = (StoreHeader*)base;
+        if (fresh) {
+            memcpy(h->magic, STORE_MAGIC, sizeof(h->magic));
+            h->block_size = STORE_BLOCK;
+        } else if (memcmp(h->magic, STORE_MAGIC, sizeof(h->magic)) != 0 || h->block_size != STORE_BLOCK) {
+            ok = 0;
+            errno = EINVAL;
+        }
+    }
+    if (!ok) {
+        int err = errno;
+        pthread_mutex_unlock(&lock);
+        store_close();
+        errno = err;
+        return -1;
+    }
+    cap = bytes / STORE_BLOCK;
+    set_bits(0, 1, 1); // the header
+    used_blocks = 1;
+    grown = fresh;
+    // A fresh store hands out space from block 1; an existing one waits
+    // for the snapshot to claim its extents (see store_load_end)
+    top = fresh ? 1 : (uint32_t)cap;
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+void store_close(void) {
+    pthread_mutex_lock(&lock);
+    if (base) munmap(base, STORE_MAX);
+    if (fd >= 0) close(fd);
+    fd = -1;
+    base = NULL;
+    cap = 0;
+    top = 0;
+    free(used);
+    used = NULL;
+    free(refs);
+    refs = NULL;
+    used_blocks = 0;
+    for (int k = 0; k <= STORE_CLASSES; ++k) list_free(&classes[k]);
+    list_free(&large);
+    list_free(&pending);
+    list_free(&dirty);
+    pthread_mutex_unlock(&lock);
+}
+
+int store_is_open(void) {
+    return fd >= 0;
+}
+
+// === Extents ===
+uint32_t store_alloc(size_t bytes) {
+    uint32_t n = store_blocks(bytes);
+    pthread_mutex_lock(&lock);
+    uint32_t block = fd >= 0 ? take(n) : 0;
+    if (block) {
+        set_bits(block, n, 1);
+        refs[block] = 1;
+        used_blocks += n;
+    }
+    pthread_mutex_unlock(&lock);
+    return block;
+}
+
+// The pending list holds the last reference itself, so a load can still
+// share the extent until store_commit
+void store_free(uint32_t block, size_t bytes) {
+    pthread_mutex_lock(&lock);
+    if (fd >= 0 && block && refs[block] && --refs[block] == 0) {
+        refs[block] = 1;
+        list_push(&pending, block, store_blocks(bytes));
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+int store_claim(uint32_t block, size_t bytes) {
+    uint32_t n = store_blocks(bytes);
+    pthread_mutex_lock(&lock);
+    int rc = 0;
+    if (fd < 0 || block == 0 || (size_t)block + n > cap) {
+        rc = -1;
+    } else if (bits_clear(block, n)) {
+        set_bits(block, n, 1);
+        refs[block] = 1;
+        used_blocks += n;
+        rc = 1;
+    } else if (refs[block] && refs[block] < UINT8_MAX) {
+        refs[block]++;
+        rc = 1;
+    }
+    pthread_mutex_unlock(&lock);
+    return rc;
+}
+
+// Every run of clear bits becomes a free extent; the run reaching the end
+// of the file becomes the bump area again
+void store_load_end(void) {
+    pthread_mutex_lock(&lock);
+    if (fd < 0) {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+    for (int k = 0; k <= STORE_CLASSES; ++k) classes[k].n = 0;
+    large.n = 0;
+    uint32_t b = 1, end = (uint32_t)cap;
+    top = end;
+    while (b < end) {
+        uint64_t w = used[b / 64] >> (b % 64);
+        if (w & 1) {
+            // Skip set bits, a word at a time where possible
+            if (b % 64 == 0 && used[b / 64] == ~0ull) b += 64;
+            else ++b;
+            continue;
+        }
+        uint32_t start = b;
+        while (b < end) {
+            if (b % 64 == 0 && used[b / 64] == 0 && b + 64 <= end) { b += 64; continue; }
+            if (used[b / 64] & (1ull << (b % 64))) break;
+            ++b;
+        }
+        if (b == end) top = start;
+        else put_free(start, b - start);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+char* store_ptr(uint32_t block) {
+    return base + (size_t)block * STORE_BLOCK;
+}
+
+// === Persistence ===
+void store_dirty(uint32_t block, size_t bytes) {
+    pthread_mutex_lock(&lock);
+    if (fd >= 0) {
+        uint32_t n = store_blocks(bytes);
+        if (dirty.n >= DIRTY_MAX) {
+            // Too many to track: keep one range covering all of them
+            uint32_t lo = block, hi = block + n;
+            for (size_t i = 0; i < dirty.n; ++i) {
+                if (dirty.v[i].block < lo) lo = dirty.v[i].block;
+                if (dirty.v[i].block + dirty.v[i].n > hi) hi = dirty.v[i].block + dirty.v[i].n;
+            }
+            dirty.n = 0;
+            list_push(&dirty, lo, hi - lo);
+        } else {
+            list_push(&dirty, block, n);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static int by_block(const void* a, const void* b) {
+    uint32_t x = ((const Extent*)a)->block, y = ((const Extent*)b)->block;
+    return (x > y) - (x < y);
+}
+
+int store_sync(void) {
+    pthread_mutex_lock(&lock);
+    if (fd < 0) {
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+    int rc = 0;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    qsort(dirty.v, dirty.n, sizeof(Extent), by_block);
+    size_t i = 0;
+    while (i < dirty.n) {
+        // Merge ranges that touch the same pages into one msync
+        size_t lo = (size_t)dirty.v[i].block * STORE_BLOCK / page * page;
+        size_t hi = (size_t)(dirty.v[i].block + dirty.v[i].n) * STORE_BLOCK;
+        for (++i; i < dirty.n && (size_t)dirty.v[i].block * STORE_BLOCK <= (hi + page - 1) / page * page; ++i) {
+            size_t h = (size_t)(dirty.v[i].block + dirty.v[i].n) * STORE_BLOCK;
+            if (h > hi) hi = h;
+        }
+        if (msync(base + lo, hi - lo, MS_SYNC) != 0) rc = -1;
+    }
+    dirty.n = 0;
+    if (grown && fdatasync(fd) != 0) rc = -1; // the new file size
+    if (rc == 0) grown = 0;
+    pthread_mutex_unlock(&lock);
+    return rc;
+}
+
+void store_commit(void) {
+    pthread_mutex_lock(&lock);
+    for (size_t i = 0; i < pending.n; ++i) {
+        if (--refs[pending.v[i].block]) continue; // claimed again by a load
+        set_bits(pending.v[i].block, pending.v[i].n, 0);
+        used_blocks -= pending.v[i].n;
+        put_free(pending.v[i].block, pending.v[i].n);
+    }
+    pending.n = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+StoreInfo store_info(void) {
+    StoreInfo info;
+    memset(&info, 0, sizeof(info));
+    pthread_mutex_lock(&lock);
+    if (fd >= 0) {
+        info.file_bytes = cap * STORE_BLOCK;
+        info.used_blocks = used_blocks;
+        for (int k = 0; k <= STORE_CLASSES; ++k) info.free_extents += classes[k].n;
+        info.free_extents += large.n;
+        info.pending = pending.n;
+        info.dirty_ranges = dirty.n;
+    }
+    pthread_mutex_unlock(&lock);
+    return info;
+}
@@ -0,0 +1,78 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Optional out-of-core content store: file contents live in one data
+// file mapped into memory, so the page cache decides what stays resident
+// and a save only msyncs the ranges written since the last one.
+//
+// Space is handed out in extents of whole STORE_BLOCK blocks, named by
+// their first block (0 is the header, so 0 means "no extent"). Extents
+// are never written in place: new content always gets a new extent, and
+// extents freed since the last save stay reserved until store_commit(),
+// because the snapshot on disk may still point at them.
+//
+// The mapping sits in a fixed reservation, so pointers from store_ptr()
+// stay valid while the file grows. Thread-safe.
+
+#define STORE_FILE    "vfs.data"
+#define STORE_BLOCK   64
+#define STORE_CLASSES 32                        // exact-size free lists, 1..32 blocks
+#define STORE_MAX     ((size_t)64 << 30)        // largest data file (address space reserved)
+
+typedef struct StoreInfo {
+    size_t file_bytes;     // size of the data file
+    size_t used_blocks;    // blocks held by live or pending extents
+    size_t free_extents;   // extents on the free lists
+    size_t pending;        // extents waiting for the next commit
+    size_t dirty_ranges;   // ranges waiting for the next sync
+} StoreInfo;
+
+// Open `path`; `create` starts a new, empty store (truncating any old
+// file). Returns 0, or -1 with errno set.
+int store_open(const char* path, int create);
+void store_close(void);
+int store_is_open(void);
+
+// Blocks needed for `bytes` of content plus its NUL
+static inline uint32_t store_blocks(size_t bytes) {
+    return (uint32_t)((bytes + 1 + STORE_BLOCK - 1) / STORE_BLOCK);
+}
+
+// New extent for `bytes` of content; 0 if the store is full or closed
+uint32_t store_alloc(size_t bytes);
+
+// Drop one reference; the last one's extent stays reserved until the
+// next store_commit
+void store_free(uint32_t block, size_t bytes);
+
+// Claim an extent named by the snapshot while loading: 1 on success, 0
+// if it overlaps another extent (a damaged snapshot), -1 if it lies
+// outside the file. Extents are immutable, so one
+// already held by a live inode (a reload) is simply shared: extents are
+// reference counted and free only when the last holder lets go.
+int store_claim(uint32_t block, size_t bytes);
+
+// Rebuild the free lists from the claimed blocks after a load. Until the
+// first call, a store opened from an existing file hands out space only
+// by growing the file, so nothing collides with extents still to be
+// claimed.
+void store_load_end(void);
+
+char* store_ptr(uint32_t block);
+
+// Note bytes written at an extent, for the next store_sync
+void store_dirty(uint32_t block, size_t bytes);
+
+// msync every dirty range; 0 on success
+int store_sync(void);
+
+// The snapshot naming the current extents is on disk: recycle the
+// extents freed before it
+void store_commit(void);
+
+StoreInfo store_info(void);
+
+#endif // STORE_H
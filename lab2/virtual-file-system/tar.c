@@ -0,0 +1,180 @@
+#include "tar.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TAR_BLOCK  512
+#define TAR_RECORD (20 * TAR_BLOCK)
+#define TAR_ALIGN  4096
+
+// ustar header layout (POSIX.1-1988)
+typedef struct TarHeader {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+} TarHeader;
+
+// VFS owners have no host ids; readers fall back to these when the
+// names are unknown on their side
+#define TAR_NOBODY 65534
+
+// --- helpers ---
+static void octal(char* field, size_t width, uint64_t v) {
+    // width - 1 digits and a NUL, as tar(1) writes them
+    field[width - 1] = '\0';
+    for (size_t i = width - 1; i-- > 0; v >>= 3) field[i] = (char)('0' + (v & 7));
+}
+
+// Split `name` into prefix/name fields; 0 if it cannot fit
+static int split_name(TarHeader* h, const char* name) {
+    size_t len = strlen(name);
+    if (len <= sizeof(h->name)) {
+        memcpy(h->name, name, len);
+        return 1;
+    }
+    // Cut at the last '/' that leaves both halves in range
+    for (size_t i = len - 1; i > 0; --i) {
+        if (name[i] != '/') continue;
+        if (len - i - 1 > sizeof(h->name)) break;
+        if (i <= sizeof(h->prefix) && len - i - 1 > 0) {
+            memcpy(h->prefix, name, i);
+            memcpy(h->name, name + i + 1, len - i - 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void fail(TarWriter* w, int err) {
+    if (!w->error) w->error = err;
+}
+
+static void flush_buf(TarWriter* w) {
+    size_t off = 0;
+    while (off < w->len && !w->error) {
+        ssize_t n = write(w->fd, w->buf + off, w->len - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) fail(w, errno);
+        else off += (size_t)n;
+    }
+    w->len = 0;
+}
+
+static void put(TarWriter* w, const void* p, size_t n) {
+    const char* s = (const char*)p;
+    while (n && !w->error) {
+        size_t room = TAR_BUFFER_SIZE - w->len;
+        size_t k = n < room ? n : room;
+        memcpy(w->buf + w->len, s, k);
+        w->len += k;
+        w->written += k;
+        s += k;
+        n -= k;
+        if (w->len == TAR_BUFFER_SIZE) flush_buf(w);
+    }
+}
+
+static void put_zeros(TarWriter* w, size_t n) {
+    static const char zeros[TAR_BLOCK];
+    while (n) {
+        size_t k = n < sizeof(zeros) ? n : sizeof(zeros);
+        put(w, zeros, k);
+        n -= k;
+    }
+}
+
+// === Public ===
+int tar_open(TarWriter* w, const char* path) {
+    memset(w, 0, sizeof(*w));
+    void* buf = NULL;
+    int rc = posix_memalign(&buf, TAR_ALIGN, TAR_BUFFER_SIZE);
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    w->buf = (char*)buf;
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) {
+        free(w->buf);
+        w->buf = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int tar_add(TarWriter* w, TarType type, const char* name, const char* link, const char* uname,
+            const char* gname, unsigned mode, uint64_t mtime, const char* data, size_t size) {
+    TarHeader h;
+    memset(&h, 0, sizeof(h));
+    char dir_name[512];
+    if (type == TAR_DIR) {
+        snprintf(dir_name, sizeof(dir_name), "%s/", name);
+        name = dir_name;
+    }
+    if (!split_name(&h, name) || (link && strlen(link) > sizeof(h.linkname))) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (type != TAR_FILE) size = 0;
+
+    octal(h.mode, sizeof(h.mode), mode & 07777);
+    octal(h.uid, sizeof(h.uid), TAR_NOBODY);
+    octal(h.gid, sizeof(h.gid), TAR_NOBODY);
+    octal(h.size, sizeof(h.size), size);
+    octal(h.mtime, sizeof(h.mtime), mtime);
+    h.typeflag = (char)type;
+    if (link) memcpy(h.linkname, link, strlen(link));
+    memcpy(h.magic, "ustar", 6);
+    memcpy(h.version, "00", 2);
+    snprintf(h.uname, sizeof(h.uname), "%s", uname);
+    snprintf(h.gname, sizeof(h.gname), "%s", gname);
+
+    // Checksum over the header with the checksum field read as spaces
+    memset(h.chksum, ' ', sizeof(h.chksum));
+    unsigned sum = 0;
+    for (size_t i = 0; i < sizeof(h); ++i) sum += ((unsigned char*)&h)[i];
+    octal(h.chksum, 7, sum);
+    h.chksum[7] = ' ';
+
+    put(w, &h, sizeof(h));
+    if (size) {
+        put(w, data, size);
+        put_zeros(w, (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK);
+    }
+    if (w->error) {
+        errno = w->error;
+        return -1;
+    }
+    return 0;
+}
+
+int tar_close(TarWriter* w) {
+    put_zeros(w, 2 * TAR_BLOCK);
+    put_zeros(w, (TAR_RECORD - w->written % TAR_RECORD) % TAR_RECORD);
+    flush_buf(w);
+    if (close(w->fd) != 0) fail(w, errno);
+    free(w->buf);
+    w->buf = NULL;
+    if (w->error) {
+        errno = w->error;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef TAR_H
+#define TAR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming POSIX ustar writer. Headers and data go through one aligned
+// buffer that is flushed with large write(2) calls, so an archive of any
+// size is produced in a single pass with constant memory.
+
+#define TAR_BUFFER_SIZE (1024 * 1024)   // a multiple of the 10240-byte record
+
+typedef enum {
+    TAR_FILE = '0',
+    TAR_HARDLINK = '1',
+    TAR_DIR = '5'
+} TarType;
+
+typedef struct TarWriter {
+    int fd;
+    char* buf;
+    size_t len;            // bytes waiting in buf
+    uint64_t written;      // archive bytes so far, including buffered ones
+    int error;             // first errno from open/write, 0 if none
+} TarWriter;
+
+// Returns 0, or -1 with errno set
+int tar_open(TarWriter* w, const char* path);
+
+// One member. `name` is relative ('/' is appended for directories);
+// `link` is the target for TAR_HARDLINK. Returns -1 with errno set to
+// ENAMETOOLONG when the name cannot be stored in ustar (the member is
+// not written) or to the I/O error that stopped the archive.
+int tar_add(TarWriter* w, TarType type, const char* name, const char* link, const char* uname,
+            const char* gname, unsigned mode, uint64_t mtime, const char* data, size_t size);
+
+// Write the end-of-archive blocks, pad to a full record and close.
+// Returns 0, or -1 with errno set to the first error seen.
+int tar_close(TarWriter* w);
+
+#endif // TAR_H
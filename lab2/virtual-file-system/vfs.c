@@ -4,8 +4,30 @@
 #include <string.h>
 #include <stdbool.h>
 #include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <pwd.h>
+#include <pthread.h>
+#include <grp.h>
 #include "../user-group-management/user.h"
 #include "../user-group-management/group.h"
+#include "reaper.h"
+#include "quota.h"
+#include "inode.h"
+#include "scan.h"
+#include "loader.h"
+#include "import.h"
+#include "tar.h"
+#include "glob.h"
+#include "grep.h"
+#include "hash.h"
+#include "wordindex.h"
+#include "store.h"
+#include "outbuf.h"
+#include "../stats/stats.h"
+
+#define VFS_FILE     "vfs.txt"
+#define JOURNAL_FILE "vfs.journal"
 
 // === External state ===
 Directory* root = NULL;
@@ -17,47 +39,214 @@ int get_user_type(const char* owner, const char* group, const char* username);
 int has_permission(int perm, char mode, int user_type);
 
 // === Forward decls (local) ===
-static void rm_file_vfs(const char* name);
-static void rm_dir_vfs(const char* name);
-static void rm_dir_recursive(Directory* dir);
+static int rm_file_vfs(const char* name);
+static int rm_dir_vfs(const char* name);
+static int rm_glob(const char* pattern, int recursive);
+
+// Snapshot generation: journal records apply on top of the snapshot with
+// the same generation; save_vfs bumps it, which retires older records.
+static unsigned long vfs_generation = 0;
+
+// Bumped by every snapshot and journal record, so a background reload can
+// tell whether what it read is still current
+static unsigned long storage_epoch = 0;
+
+// Set while the tree in use is missing entries its snapshot has (a load
+// ran out of inodes); saving it would drop them from vfs.txt for good
+static int load_partial = 0;
 
 // --- helpers ---
 static Directory* find_subdir(Directory* parent, const char* name) {
-    for (Directory* d = parent->subdirs; d; d = d->next) {
-        if (strcmp(d->name, name) == 0) return d;
-    }
-    return NULL;
+    Directory* d = (Directory*)dir_index_find(&parent->index, name, 1);
+    stats_inc(d ? STAT_FIND_SUBDIR_HIT : STAT_FIND_SUBDIR_MISS);
+    return d;
 }
 static File* find_file(Directory* parent, const char* name) {
-    for (File* f = parent->files; f; f = f->next) {
-        if (strcmp(f->name, name) == 0) return f;
+    File* f = (File*)dir_index_find(&parent->index, name, 0);
+    stats_inc(f ? STAT_FIND_FILE_HIT : STAT_FIND_FILE_MISS);
+    return f;
+}
+
+// Apply a usage delta to dir and every ancestor's cached subtree totals
+static void tree_charge(Directory* dir, int64_t inodes, int64_t bytes) {
+    for (; dir; dir = dir->parent) {
+        dir->tree_inodes += inodes;
+        dir->tree_bytes += bytes;
+    }
+}
+
+// Quota check for owner; usage of subtrees still queued for the reaper
+// counts until freed, so drain it once before refusing.
+static int quota_check(const char* owner, int64_t count, int64_t bytes) {
+    if (quota_allows(owner, count, bytes)) return 1;
+    if (reaper_pending() == 0) return 0;
+    reaper_drain();
+    return quota_allows(owner, count, bytes);
+}
+
+// Link a detached directory (and everything under it) into parent
+static void attach_dir(Directory* parent, Directory* dir) {
+    dir->parent = parent;
+    dir->prev = NULL;
+    dir->next = parent->subdirs;
+    if (parent->subdirs) parent->subdirs->prev = dir;
+    parent->subdirs = dir;
+    dir_index_insert(&parent->index, dir->name, 1, dir);
+    tree_charge(parent, dir->tree_inodes, dir->tree_bytes);
+}
+
+// Allocate a directory and link it into parent (sibling list + index).
+// NULL when out of memory or inodes.
+static Directory* new_dir(Directory* parent, const char* name, const char* owner,
+                          const char* group, int perm) {
+    Directory* dir = (Directory*)malloc(sizeof(Directory));
+    if (!dir) return NULL;
+    dir->ino = inode_alloc(1, owner, group, perm);
+    if (dir->ino == INODE_NONE) {
+        free(dir);
+        return NULL;
+    }
+    strcpy(dir->name, name);
+    inodes.entry[dir->ino] = dir;
+    dir->parent = parent;
+    dir->subdirs = NULL;
+    dir->files = NULL;
+    dir->next = NULL;
+    dir->prev = NULL;
+    dir_index_init(&dir->index);
+    dir->tree_inodes = 1;
+    dir->tree_bytes = 0;
+    stats_inc(STAT_DIRS);
+    if (parent) attach_dir(parent, dir);
+    return dir;
+}
+
+// Unlink a subdir from its parent in O(1) (plus the index update)
+static void detach_dir(Directory* dir) {
+    Directory* parent = dir->parent;
+    if (dir->prev) dir->prev->next = dir->next;
+    else parent->subdirs = dir->next;
+    if (dir->next) dir->next->prev = dir->prev;
+    dir_index_remove(&parent->index, dir->name, dir);
+    tree_charge(parent, -dir->tree_inodes, -dir->tree_bytes);
+    dir->next = dir->prev = NULL;
+    dir->parent = NULL;
+}
+
+// Absolute path of dir ("/" for root)
+static void dir_path(const Directory* dir, char* out, size_t size) {
+    char buf[1024];
+    size_t pos = sizeof(buf) - 1;
+    buf[pos] = '\0';
+    for (const Directory* d = dir; d && d != root; d = d->parent) {
+        size_t len = strlen(d->name);
+        if (len + 1 > pos) break;
+        pos -= len;
+        memcpy(buf + pos, d->name, len);
+        buf[--pos] = '/';
+    }
+    snprintf(out, size, "%s", buf[pos] ? buf + pos : "/");
+}
+
+// Add a directory entry for an existing inode (the caller owns one link,
+// and keeps it if this returns NULL for lack of memory)
+static File* new_entry(Directory* parent, const char* name, uint32_t ino) {
+    File* file = (File*)malloc(sizeof(File));
+    if (!file) return NULL;
+    strcpy(file->name, name);
+    file->ino = ino;
+    file->dir = parent;
+    file->alias = file;
+    if (!inodes.entry[ino]) inodes.entry[ino] = file;
+    file->next = parent->files;
+    parent->files = file;
+    dir_index_insert(&parent->index, file->name, 0, file);
+    stats_inc(STAT_FILES);
+    tree_charge(parent, 1, inodes.size[ino]);
+    return file;
+}
+
+// NULL when out of memory or inodes
+static File* new_file(Directory* parent, const char* name, const char* owner,
+                      const char* group, int perm, const char* content) {
+    uint32_t ino = inode_alloc(0, owner, group, perm);
+    if (ino == INODE_NONE) return NULL;
+    inode_set_data(ino, content);
+    File* f = new_entry(parent, name, ino);
+    if (!f) inode_unlink(ino);
+    return f;
+}
+
+// Put `file` on the ring of entries sharing `other`'s inode
+static void alias_join(File* file, File* other) {
+    inode_lock();
+    file->alias = other->alias;
+    other->alias = file;
+    inode_unlock();
+}
+
+// Apply a content size change to the directories of every link
+static void alias_charge(File* file, int64_t bytes) {
+    inode_lock();
+    File* a = file;
+    do {
+        tree_charge(a->dir, 0, bytes);
+        a = a->alias;
+    } while (a != file);
+    inode_unlock();
+}
+
+// Drop an entry already unlinked from its directory's file list
+static void release_entry(File* file) {
+    Directory* dir = file->dir;
+    dir_index_remove(&dir->index, file->name, file);
+    tree_charge(dir, -1, -(int64_t)inodes.size[file->ino]);
+
+    inode_lock();
+    if (inodes.entry[file->ino] == file) inodes.entry[file->ino] = file->alias != file ? file->alias : NULL;
+    File* a = file;
+    while (a->alias != file) a = a->alias;
+    a->alias = file->alias;
+    inode_unlock();
+
+    inode_unlink(file->ino);
+    stats_add(STAT_FILES, -1);
+    free(file);
+}
+
+// Unlink `file` from its directory's list and index and drop its link
+static void drop_entry(File* file) {
+    File** prev = &file->dir->files;
+    while (*prev != file) prev = &(*prev)->next;
+    *prev = file->next;
+    release_entry(file);
+}
+
+// drop_entry for several files of `dir`, with one pass over its list
+static void drop_entries(Directory* dir, File** files, size_t n) {
+    for (size_t i = 0; i < n; ++i) files[i]->dir = NULL; // mark
+    File** prev = &dir->files;
+    while (*prev) {
+        if (!(*prev)->dir) *prev = (*prev)->next;
+        else prev = &(*prev)->next;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        files[i]->dir = dir;
+        release_entry(files[i]);
     }
-    return NULL;
 }
 
 // === Initialization ===
 void init_fs() {
-    root = (Directory*)malloc(sizeof(Directory));
-    strcpy(root->name, "/");
-    strcpy(root->owner, "root");
-    strcpy(root->group, "root");
-    root->permission = 755;
-    root->parent = NULL;
-    root->subdirs = NULL;
-    root->files = NULL;
-    root->next = NULL;
+    root = new_dir(NULL, "/", "root", "root", 755);
+    reaper_start();
 
     // Create a real /home directory so paths & save/load are consistent
-    Directory* home = (Directory*)malloc(sizeof(Directory));
-    strcpy(home->name, "home");
-    strcpy(home->owner, "root");
-    strcpy(home->group, "root");
-    home->permission = 755;
-    home->parent = root;
-    home->subdirs = NULL;
-    home->files = NULL;
-    home->next = NULL;
-    root->subdirs = home;
+    Directory* home = root ? new_dir(root, "home", "root", "root", 755) : NULL;
+    if (!home) {
+        printf("Cannot create the root file system: out of memory\n");
+        exit(1);
+    }
 
     current_dir = home; // start at /home (caller can call go_to_home_directory)
 }
@@ -69,112 +258,119 @@ void go_to_home_directory() {
         init_fs();
         home = find_subdir(root, "home");
     }
-    for (Directory* d = home->subdirs; d; d = d->next) {
-        if (strcmp(d->name, current_user) == 0) {
-            current_dir = d;
-            return;
-        }
+    Directory* dir = find_subdir(home, current_user);
+    if (dir) {
+        current_dir = dir;
+        return;
+    }
+    // TODO: replace group with primary group if you have it
+    dir = new_dir(home, current_user, current_user, current_user, 700);
+    if (!dir) {
+        printf("Cannot create home directory for '%s': No space left on device\n", current_user);
+        dir = home;
     }
-    Directory* dir = (Directory*)malloc(sizeof(Directory));
-    strcpy(dir->name, current_user);
-    strcpy(dir->owner, current_user);
-    strcpy(dir->group, current_user); // TODO: replace with primary group if you have it
-    dir->permission = 700;
-    dir->parent = home;
-    dir->subdirs = NULL;
-    dir->files = NULL;
-    dir->next = home->subdirs;
-    home->subdirs = dir;
     current_dir = dir;
 }
 
 // === File & Directory Operations ===
-void mkdir_vfs(const char* name) {
+int mkdir_vfs(const char* name) {
     // Need w+x on current dir (Linux semantics)
-    int tdir = get_user_type(current_dir->owner, current_dir->group, current_user);
-    if (!has_permission(current_dir->permission, 'w', tdir) ||
-        !has_permission(current_dir->permission, 'x', tdir)) {
+    int tdir = get_user_type(inode_owner(current_dir->ino), inode_group(current_dir->ino), current_user);
+    if (!has_permission(inodes.perm[current_dir->ino], 'w', tdir) ||
+        !has_permission(inodes.perm[current_dir->ino], 'x', tdir)) {
         printf("Permission denied.\n");
-        return;
+        return -1;
     }
 
     if (find_subdir(current_dir, name)) {
         printf("mkdir: cannot create directory '%s': File exists\n", name);
-        return;
+        return -1;
     }
     if (find_file(current_dir, name)) {
         printf("mkdir: cannot create directory '%s': A file with the same name exists\n", name);
-        return;
+        return -1;
+    }
+    if (!quota_check(current_user, 1, 0)) {
+        printf("mkdir: cannot create directory '%s': Disk quota exceeded\n", name);
+        return -1;
     }
 
-    Directory* dir = (Directory*)malloc(sizeof(Directory));
-    strcpy(dir->name, name);
-    strcpy(dir->owner, current_user);
-    strcpy(dir->group, current_user);
-    dir->permission = 755;
-    dir->parent = current_dir;
-    dir->subdirs = NULL;
-    dir->files = NULL;
-    dir->next = current_dir->subdirs;
-    current_dir->subdirs = dir;
+    if (!new_dir(current_dir, name, current_user, current_user, 755)) {
+        printf("mkdir: cannot create directory '%s': No space left on device\n", name);
+        return -1;
+    }
     printf("Directory '%s' created.\n", name);
     save_vfs();
+    return 0;
 }
 
-void touch_vfs(const char* name) {
+int touch_vfs(const char* name) {
     // Need w+x on current dir (create)
-    int tdir = get_user_type(current_dir->owner, current_dir->group, current_user);
-    if (!has_permission(current_dir->permission, 'w', tdir) ||
-        !has_permission(current_dir->permission, 'x', tdir)) {
+    int tdir = get_user_type(inode_owner(current_dir->ino), inode_group(current_dir->ino), current_user);
+    if (!has_permission(inodes.perm[current_dir->ino], 'w', tdir) ||
+        !has_permission(inodes.perm[current_dir->ino], 'x', tdir)) {
         printf("Permission denied.\n");
-        return;
+        return -1;
     }
 
     if (find_file(current_dir, name)) {
         printf("touch: cannot create file '%s': File exists\n", name);
-        return;
+        return -1;
     }
     if (find_subdir(current_dir, name)) {
         printf("touch: cannot create file '%s': A directory with the same name exists\n", name);
-        return;
+        return -1;
+    }
+    if (!quota_check(current_user, 1, 0)) {
+        printf("touch: cannot create file '%s': Disk quota exceeded\n", name);
+        return -1;
     }
 
-    File* file = (File*)malloc(sizeof(File));
-    strcpy(file->name, name);
-    file->permission = 644;
-    strcpy(file->owner, current_user);
-    strcpy(file->group, current_user);
-    file->content[0] = '\0';
-    file->next = current_dir->files;
-    current_dir->files = file;
+    if (!new_file(current_dir, name, current_user, current_user, 644, "")) {
+        printf("touch: cannot create file '%s': No space left on device\n", name);
+        return -1;
+    }
     printf("File '%s' created.\n", name);
     save_vfs();
+    return 0;
 }
 
-void write_vfs(const char* name, const char* content) {
+int write_vfs(const char* name, const char* content) {
     File* f = find_file(current_dir, name);
-    if (!f) { printf("File not found.\n"); return; }
+    if (!f) { printf("File not found.\n"); return -1; }
 
-    int t = get_user_type(f->owner, f->group, current_user);
-    if (!has_permission(f->permission, 'w', t)) {
+    int t = get_user_type(inode_owner(f->ino), inode_group(f->ino), current_user);
+    if (!has_permission(inodes.perm[f->ino], 'w', t)) {
         printf("Permission denied.\n");
-        return;
+        return -1;
     }
-    // NOTE: ensure File.content is large enough in your header
-    strcpy(f->content, content);
+    // Bytes are charged to the file's owner, not the writer
+    int64_t delta = (int64_t)strlen(content) - (int64_t)inodes.size[f->ino];
+    if (!quota_check(inode_owner(f->ino), 0, delta)) {
+        printf("write: '%s': Disk quota exceeded\n", name);
+        return -1;
+    }
+    if (!inode_set_data(f->ino, content)) {
+        printf("write: '%s': Out of memory\n", name);
+        return -1;
+    }
+    alias_charge(f, delta);
     printf("Content written to '%s'.\n", name);
+    return 0;
 }
 
 void read_vfs(const char* name) {
     File* f = find_file(current_dir, name);
     if (!f) { printf("File not found.\n"); return; }
 
-    int t = get_user_type(f->owner, f->group, current_user);
-    if (!has_permission(f->permission, 'r', t)) {
+    int t = get_user_type(inode_owner(f->ino), inode_group(f->ino), current_user);
+    if (!has_permission(inodes.perm[f->ino], 'r', t)) {
         printf("Permission denied.\n");
         return;
     }
-    printf("%s\n", f->content);
+    out_puts(&session_out, inode_data(f->ino));
+    out_putc(&session_out, '\n');
+    out_flush(&session_out);
 }
 
 // === Navigation ===
@@ -189,8 +385,8 @@ void cd_vfs(const char* name) {
     Directory* dir = find_subdir(current_dir, name);
     if (!dir) { printf("Directory not found.\n"); return; }
 
-    int t = get_user_type(dir->owner, dir->group, current_user);
-    if (!has_permission(dir->permission, 'x', t)) {
+    int t = get_user_type(inode_owner(dir->ino), inode_group(dir->ino), current_user);
+    if (!has_permission(inodes.perm[dir->ino], 'x', t)) {
         printf("Permission denied.\n");
         return;
     }
@@ -198,97 +394,220 @@ void cd_vfs(const char* name) {
 }
 
 void pwd_vfs() {
-    // Build absolute path by walking to root
-    char path[1024] = "";
-    Directory* temp = current_dir;
+    char path[1024];
+    dir_path(current_dir, path, sizeof(path));
+    printf("%s\n", path);
+}
 
-    // special case: root
-    if (temp == root) {
-        printf("/\n");
-        return;
+// === Wildcards ===
+// Names matching a pattern, in name order. Only the run of the index that
+// shares the pattern's literal prefix is visited (see glob.h).
+typedef struct GlobHit {
+    void* node;            // Directory* or File*
+    const char* name;
+    uint32_t ino;
+    int is_dir;
+} GlobHit;
+
+static int compile_pattern(Glob* g, const char* cmd, const char* pattern) {
+    if (glob_compile(g, pattern) == 0) return 1;
+    printf("%s: pattern too complex: '%s'\n", cmd, pattern);
+    return 0;
+}
+
+// First match at or after e, NULL once past the prefix
+static IndexEntry* glob_scan(const Glob* g, IndexEntry* e) {
+    for (; e && strncmp(e->name, g->prefix, g->prefix_len) == 0; e = dir_index_next(e)) {
+        if (glob_match(g, e->name)) return e;
     }
+    return NULL;
+}
 
-    while (temp && temp != root) {
-        char buffer[1024];
-        snprintf(buffer, sizeof(buffer), "/%s%s", temp->name, path);
-        strncpy(path, buffer, sizeof(path) - 1);
-        path[sizeof(path) - 1] = '\0';
-        temp = temp->parent;
+// First match after the cursor `after` (NULL = from the start)
+static IndexEntry* glob_first(const Directory* dir, const Glob* g, const char* after) {
+    if (after && *after && strcmp(after, g->prefix) >= 0) {
+        return glob_scan(g, dir_index_seek(&dir->index, after, 0));
     }
-    printf("%s\n", path[0] ? path : "/");
+    return glob_scan(g, dir_index_seek(&dir->index, g->prefix, 1));
+}
+
+// Every match, for commands that change the directory as they go; the
+// caller frees *out. Returns the count (0 with *out NULL on none).
+static size_t glob_collect(const Directory* dir, const Glob* g, GlobHit** out) {
+    size_t n = 0, cap = 0;
+    *out = NULL;
+    for (IndexEntry* e = glob_first(dir, g, NULL); e; e = glob_scan(g, dir_index_next(e))) {
+        if (n == cap) {
+            cap = cap ? cap * 2 : 16;
+            GlobHit* grown = (GlobHit*)realloc(*out, cap * sizeof(GlobHit));
+            if (!grown) break;
+            *out = grown;
+        }
+        GlobHit* h = &(*out)[n++];
+        h->node = e->node;
+        h->name = e->name;
+        h->is_dir = e->is_dir;
+        h->ino = e->is_dir ? ((Directory*)e->node)->ino : ((File*)e->node)->ino;
+    }
+    return n;
+}
+
+// glob_collect over current_dir for `cmd PATTERN`; reports a bad pattern
+// or no match and returns 0 then
+static size_t glob_hits(const char* cmd, const char* pattern, GlobHit** out) {
+    Glob g;
+    *out = NULL;
+    if (!compile_pattern(&g, cmd, pattern)) return 0;
+    size_t n = glob_collect(current_dir, &g, out);
+    glob_free(&g);
+    if (n == 0) printf("%s: no match for '%s'\n", cmd, pattern);
+    return n;
 }
 
 // === Display ===
-static const char* permission_str(int perm, int is_dir) {
-    static char str[11];
-    str[0] = is_dir ? 'd' : '-';
-    int owner = perm / 100;
-    int group = (perm / 10) % 10;
-    int other = perm % 10;
-    str[1] = (owner & 4) ? 'r' : '-';
-    str[2] = (owner & 2) ? 'w' : '-';
-    str[3] = (owner & 1) ? 'x' : '-';
-    str[4] = (group & 4) ? 'r' : '-';
-    str[5] = (group & 2) ? 'w' : '-';
-    str[6] = (group & 1) ? 'x' : '-';
-    str[7] = (other & 4) ? 'r' : '-';
-    str[8] = (other & 2) ? 'w' : '-';
-    str[9] = (other & 1) ? 'x' : '-';
-    str[10] = '\0';
-    return str;
-}
-
-void ls_vfs() {
+// Listings are formatted into session_out and written out once per command.
+
+// "<mode>  <links>  <owner>  <group>  <size>  <name>\n"
+static void out_long_entry(OutBuf* ob, uint32_t ino, const char* name) {
+    out_mode(ob, inodes.perm[ino], inodes.is_dir[ino]);
+    out_write(ob, "  ", 2);
+    out_uint(ob, inodes.nlink[ino]);
+    out_write(ob, "  ", 2);
+    out_puts(ob, inode_owner(ino));
+    out_write(ob, "  ", 2);
+    out_puts(ob, inode_group(ino));
+    out_write(ob, "  ", 2);
+    out_uint(ob, inodes.size[ino]);
+    out_write(ob, "  ", 2);
+    out_puts(ob, name);
+    out_putc(ob, '\n');
+}
+
+// "[D] name\n" / "[F] name\n"
+static void out_tagged(OutBuf* ob, int is_dir, const char* name) {
+    out_write(ob, is_dir ? "[D] " : "[F] ", 4);
+    out_puts(ob, name);
+    out_putc(ob, '\n');
+}
+
+// Entries in name order, starting after the cursor `after` (NULL = from the
+// first entry), at most `limit` of them (0 = all), only those matching `g`
+// if one is given. O(log n + k).
+static IndexEntry* ls_start(const char* after, const Glob* g) {
+    if (g) return glob_first(current_dir, g, after);
+    return (after && *after) ? dir_index_seek(&current_dir->index, after, 0)
+                             : dir_index_first(&current_dir->index);
+}
+
+static IndexEntry* ls_next(const IndexEntry* e, const Glob* g) {
+    return g ? glob_scan(g, dir_index_next(e)) : dir_index_next(e);
+}
+
+static void ls_list(const char* after, int limit, const char* pattern, int long_fmt) {
     // Need read (and usually execute) on the dir to list
-    int tdir = get_user_type(current_dir->owner, current_dir->group, current_user);
-    if (!has_permission(current_dir->permission, 'r', tdir)) {
+    int tdir = get_user_type(inode_owner(current_dir->ino), inode_group(current_dir->ino), current_user);
+    if (!has_permission(inodes.perm[current_dir->ino], 'r', tdir)) {
         printf("Permission denied.\n");
         return;
     }
-    for (Directory* dir = current_dir->subdirs; dir; dir = dir->next) {
-        printf("[D] %s\n", dir->name);
-    }
-    for (File* file = current_dir->files; file; file = file->next) {
-        printf("[F] %s\n", file->name);
+    Glob glob;
+    if (pattern && !compile_pattern(&glob, "ls", pattern)) return;
+    const Glob* g = pattern ? &glob : NULL;
+
+    int n = 0;
+    for (IndexEntry* e = ls_start(after, g); e && (limit <= 0 || n < limit); e = ls_next(e, g), ++n) {
+        if (long_fmt) {
+            uint32_t ino = e->is_dir ? ((Directory*)e->node)->ino : ((File*)e->node)->ino;
+            out_long_entry(&session_out, ino, e->name);
+        } else {
+            out_tagged(&session_out, e->is_dir, e->name);
+        }
     }
+    out_flush(&session_out);
+    if (g && n == 0 && !(after && *after)) printf("ls: no match for '%s'\n", pattern);
+    if (g) glob_free(&glob);
+}
+
+void ls_vfs(const char* after, int limit, const char* pattern) {
+    ls_list(after, limit, pattern, 0);
+}
+
+void ls_l_vfs(const char* after, int limit, const char* pattern) {
+    ls_list(after, limit, pattern, 1);
+}
+
+static void print_completion(const IndexEntry* e, void* ctx) {
+    OutBuf* ob = (OutBuf*)ctx;
+    out_puts(ob, e->name);
+    if (e->is_dir) out_putc(ob, '/');
+    out_putc(ob, '\n');
 }
 
-void ls_l_vfs() {
-    int tdir = get_user_type(current_dir->owner, current_dir->group, current_user);
-    if (!has_permission(current_dir->permission, 'r', tdir)) {
+// Prefix search over the current directory, for tab completion
+void complete_vfs(const char* prefix) {
+    int tdir = get_user_type(inode_owner(current_dir->ino), inode_group(current_dir->ino), current_user);
+    if (!has_permission(inodes.perm[current_dir->ino], 'r', tdir)) {
         printf("Permission denied.\n");
         return;
     }
-    for (Directory* dir = current_dir->subdirs; dir; dir = dir->next) {
-        printf("%s  %s  %s  %s\n", permission_str(dir->permission, 1), dir->owner, dir->group, dir->name);
-    }
-    for (File* file = current_dir->files; file; file = file->next) {
-        printf("%s  %s  %s  %s\n", permission_str(file->permission, 0), file->owner, file->group, file->name);
-    }
+    dir_index_prefix(&current_dir->index, prefix, 0, print_completion, &session_out);
+    out_flush(&session_out);
 }
 
-static void tree_recursive(Directory* dir, int depth) {
-    for (int i = 0; i < depth; ++i) printf("  ");
-    printf("[D] %s\n", dir->name);
+// A directory line followed by its files, indented two spaces per level
+static void out_tree_dir(OutBuf* ob, const Directory* dir, size_t depth) {
+    out_indent(ob, 2 * depth);
+    out_tagged(ob, 1, dir->name);
     for (File* f = dir->files; f; f = f->next) {
-        for (int i = 0; i < depth + 1; ++i) printf("  ");
-        printf("[F] %s\n", f->name);
+        out_indent(ob, 2 * (depth + 1));
+        out_tagged(ob, 0, f->name);
     }
-    for (Directory* sub = dir->subdirs; sub; sub = sub->next) {
-        tree_recursive(sub, depth + 1);
+}
+
+// Pre-order walk with an explicit stack of "next sibling to visit" per
+// level, so depth is bounded by memory rather than the C stack.
+static void tree_iterative(Directory* top) {
+    size_t cap = 64, depth = 0;
+    Directory** stack = (Directory**)malloc(cap * sizeof(Directory*));
+    if (!stack) return;
+
+    out_tree_dir(&session_out, top, 0);
+    stack[depth++] = top->subdirs;
+    while (depth > 0) {
+        Directory* d = stack[depth - 1];
+        if (!d) { --depth; continue; }
+        stack[depth - 1] = d->next;
+        out_tree_dir(&session_out, d, depth);
+        if (depth == cap) {
+            Directory** grown = (Directory**)realloc(stack, 2 * cap * sizeof(Directory*));
+            if (!grown) break;
+            stack = grown;
+            cap *= 2;
+        }
+        stack[depth++] = d->subdirs;
     }
+    free(stack);
 }
 
 void tree() {
-    int tdir = get_user_type(current_dir->owner, current_dir->group, current_user);
-    if (!has_permission(current_dir->permission, 'r', tdir)) {
+    int tdir = get_user_type(inode_owner(current_dir->ino), inode_group(current_dir->ino), current_user);
+    if (!has_permission(inodes.perm[current_dir->ino], 'r', tdir)) {
         printf("Permission denied.\n");
         return;
     }
-    tree_recursive(current_dir, 0);
+    tree_iterative(current_dir);
+    out_flush(&session_out);
 }
 
 // === Save/Load ===
+// During a save: first path written for each inode with several links
+static char** link_paths = NULL;
+
+// During a save with the word index on: the inode of each FILE/DATA line,
+// which is how vfs.index names files
+static uint32_t* save_inos = NULL;
+static uint32_t save_nfiles = 0;
+
 static void save_vfs_recursive(FILE* fp, Directory* dir, const char* path) {
     char full_path[1024];
     if (path[0] == '\0') {
@@ -297,256 +616,1695 @@ static void save_vfs_recursive(FILE* fp, Directory* dir, const char* path) {
         snprintf(full_path, sizeof(full_path), "%s/%s", path, dir->name);
     }
 
-    fprintf(fp, "DIR %s %s %s %d\n", full_path, dir->owner, dir->group, dir->permission);
+    fprintf(fp, "DIR %s %s %s %d\n", full_path, inode_owner(dir->ino), inode_group(dir->ino),
+            inodes.perm[dir->ino]);
 
     for (File* f = dir->files; f; f = f->next) {
+        uint32_t ino = f->ino;
+        if (inodes.nlink[ino] > 1 && link_paths) {
+            // The first link saved carries the inode; later ones point at it
+            if (link_paths[ino]) {
+                fprintf(fp, "LINK %s/%s %s\n", full_path, f->name, link_paths[ino]);
+                continue;
+            }
+            char first[1200];
+            snprintf(first, sizeof(first), "%s/%s", full_path, f->name);
+            link_paths[ino] = strdup(first);
+        }
+        if (save_inos) save_inos[save_nfiles++] = ino;
+        if (inodes.extent[ino]) {
+            // Content stays in the store; only where it is gets written
+            fprintf(fp, "DATA %s/%s %s %s %d %u %u\n", full_path, f->name, inode_owner(ino), inode_group(ino),
+                    inodes.perm[ino], inodes.extent[ino], inodes.size[ino]);
+            continue;
+        }
         // NOTE: content with spaces will be split; keeping your original format
-        fprintf(fp, "FILE %s/%s %s %s %d %s\n", full_path, f->name, f->owner, f->group, f->permission, f->content);
+        fprintf(fp, "FILE %s/%s %s %s %d %s\n", full_path, f->name, inode_owner(ino), inode_group(ino),
+                inodes.perm[ino], inode_data(ino));
     }
     for (Directory* sub = dir->subdirs; sub; sub = sub->next) {
         save_vfs_recursive(fp, sub, full_path);
     }
 }
 
-void save_vfs() {
-    FILE* fp = fopen("vfs.txt", "w"); // change to "a" if you want append
+static void save_quota_line(const char* owner, const QuotaUsage* q, void* ctx) {
+    fprintf((FILE*)ctx, "QUOTA %s %lld %lld\n", owner, (long long)q->max_inodes, (long long)q->max_bytes);
+}
+
+static int save_snapshot() {
+    // Write a new snapshot next to the old one and swap it in, so the
+    // journal is only retired once the snapshot is complete
+    if (load_partial) {
+        printf("Not saving over '%s': the last load left entries out\n", VFS_FILE);
+        return -1;
+    }
+    FILE* fp = fopen(VFS_FILE ".tmp", "w");
     if (!fp) {
         perror("Failed to open save file");
-        return;
+        return -1;
     }
+    fprintf(fp, "GEN %lu\n", vfs_generation + 1);
+    if (store_is_open()) fprintf(fp, "STORE %s\n", STORE_FILE);
+    if (wordindex_enabled() && (save_inos = (uint32_t*)malloc(inodes.used * sizeof(uint32_t)))) {
+        fprintf(fp, "INDEX %s\n", WORDINDEX_FILE);
+    }
+    save_nfiles = 0;
+    quota_foreach_limit(save_quota_line, fp);
+    link_paths = (char**)calloc(inodes.used, sizeof(char*));
     for (Directory* d = root->subdirs; d; d = d->next) {
         save_vfs_recursive(fp, d, "");
     }
+    if (link_paths) {
+        for (uint32_t i = 0; i < inodes.used; ++i) free(link_paths[i]);
+        free(link_paths);
+        link_paths = NULL;
+    }
+    // An index that fails to save is rebuilt by the next load: it only
+    // counts for the snapshot generation it names
+    int indexed = save_inos && wordindex_save(WORDINDEX_FILE ".tmp", vfs_generation + 1, save_inos, save_nfiles) == 0;
+    free(save_inos);
+    save_inos = NULL;
+    // Store contents the snapshot names must be on disk before it is
+    if (fclose(fp) != 0 || store_sync() != 0 || rename(VFS_FILE ".tmp", VFS_FILE) != 0) {
+        perror("Failed to write save file");
+        return -1;
+    }
+    if (indexed) rename(WORDINDEX_FILE ".tmp", WORDINDEX_FILE);
+    store_commit();
+    vfs_generation++;
+    storage_epoch++;
+    remove(JOURNAL_FILE);
+    return 0;
+}
+
+int save_vfs() {
+    uint64_t t0 = stats_now_ns();
+    int rc = save_snapshot();
+    stats_inc(STAT_SAVE_CALLS);
+    stats_add(STAT_SAVE_NS, (int64_t)(stats_now_ns() - t0));
+    return rc;
+}
+
+// === Journal ===
+// Append-only log of operations made since the last snapshot. `rm -r`
+// records one line here instead of rewriting the whole snapshot.
+static void journal_append(const char* op, const char* path) {
+    FILE* fp = fopen(JOURNAL_FILE, "a");
+    if (!fp) {
+        perror("Failed to open journal");
+        return;
+    }
+    fprintf(fp, "%s %lu %s\n", op, vfs_generation, path);
     fclose(fp);
+    storage_epoch++;
+}
+
+// Directory at an absolute path under `top`, or NULL
+static Directory* walk_from(Directory* top, const char* path) {
+    char path_copy[1024];
+    strncpy(path_copy, path, sizeof(path_copy) - 1);
+    path_copy[sizeof(path_copy) - 1] = '\0';
+
+    Directory* dir = top;
+    for (char* tok = strtok(path_copy, "/"); tok && dir; tok = strtok(NULL, "/")) {
+        dir = find_subdir(dir, tok);
+    }
+    return dir;
+}
+
+static Directory* resolve_dir(const char* path) {
+    return walk_from(root, path);
+}
+
+// File at an absolute path, or NULL
+static File* resolve_file(const char* path) {
+    char dir_part[1024];
+    strncpy(dir_part, path, sizeof(dir_part) - 1);
+    dir_part[sizeof(dir_part) - 1] = '\0';
+    char* base = strrchr(dir_part, '/');
+    if (!base) return NULL;
+    *base = '\0';
+    Directory* dir = resolve_dir(dir_part);
+    return dir ? find_file(dir, base + 1) : NULL;
+}
+
+// Another name in `dir` for the inode behind `target`; NULL when out of
+// memory
+static File* link_file(Directory* dir, const char* name, File* target) {
+    inode_link(target->ino);
+    File* f = new_entry(dir, name, target->ino);
+    if (!f) {
+        inode_unlink(target->ino);
+        return NULL;
+    }
+    alias_join(f, target);
+    return f;
 }
 
-void load_vfs() {
-    FILE* fp = fopen("vfs.txt", "r");
+// Apply the journal records made on top of snapshot `generation` to the
+// tree under `top`
+static void replay_journal(Directory* top, unsigned long generation) {
+    FILE* fp = fopen(JOURNAL_FILE, "r");
     if (!fp) return;
 
-    char type[10], path[1024], owner[50], group[50], content[1024];
+    char op[16], path[1024];
+    unsigned long gen;
+    while (fscanf(fp, "%15s %lu %1023s", op, &gen, path) == 3) {
+        if (gen != generation) continue; // already folded into a snapshot
+        if (strcmp(op, "RMDIR") == 0) {
+            Directory* d = walk_from(top, path);
+            if (!d || d == top) continue;
+            detach_dir(d);
+            reaper_defer(d);
+        }
+    }
+    fclose(fp);
+}
+
+// Path -> directory cache for the link pass. Keys point into the mapped
+// file, so they are only valid while the TextImage is.
+typedef struct PathSlot {
+    const char* key;
+    size_t len;
+    Directory* dir;
+} PathSlot;
+
+typedef struct PathMap {
+    PathSlot* slots;
+    size_t cap;     // power of two
+    size_t count;
+} PathMap;
+
+static Directory* pathmap_get(const PathMap* m, const char* key, size_t len) {
+    if (!m->cap) return NULL;
+    for (size_t i = fnv1a64(key, len) & (m->cap - 1); m->slots[i].key; i = (i + 1) & (m->cap - 1)) {
+        if (m->slots[i].len == len && memcmp(m->slots[i].key, key, len) == 0) return m->slots[i].dir;
+    }
+    return NULL;
+}
+
+static void pathmap_put(PathMap* m, const char* key, size_t len, Directory* dir) {
+    if ((m->count + 1) * 2 > m->cap) {
+        size_t n = m->cap ? m->cap * 2 : 1024;
+        PathSlot* slots = (PathSlot*)calloc(n, sizeof(PathSlot));
+        if (!slots) return; // only a cache: lookups fall back to the tree
+        for (size_t i = 0; i < m->cap; ++i) {
+            if (!m->slots[i].key) continue;
+            size_t j = fnv1a64(m->slots[i].key, m->slots[i].len) & (n - 1);
+            while (slots[j].key) j = (j + 1) & (n - 1);
+            slots[j] = m->slots[i];
+        }
+        free(m->slots);
+        m->slots = slots;
+        m->cap = n;
+    }
+    size_t i = fnv1a64(key, len) & (m->cap - 1);
+    while (m->slots[i].key) {
+        if (m->slots[i].len == len && memcmp(m->slots[i].key, key, len) == 0) {
+            m->slots[i].dir = dir;
+            return;
+        }
+        i = (i + 1) & (m->cap - 1);
+    }
+    m->slots[i].key = key;
+    m->slots[i].len = len;
+    m->slots[i].dir = dir;
+    m->count++;
+}
+
+static void slice_copy(char* dst, size_t size, TextSlice s) {
+    size_t n = s.len < size - 1 ? s.len : size - 1;
+    memcpy(dst, s.p, n);
+    dst[n] = '\0';
+}
+
+// Owner/group/perm given to directories a line has to create
+typedef struct NewDirMeta {
+    char owner[50];
+    char group[50];
     int perm;
+} NewDirMeta;
+
+// Directory for the path [p, p + len). Starts from the longest prefix
+// already cached and walks the remaining components, creating missing
+// ones with `meta` (NULL: return NULL instead).
+// One load: the tree being built (detached until installed) and what
+// the snapshot says about it
+typedef struct LoadCtx {
+    Directory* root;
+    PathMap map;
+    unsigned long generation;
+    int indexed;           // INDEX line seen and its index not yet adopted
+    char index_path[256];
+    uint32_t* ords;        // inode of each FILE/DATA line, for the saved index
+    uint32_t nords, ord_cap;
+    size_t dropped;        // entries not created for lack of memory or inodes
+    QuotaLedger* quota;    // usage and limits of this tree until it is installed
+} LoadCtx;
+
+static Directory* resolve_cached(LoadCtx* x, const char* p, size_t len, const NewDirMeta* meta) {
+    PathMap* m = &x->map;
+    Directory* dir = pathmap_get(m, p, len);
+    if (dir) return dir;
+
+    size_t cut = len;
+    while (cut > 0) {
+        do { --cut; } while (cut > 0 && p[cut] != '/');
+        if (cut > 0 && (dir = pathmap_get(m, p, cut))) break;
+    }
+    if (!dir) dir = x->root;
+
+    size_t i = cut;
+    while (i < len) {
+        while (i < len && p[i] == '/') ++i;
+        if (i == len) break;
+        size_t j = i;
+        while (j < len && p[j] != '/') ++j;
+        char name[100];
+        slice_copy(name, sizeof(name), (TextSlice){ p + i, j - i });
+        Directory* next = find_subdir(dir, name);
+        if (!next) {
+            if (!meta) return NULL;
+            next = new_dir(dir, name, meta->owner, meta->group, meta->perm);
+            if (!next) return NULL;
+        }
+        dir = next;
+        pathmap_put(m, p, j, dir);
+        i = j;
+    }
+    return dir;
+}
+
+// Split "<dir>/<name>"; 0 if there is no '/'
+static int split_last(TextSlice path, TextSlice* dir, char* name, size_t size) {
+    size_t k = path.len;
+    while (k > 0 && path.p[k - 1] != '/') --k;
+    if (k == 0) return 0;
+    dir->p = path.p;
+    dir->len = k - 1;
+    slice_copy(name, size, (TextSlice){ path.p + k, path.len - k });
+    return 1;
+}
+
+// Give a loaded DATA file its content: the extent the snapshot names,
+// shared with a live inode that already holds it (reload). One outside
+// the store or overlapping another extent leaves the file empty.
+static void load_extent(File* f, long long block, long long size) {
+    if (size <= 0) return;
+    if (block > 0 && block <= UINT32_MAX && size <= UINT32_MAX &&
+        store_claim((uint32_t)block, (size_t)size) == 1) {
+        inode_adopt_extent(f->ino, (uint32_t)block, (uint32_t)size);
+        tree_charge(f->dir, 0, size);
+        return;
+    }
+    printf("Content of '%s' is missing from the store\n", f->name);
+}
+
+// Index the files loaded so far from their content and stop recording:
+// the saved index did not fit, or was adopted (nords reset to 0)
+static void index_loaded(LoadCtx* x) {
+    wordindex_pause(0);
+    for (uint32_t i = 0; i < x->nords; ++i) {
+        uint32_t ino = x->ords[i];
+        if (ino != INODE_NONE) wordindex_update(ino, "", 0, inode_data(ino), inodes.size[ino]);
+    }
+    free(x->ords);
+    x->ords = NULL;
+    x->nords = x->ord_cap = 0;
+    x->indexed = 0;
+}
+
+// Note the inode of the next FILE/DATA line (INODE_NONE if none was made)
+static void load_ord(LoadCtx* x, uint32_t ino) {
+    if (!x->indexed) return;
+    if (x->nords == x->ord_cap) {
+        uint32_t cap = x->ord_cap ? x->ord_cap * 2 : 1024;
+        uint32_t* grown = (uint32_t*)realloc(x->ords, cap * sizeof(uint32_t));
+        if (!grown) {
+            index_loaded(x);
+            if (ino != INODE_NONE) wordindex_update(ino, "", 0, inode_data(ino), inodes.size[ino]);
+            return;
+        }
+        x->ords = grown;
+        x->ord_cap = cap;
+    }
+    x->ords[x->nords++] = ino;
+}
+
+// After the snapshot's files are in: adopt the index saved with it, or
+// index them from their content if it does not belong to this snapshot
+static void load_index(LoadCtx* x) {
+    if (wordindex_load(x->index_path, x->generation, x->ords, x->nords) == 0) x->nords = 0;
+    index_loaded(x);
+}
+
+// Apply one parsed line; 0 stops the load (same points where the
+// fscanf-based loader used to give up)
+static int link_record(LoadCtx* x, const TextRecord* r) {
+    NewDirMeta meta;
+    TextSlice dir_part;
+    char name[100];
+
+    switch (r->type) {
+    case REC_GEN:
+        x->generation = (unsigned long)r->a;
+        return 1;
+    case REC_QUOTA: {
+        char owner[50];
+        slice_copy(owner, sizeof(owner), r->path);
+        quota_ledger_set_limit(x->quota, owner, r->a, r->b);
+        return 1;
+    }
+    case REC_DIR:
+        // Missing parents get the leaf's metadata, as they always have
+        slice_copy(meta.owner, sizeof(meta.owner), r->owner);
+        slice_copy(meta.group, sizeof(meta.group), r->group);
+        meta.perm = r->perm;
+        if (!resolve_cached(x, r->path.p, r->path.len, &meta)) x->dropped++;
+        return 1;
+    case REC_FILE: {
+        if (!split_last(r->path, &dir_part, name, sizeof(name))) {
+            load_ord(x, INODE_NONE);
+            return 1;
+        }
+        snprintf(meta.owner, sizeof(meta.owner), "X");
+        snprintf(meta.group, sizeof(meta.group), "X");
+        meta.perm = 755;
+        Directory* dir = resolve_cached(x, dir_part.p, dir_part.len, &meta);
+        char owner[50], group[50], content[LOADER_CONTENT_MAX + 1];
+        slice_copy(owner, sizeof(owner), r->owner);
+        slice_copy(group, sizeof(group), r->group);
+        slice_copy(content, sizeof(content), r->content);
+        File* f = dir ? new_file(dir, name, owner, group, r->perm, content) : NULL;
+        if (!f) x->dropped++;
+        load_ord(x, f ? f->ino : INODE_NONE);
+        return 1;
+    }
+    case REC_STORE: {
+        char path[256];
+        slice_copy(path, sizeof(path), r->path);
+        if (!store_is_open() && store_open(path, 0) != 0) {
+            printf("Failed to open content store '%s': %s\n", path, strerror(errno));
+        }
+        return 1;
+    }
+    case REC_INDEX:
+        // Files that follow are indexed from the saved index, not their content
+        if (!x->indexed) {
+            if (!wordindex_enabled()) wordindex_enable(1);
+            slice_copy(x->index_path, sizeof(x->index_path), r->path);
+            x->indexed = 1;
+            wordindex_pause(1);
+        }
+        return 1;
+    case REC_DATA: {
+        if (!split_last(r->path, &dir_part, name, sizeof(name))) {
+            load_ord(x, INODE_NONE);
+            return 1;
+        }
+        snprintf(meta.owner, sizeof(meta.owner), "X");
+        snprintf(meta.group, sizeof(meta.group), "X");
+        meta.perm = 755;
+        Directory* dir = resolve_cached(x, dir_part.p, dir_part.len, &meta);
+        char owner[50], group[50];
+        slice_copy(owner, sizeof(owner), r->owner);
+        slice_copy(group, sizeof(group), r->group);
+        File* f = dir ? new_file(dir, name, owner, group, r->perm, "") : NULL;
+        if (!f) {
+            x->dropped++;
+            load_ord(x, INODE_NONE);
+            return 1;
+        }
+        load_extent(f, r->a, r->b);
+        load_ord(x, f->ino);
+        return 1;
+    }
+    case REC_LINK: {
+        TextSlice target_dir;
+        char target_name[100];
+        if (!split_last(r->content, &target_dir, target_name, sizeof(target_name))) return 1;
+        Directory* td = resolve_cached(x, target_dir.p, target_dir.len, NULL);
+        File* t = td ? find_file(td, target_name) : NULL;
+        if (!t || !split_last(r->path, &dir_part, name, sizeof(name))) return 1;
+        Directory* dir = resolve_cached(x, dir_part.p, dir_part.len, NULL);
+        if (dir && !find_subdir(dir, name) && !find_file(dir, name) && !link_file(dir, name, t)) {
+            x->dropped++;
+        }
+        return 1;
+    }
+    case REC_STOP:
+        return 0;
+    }
+    return 1;
+}
 
-    while (fscanf(fp, "%9s", type) == 1) {
-        if (strcmp(type, "DIR") == 0) {
-            if (fscanf(fp, "%1023s %49s %49s %d", path, owner, group, &perm) != 4) break;
-
-            char path_copy[1024];
-            strncpy(path_copy, path, sizeof(path_copy) - 1);
-            path_copy[sizeof(path_copy) - 1] = '\0';
-
-            char* tok = strtok(path_copy, "/");
-            Directory* dir = root;
-            while (tok) {
-                Directory* next = find_subdir(dir, tok);
-                if (!next) {
-                    next = (Directory*)malloc(sizeof(Directory));
-                    strcpy(next->name, tok);
-                    // Use provided meta only when creating the leaf; OK to keep for all levels in this simplified model
-                    strcpy(next->owner, owner);
-                    strcpy(next->group, group);
-                    next->permission = perm;
-                    next->parent = dir;
-                    next->subdirs = NULL;
-                    next->files = NULL;
-                    next->next = dir->subdirs;
-                    dir->subdirs = next;
+// Build a whole tree from vfs.txt (parsed in parallel by loader.c, then
+// linked in file order) and the journal. The tree stays detached, and
+// only nodes it creates are touched besides the locked inode table,
+// quota ledger and store, so this may run off the session thread. NULL if not
+// even the root could be made; entries that could not be are left out.
+static Directory* build_tree(unsigned long* generation, size_t* dropped) {
+    uint64_t t0 = stats_now_ns();
+    LoadCtx x;
+    memset(&x, 0, sizeof(x));
+    if (!(x.quota = quota_ledger_new())) return NULL;
+    inode_acct_begin(x.quota);
+    x.root = new_dir(NULL, "/", "root", "root", 755);
+    if (!x.root) {
+        inode_acct_end();
+        inode_acct_discard();
+        return NULL;
+    }
+
+    TextImage img;
+    if (text_image_load(VFS_FILE, 0, &img) == 0) {
+        stats_add(STAT_LOAD_BYTES, (int64_t)img.size);
+        stats_add(STAT_LOAD_PARSE_NS, (int64_t)(stats_now_ns() - t0));
+        for (int c = 0; c < img.nchunks; ++c) {
+            const TextChunk* chunk = &img.chunks[c];
+            size_t i = 0;
+            while (i < chunk->count && link_record(&x, &chunk->records[i])) ++i;
+            if (i < chunk->count || chunk->failed) break;
+        }
+        store_load_end();
+        if (x.indexed) load_index(&x);
+        free(x.map.slots);
+        text_image_free(&img);
+    }
+    if (!find_subdir(x.root, "home") && !new_dir(x.root, "home", "root", "root", 755)) x.dropped++;
+    replay_journal(x.root, x.generation);
+    inode_acct_end();
+    if (x.dropped) printf("load: %zu entries left out: No space left on device\n", x.dropped);
+
+    *generation = x.generation;
+    *dropped = x.dropped;
+    stats_inc(STAT_LOAD_CALLS);
+    stats_add(STAT_LOAD_NS, (int64_t)(stats_now_ns() - t0));
+    return x.root;
+}
+
+// Swap in a tree from build_tree and hand the old one to the reaper.
+// current_dir moves to the same path (or its deepest surviving ancestor).
+// O(depth), whatever the size of either tree.
+static void install_tree(Directory* fresh, unsigned long generation, size_t dropped) {
+    char path[1024];
+    dir_path(current_dir, path, sizeof(path));
+    Directory* old = root;
+    root = fresh;
+    inode_acct_adopt(); // the old tree stops counting, the new one starts
+    vfs_generation = generation;
+    load_partial = dropped != 0;
+    current_dir = root;
+    for (char* tok = strtok(path, "/"); tok; tok = strtok(NULL, "/")) {
+        Directory* d = find_subdir(current_dir, tok);
+        if (!d) break;
+        current_dir = d;
+    }
+    if (old) reaper_defer(old);
+}
+
+// === Background reload ===
+#define RELOAD_ATTEMPTS 3
+
+typedef struct ReloadJob {
+    pthread_t tid;
+    int running;              // session thread only
+    int done;                 // set by the worker once `fresh` is built
+    Directory* fresh;
+    unsigned long generation;
+    size_t dropped;
+    unsigned long epoch;      // storage_epoch when the build started
+    uint64_t started_ns;
+    uint64_t build_ns;
+    int attempts;
+} ReloadJob;
+
+static ReloadJob reload_job;
+
+static void* reload_worker(void* arg) {
+    ReloadJob* job = (ReloadJob*)arg;
+    background_priority();
+    job->fresh = build_tree(&job->generation, &job->dropped);
+    job->build_ns = stats_now_ns() - job->started_ns;
+    __atomic_store_n(&job->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static int reload_start(void) {
+    reload_job.done = 0;
+    reload_job.fresh = NULL;
+    reload_job.epoch = storage_epoch;
+    reload_job.started_ns = stats_now_ns();
+    int rc = pthread_create(&reload_job.tid, NULL, reload_worker, &reload_job);
+    if (rc != 0) {
+        printf("reload: cannot start: %s\n", strerror(rc));
+        return 0;
+    }
+    reload_job.running = 1;
+    return 1;
+}
+
+int load_vfs() {
+    reload_cancel();
+    unsigned long generation;
+    size_t dropped;
+    Directory* fresh = build_tree(&generation, &dropped);
+    if (!fresh) {
+        printf("load: No space left on device; keeping the current tree\n");
+        return -1;
+    }
+    install_tree(fresh, generation, dropped);
+    return dropped ? -1 : 0;
+}
+
+// reload: like load, but the new tree is built on a background thread
+// while this one keeps serving the old; reload_poll() swaps them.
+int reload_vfs() {
+    if (reload_job.running) {
+        printf("reload: already in progress\n");
+        return -1;
+    }
+    reload_job.attempts = 1;
+    if (!reload_start()) return -1;
+    printf("Reloading '%s' in the background.\n", VFS_FILE);
+    return 0;
+}
+
+void reload_poll() {
+    if (!reload_job.running || !__atomic_load_n(&reload_job.done, __ATOMIC_ACQUIRE)) return;
+    pthread_join(reload_job.tid, NULL);
+    reload_job.running = 0;
+    if (reload_job.epoch != storage_epoch) {
+        // Saved or journaled meanwhile: the new tree is already out of date
+        reaper_defer(reload_job.fresh);
+        inode_acct_discard();
+        if (reload_job.attempts >= RELOAD_ATTEMPTS) {
+            printf("reload: storage kept changing; gave up after %d attempts\n", RELOAD_ATTEMPTS);
+            return;
+        }
+        reload_job.attempts++;
+        if (reload_start()) printf("reload: storage changed while loading; starting over\n");
+        return;
+    }
+    if (!reload_job.fresh) {
+        printf("reload: No space left on device; keeping the current tree\n");
+        return;
+    }
+    uint64_t t0 = stats_now_ns();
+    install_tree(reload_job.fresh, reload_job.generation, reload_job.dropped);
+    uint64_t pause = stats_now_ns() - t0;
+    printf("Reloaded %lld nodes (built in %.1f ms in the background, swapped in %.1f us).\n",
+           (long long)root->tree_inodes, reload_job.build_ns / 1e6, pause / 1e3);
+}
+
+void reload_cancel() {
+    if (!reload_job.running) return;
+    pthread_join(reload_job.tid, NULL);
+    reload_job.running = 0;
+    reaper_defer(reload_job.fresh);
+    inode_acct_discard();
+}
+
+// === Hard links ===
+// ln TARGET NAME: TARGET is a file in the current directory or an
+// absolute path; NAME is created in the current directory.
+int ln_vfs(const char* target, const char* name) {
+    File* t = target[0] == '/' ? resolve_file(target) : find_file(current_dir, target);
+    if (!t) {
+        Directory* d = target[0] == '/' ? resolve_dir(target) : find_subdir(current_dir, target);
+        if (d) printf("ln: '%s': hard link not allowed for directory\n", target);
+        else printf("ln: failed to access '%s': No such file or directory\n", target);
+        return -1;
+    }
+    int tdir = get_user_type(inode_owner(current_dir->ino), inode_group(current_dir->ino), current_user);
+    if (!has_permission(inodes.perm[current_dir->ino], 'w', tdir) ||
+        !has_permission(inodes.perm[current_dir->ino], 'x', tdir)) {
+        printf("Permission denied.\n");
+        return -1;
+    }
+    if (find_file(current_dir, name) || find_subdir(current_dir, name)) {
+        printf("ln: failed to create hard link '%s': File exists\n", name);
+        return -1;
+    }
+    if (!link_file(current_dir, name, t)) {
+        printf("ln: failed to create hard link '%s': Cannot allocate memory\n", name);
+        return -1;
+    }
+    printf("Link '%s' => '%s' created.\n", name, target);
+    save_vfs();
+    return 0;
+}
+
+// === Import ===
+#define IMPORT_ID_CACHE 64
+
+// Host uid/gid -> VFS name for one import
+typedef struct IdCache {
+    unsigned ids[IMPORT_ID_CACHE];
+    char names[IMPORT_ID_CACHE][50];
+    size_t count;
+} IdCache;
+
+// The host name if the VFS knows it, else the importing user (whose
+// personal group doubles as the fallback group)
+static const char* map_host_id(IdCache* c, unsigned id, int is_group) {
+    for (size_t i = 0; i < c->count; ++i) {
+        if (c->ids[i] == id) return c->names[i];
+    }
+    size_t slot = c->count < IMPORT_ID_CACHE ? c->count++ : IMPORT_ID_CACHE - 1;
+    char buf[4096];
+    const char* name = NULL;
+    if (is_group) {
+        struct group gr, *res = NULL;
+        if (getgrgid_r((gid_t)id, &gr, buf, sizeof(buf), &res) == 0 && res && group_present(res->gr_name)) {
+            name = res->gr_name;
+        }
+    } else {
+        struct passwd pw, *res = NULL;
+        if (getpwuid_r((uid_t)id, &pw, buf, sizeof(buf), &res) == 0 && res && user_present(res->pw_name)) {
+            name = res->pw_name;
+        }
+    }
+    c->ids[slot] = id;
+    snprintf(c->names[slot], sizeof(c->names[slot]), "%s", name ? name : current_user);
+    return c->names[slot];
+}
+
+typedef struct ImportFrame {
+    const ImportNode* node;
+    Directory* dir;
+} ImportFrame;
+
+// Build the staged tree as a detached subtree named `name`. Only root
+// keeps host ownership; anyone else gets every node as their own, since
+// they could not chown it afterwards either. NULL when out of memory or
+// inodes.
+static Directory* import_build(const ImportTree* t, const char* name) {
+    int keep_ids = strcmp(current_user, "root") == 0;
+    IdCache users, groups;
+    users.count = groups.count = 0;
+#define OWNER(n) (keep_ids ? map_host_id(&users, (n)->uid, 0) : current_user)
+#define GROUP(n) (keep_ids ? map_host_id(&groups, (n)->gid, 1) : current_user)
+
+    size_t cap = 256, top = 0;
+    ImportFrame* stack = (ImportFrame*)malloc(cap * sizeof(ImportFrame));
+    if (!stack) return NULL;
+    Directory* top_dir = new_dir(NULL, name, OWNER(t->root), GROUP(t->root), t->root->perm);
+    if (!top_dir) {
+        free(stack);
+        return NULL;
+    }
+    stack[top++] = (ImportFrame){ t->root, top_dir };
+    while (top) {
+        ImportFrame f = stack[--top];
+        for (const ImportNode* n = f.node->children; n; n = n->next) {
+            if (!n->is_dir) {
+                if (!new_file(f.dir, n->name, OWNER(n), GROUP(n), n->perm, n->content ? n->content : "")) {
+                    goto fail;
                 }
-                dir = next;
-                tok = strtok(NULL, "/");
+                continue;
             }
-        } else if (strcmp(type, "FILE") == 0) {
-            // Read the rest of the line after "FILE "
-            char line[2048];
-            if (!fgets(line, sizeof(line), fp)) continue;
-            // Trim leading spaces
-            char* s = line;
-            while (*s == ' ' || *s == '\t') ++s;
-            // Parse first 4 tokens: path owner group perm
-            if (sscanf(s, "%1023s %49s %49s %d", path, owner, group, &perm) < 4) continue;
-
-            // Move pointer past first 4 tokens to get content (may contain spaces)
-            int tokens = 0;
-            while (*s && tokens < 4) {
-                if (*s == ' ') { ++tokens; while (*s == ' ') ++s; }
-                else ++s;
-            }
-            // s now points somewhere mid; find start of content
-            char* content_start = strchr(s, ' ');
-            if (content_start) {
-                while (*content_start == ' ') ++content_start;
-                strncpy(content, content_start, sizeof(content) - 1);
-                content[sizeof(content) - 1] = '\0';
-                // strip trailing newline
-                content[strcspn(content, "\r\n")] = 0;
-            } else {
-                content[0] = '\0';
+            Directory* sub = new_dir(f.dir, n->name, OWNER(n), GROUP(n), n->perm);
+            if (!sub) goto fail;
+            if (top == cap) {
+                ImportFrame* grown = (ImportFrame*)realloc(stack, cap * 2 * sizeof(ImportFrame));
+                if (!grown) goto fail;
+                stack = grown;
+                cap *= 2;
             }
+            stack[top++] = (ImportFrame){ n, sub };
+        }
+    }
+#undef OWNER
+#undef GROUP
+    free(stack);
+    return top_dir;
+
+fail:
+    free(stack);
+    reaper_defer(top_dir);
+    return NULL;
+}
 
-            char* base = strrchr(path, '/');
-            if (!base) continue;
-            *base = '\0';
-            char* fname = base + 1;
-
-            Directory* dir = root;
-            char path_copy[1024];
-            strncpy(path_copy, path, sizeof(path_copy) - 1);
-            path_copy[sizeof(path_copy) - 1] = '\0';
-
-            char* p = strtok(path_copy, "/");
-            while (p) {
-                Directory* next = find_subdir(dir, p);
-                if (!next) { // shouldn't be missing if DIR lines were processed, but be robust
-                    next = (Directory*)malloc(sizeof(Directory));
-                    strcpy(next->name, p);
-                    strcpy(next->owner, "X");
-                    strcpy(next->group, "X");
-                    next->permission = 755;
-                    next->parent = dir;
-                    next->subdirs = NULL;
-                    next->files = NULL;
-                    next->next = dir->subdirs;
-                    dir->subdirs = next;
-                }
-                dir = next;
-                p = strtok(NULL, "/");
+// Every directory above dir must be searchable, as when reaching it with cd
+static int path_searchable(const Directory* dir) {
+    for (const Directory* d = dir->parent; d; d = d->parent) {
+        int t = get_user_type(inode_owner(d->ino), inode_group(d->ino), current_user);
+        if (!has_permission(inodes.perm[d->ino], 'x', t)) return 0;
+    }
+    return 1;
+}
+
+// Directory at `path`, absolute or relative to the current directory
+// ("." and ".." allowed); NULL if any component is missing
+static Directory* lookup_dir(const char* path) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", path);
+    Directory* dir = buf[0] == '/' ? root : current_dir;
+    for (char* tok = strtok(buf, "/"); tok && dir; tok = strtok(NULL, "/")) {
+        if (strcmp(tok, ".") == 0) continue;
+        if (strcmp(tok, "..") == 0) dir = dir->parent ? dir->parent : dir;
+        else dir = find_subdir(dir, tok);
+    }
+    return dir;
+}
+
+// Parent directory for a new entry at `path` (absolute, or relative to
+// the current directory); the last component is copied to `name`.
+static Directory* resolve_new_entry(const char* path, char* name, size_t size) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", path);
+    size_t len = strlen(buf);
+    while (len > 1 && buf[len - 1] == '/') buf[--len] = '\0';
+    char* slash = strrchr(buf, '/');
+    const char* last = slash ? slash + 1 : buf;
+    if (!*last || strcmp(last, ".") == 0 || strcmp(last, "..") == 0 || strlen(last) >= size) return NULL;
+    snprintf(name, size, "%s", last);
+    if (!slash) return current_dir;
+    if (slash == buf) return root;
+    *slash = '\0';
+    return lookup_dir(buf);
+}
+
+// import HOSTPATH VFSPATH: copy a host directory tree into a new VFS
+// directory. The host is read in parallel into a staging tree, the nodes
+// are built off to the side and attached in one step, then saved once.
+int import_vfs(const char* host_path, const char* vfs_path) {
+    char name[100];
+    Directory* parent = resolve_new_entry(vfs_path, name, sizeof(name));
+    if (!parent) {
+        printf("import: cannot create '%s': No such directory\n", vfs_path);
+        return -1;
+    }
+    int tdir = get_user_type(inode_owner(parent->ino), inode_group(parent->ino), current_user);
+    if (!path_searchable(parent) || !has_permission(inodes.perm[parent->ino], 'w', tdir) ||
+        !has_permission(inodes.perm[parent->ino], 'x', tdir)) {
+        printf("Permission denied.\n");
+        return -1;
+    }
+    if (find_subdir(parent, name) || find_file(parent, name)) {
+        printf("import: cannot create '%s': File exists\n", vfs_path);
+        return -1;
+    }
+
+    uint64_t t0 = stats_now_ns();
+    ImportTree t;
+    if (import_walk(host_path, 0, &t) != 0) {
+        printf("import: cannot read '%s': %s\n", host_path, strerror(errno));
+        return -1;
+    }
+    uint64_t t1 = stats_now_ns();
+
+    int64_t count = (int64_t)(t.dirs + t.files + 1);
+    if (strcmp(current_user, "root") != 0 && !quota_check(current_user, count, (int64_t)t.bytes)) {
+        printf("import: '%s': Disk quota exceeded (%lld inodes, %zu bytes)\n", host_path,
+               (long long)count, t.bytes);
+        import_tree_free(&t);
+        return -1;
+    }
+    Directory* top = import_build(&t, name);
+    import_tree_free(&t);
+    if (!top) {
+        printf("import: cannot import '%s': No space left on device\n", host_path);
+        return -1;
+    }
+    attach_dir(parent, top);
+    uint64_t t2 = stats_now_ns();
+    save_vfs();
+    uint64_t t3 = stats_now_ns();
+
+    char path[1024];
+    dir_path(top, path, sizeof(path));
+    printf("Imported '%s' into '%s': %zu directories, %zu files, %zu bytes", host_path, path,
+           t.dirs + 1, t.files, t.bytes);
+    if (t.skipped) printf(" (%zu entries skipped)", t.skipped);
+    printf("\n  walk %.1f ms, build %.1f ms, save %.1f ms\n", (t1 - t0) / 1e6, (t2 - t1) / 1e6,
+           (t3 - t2) / 1e6);
+    return 0;
+}
+
+// === Content store ===
+// store: where contents live and how the data file is used.
+// store on|off (root): move every file's content into vfs.data or back
+// onto the heap, then save.
+int store_vfs(const char* arg) {
+    if (!arg) {
+        size_t in_store = 0, on_heap = 0;
+        inode_lock();
+        for (uint32_t ino = 1; ino < inodes.used; ++ino) {
+            if (!inodes.nlink[ino] || !inodes.size[ino]) continue;
+            if (inodes.extent[ino]) ++in_store;
+            else ++on_heap;
+        }
+        inode_unlock();
+        if (!store_is_open()) {
+            printf("Content store: off (%zu files with content on the heap)\n", on_heap);
+            return 0;
+        }
+        StoreInfo info = store_info();
+        printf("Content store: on (%s)\n", STORE_FILE);
+        printf("  file:    %zu bytes\n", info.file_bytes);
+        printf("  used:    %zu blocks of %d bytes\n", info.used_blocks, STORE_BLOCK);
+        printf("  free:    %zu extents, %zu waiting for the next save\n", info.free_extents, info.pending);
+        printf("  dirty:   %zu ranges\n", info.dirty_ranges);
+        printf("  files:   %zu in the store, %zu on the heap\n", in_store, on_heap);
+        return 0;
+    }
+    int on = strcmp(arg, "on") == 0;
+    if (!on && strcmp(arg, "off") != 0) {
+        printf("Usage: store [on|off]\n");
+        return -1;
+    }
+    if (strcmp(current_user, "root") != 0) {
+        printf("store: Operation not permitted\n");
+        return -1;
+    }
+    if (on == store_is_open()) {
+        printf("Content store is already %s.\n", arg);
+        return 0;
+    }
+    // A reload being built claims extents in the store as it goes
+    reload_cancel();
+    if (on && store_open(STORE_FILE, 1) != 0) {
+        printf("store: cannot create '%s': %s\n", STORE_FILE, strerror(errno));
+        return -1;
+    }
+    long moved = inode_store_migrate(on);
+    if (moved < 0) {
+        // Whatever moved is fine where it is; the snapshot records both kinds
+        printf("store: out of space, not every file was moved\n");
+        save_vfs();
+        return -1;
+    }
+    if (save_vfs() != 0) {
+        // The snapshot on disk may still name extents in the store
+        printf("store: snapshot not saved%s\n", on ? "" : "; keeping '" STORE_FILE "'");
+        return -1;
+    }
+    if (!on) {
+        store_close();
+        remove(STORE_FILE);
+    }
+    printf("Content store %s: %ld files moved.\n", arg, moved);
+    return 0;
+}
+
+// === Export ===
+typedef struct ExportCtx {
+    TarWriter tar;
+    char** first;          // archive name of the first link seen per inode
+    uint64_t mtime;        // the VFS keeps no times: export time for all
+    size_t dirs, files, links, bytes, denied, skipped;
+} ExportCtx;
+
+static int export_readable(uint32_t ino, int need_x) {
+    int t = get_user_type(inode_owner(ino), inode_group(ino), current_user);
+    return has_permission(inodes.perm[ino], 'r', t) && (!need_x || has_permission(inodes.perm[ino], 'x', t));
+}
+
+static void export_note(const char* name, const char* why) {
+    printf("export: '%s': %s\n", name, why);
+}
+
+// Directories need r+x to be listed and entered; files need r, as for
+// read. Whatever cannot be read is reported and left out.
+// The member for dir and those for its files; 0 if the walk must not go
+// below it
+static int export_entries(ExportCtx* x, Directory* dir, const char* name) {
+    if (!export_readable(dir->ino, 1)) {
+        export_note(name, "Permission denied");
+        x->denied++;
+        return 0;
+    }
+    if (tar_add(&x->tar, TAR_DIR, name, NULL, inode_owner(dir->ino), inode_group(dir->ino),
+                inodes.mode[dir->ino], x->mtime, NULL, 0) != 0) {
+        if (errno == ENAMETOOLONG) export_note(name, "name too long for ustar");
+        x->skipped++;
+        return 0;
+    }
+    x->dirs++;
+
+    char path[1200];
+    for (File* f = dir->files; f && !x->tar.error; f = f->next) {
+        uint32_t ino = f->ino;
+        snprintf(path, sizeof(path), "%s/%s", name, f->name);
+        if (!export_readable(ino, 0)) {
+            export_note(path, "Permission denied");
+            x->denied++;
+            continue;
+        }
+        const char* link = inodes.nlink[ino] > 1 && x->first ? x->first[ino] : NULL;
+        const char* data = inode_data(ino);
+        int rc = tar_add(&x->tar, link ? TAR_HARDLINK : TAR_FILE, path, link, inode_owner(ino),
+                         inode_group(ino), inodes.mode[ino], x->mtime, data, inodes.size[ino]);
+        if (rc != 0) {
+            if (errno == ENAMETOOLONG) export_note(path, "name too long for ustar");
+            x->skipped++;
+            continue;
+        }
+        if (link) {
+            x->links++;
+            continue;
+        }
+        x->files++;
+        x->bytes += inodes.size[ino];
+        if (inodes.nlink[ino] > 1 && x->first) x->first[ino] = strdup(path);
+    }
+    return 1;
+}
+
+// Preorder over the subtree with a stack of sibling cursors, like
+// tree_iterative; each level remembers where its name ends in `name`
+typedef struct ExportLevel {
+    Directory* next;
+    size_t len;
+} ExportLevel;
+
+static void export_dir(ExportCtx* x, Directory* top, const char* top_name) {
+    if (x->tar.error) return;
+    char name[1200];
+    snprintf(name, sizeof(name), "%s", top_name);
+    if (!export_entries(x, top, name)) return;
+
+    size_t cap = 64, depth = 0;
+    ExportLevel* stack = (ExportLevel*)malloc(cap * sizeof(ExportLevel));
+    if (!stack) {
+        x->tar.error = ENOMEM;
+        return;
+    }
+    stack[depth++] = (ExportLevel){ top->subdirs, strlen(name) };
+    while (depth > 0 && !x->tar.error) {
+        ExportLevel* level = &stack[depth - 1];
+        Directory* d = level->next;
+        if (!d) {
+            --depth;
+            continue;
+        }
+        level->next = d->next;
+        snprintf(name + level->len, sizeof(name) - level->len, "/%s", d->name);
+        if (!export_entries(x, d, name)) continue;
+        if (depth == cap) {
+            ExportLevel* grown = (ExportLevel*)realloc(stack, 2 * cap * sizeof(ExportLevel));
+            if (!grown) {
+                x->tar.error = ENOMEM;
+                break;
             }
+            stack = grown;
+            cap *= 2;
+        }
+        stack[depth++] = (ExportLevel){ d->subdirs, strlen(name) };
+    }
+    free(stack);
+}
 
-            File* f = (File*)malloc(sizeof(File));
-            strcpy(f->name, fname);
-            strcpy(f->owner, owner);
-            strcpy(f->group, group);
-            f->permission = perm;
-            strcpy(f->content, content);
-            f->next = dir->files;
-            dir->files = f;
-        } else {
-            // Unknown line; skip rest of line
-            int c;
-            while ((c = fgetc(fp)) != '\n' && c != EOF) {}
+// export VFSPATH OUT.tar: stream a subtree as a ustar archive, members
+// named from the subtree's own directory down
+int export_vfs(const char* vfs_path, const char* out_path) {
+    Directory* dir = lookup_dir(vfs_path);
+    if (!dir) {
+        printf("export: cannot access '%s': No such directory\n", vfs_path);
+        return -1;
+    }
+    if (!path_searchable(dir)) {
+        printf("export: cannot access '%s': Permission denied\n", vfs_path);
+        return -1;
+    }
+    ExportCtx x;
+    memset(&x, 0, sizeof(x));
+    if (tar_open(&x.tar, out_path) != 0) {
+        printf("export: cannot create '%s': %s\n", out_path, strerror(errno));
+        return -1;
+    }
+    x.mtime = (uint64_t)time(NULL);
+    x.first = (char**)calloc(inodes.used, sizeof(char*));
+
+    uint64_t t0 = stats_now_ns();
+    if (dir == root) {
+        // No member for "/" itself: its children become top-level members
+        for (Directory* sub = root->subdirs; sub && !x.tar.error; sub = sub->next) {
+            export_dir(&x, sub, sub->name);
         }
+    } else {
+        export_dir(&x, dir, dir->name);
     }
-    fclose(fp);
+    uint64_t written = x.tar.written;
+    int rc = tar_close(&x.tar);
+    int err = errno;
+    uint64_t ns = stats_now_ns() - t0;
+    if (x.first) {
+        for (uint32_t i = 0; i < inodes.used; ++i) free(x.first[i]);
+        free(x.first);
+    }
+    if (rc != 0) {
+        printf("export: writing '%s': %s\n", out_path, strerror(err));
+        return -1;
+    }
+
+    printf("Exported '%s' to '%s': %zu directories, %zu files, %zu links, %zu bytes", vfs_path, out_path,
+           x.dirs, x.files, x.links, x.bytes);
+    if (x.denied || x.skipped) printf(" (%zu denied, %zu skipped)", x.denied, x.skipped);
+    printf("\n  archive %llu bytes in %.1f ms (%.1f MB/s)\n", (unsigned long long)written, ns / 1e6,
+           ns ? (double)written / 1e6 / (ns / 1e9) : 0.0);
+    return 0;
 }
 
 // === Remove ===
-void rm_vfs(const char* name) {
-    // POSIX semantics: need w+x on parent directory to unlink
+// POSIX semantics: need w+x on the parent directory to unlink (target
+// perms irrelevant in classic DAC)
+static int parent_writable(void) {
+    int tparent = get_user_type(inode_owner(current_dir->ino), inode_group(current_dir->ino), current_user);
+    return has_permission(inodes.perm[current_dir->ino], 'w', tparent) &&
+           has_permission(inodes.perm[current_dir->ino], 'x', tparent);
+}
+
+int rm_vfs(const char* name) {
+    if (glob_has_magic(name)) {
+        return rm_glob(name, 0);
+    }
     File* f = find_file(current_dir, name);
     if (!f) {
         printf("'%s' is not a file. Use -r to remove directory.\n", name);
-        return;
+        return -1;
+    }
+    if (!parent_writable()) {
+        printf("Permission denied.\n");
+        return -1;
+    }
+    return rm_file_vfs(name);
+}
+
+int rm_r_vfs(const char* name) {
+    if (glob_has_magic(name)) {
+        return rm_glob(name, 1);
     }
+    Directory* d = find_subdir(current_dir, name);
+    if (!d) { printf("'%s' is not a directory.\n", name); return -1; }
 
-    int tparent = get_user_type(current_dir->owner, current_dir->group, current_user);
-    if (!has_permission(current_dir->permission, 'w', tparent) ||
-        !has_permission(current_dir->permission, 'x', tparent)) {
+    if (!parent_writable()) {
         printf("Permission denied.\n");
-        return;
+        return -1;
+    }
+    return rm_dir_vfs(name);
+}
+
+static int rm_file_vfs(const char* name) {
+    File* f = find_file(current_dir, name);
+    if (!f) {
+        printf("File not found.\n");
+        return -1;
     }
-    rm_file_vfs(name);
+    drop_entry(f);
+    printf("File '%s' removed.\n", name);
+    save_vfs(); // save after removal
+    return 0;
 }
 
-void rm_r_vfs(const char* name) {
+// Detach the subtree and hand it to the background reaper; the deletion
+// is persisted as a single journal record rather than a full save.
+static void remove_subtree(Directory* d) {
+    char path[1024];
+    dir_path(d, path, sizeof(path));
+
+    detach_dir(d);
+    journal_append("RMDIR", path);
+    printf("Directory '%s' removed.\n", d->name);
+    reaper_defer(d);
+}
+
+static int rm_dir_vfs(const char* name) {
     Directory* d = find_subdir(current_dir, name);
-    if (!d) { printf("'%s' is not a directory.\n", name); return; }
+    if (!d) {
+        printf("Directory not found.\n");
+        return -1;
+    }
+    remove_subtree(d);
+    return 0;
+}
+
+// rm / rm -r over the names matching `pattern`, each handled as if given
+// by itself. Matched files go in one pass over the list and one save.
+static int rm_glob(const char* pattern, int recursive) {
+    GlobHit* hits;
+    size_t n = glob_hits("rm", pattern, &hits);
+    if (n == 0) return -1;
+    File** files = (File**)malloc(n * sizeof(File*));
+    if (!files || !parent_writable()) {
+        printf(files ? "Permission denied.\n" : "Out of memory.\n");
+        free(files);
+        free(hits);
+        return -1;
+    }
 
-    // Need w+x on parent to remove the entry (target perms irrelevant in classic DAC)
-    int tparent = get_user_type(current_dir->owner, current_dir->group, current_user);
-    if (!has_permission(current_dir->permission, 'w', tparent) ||
-        !has_permission(current_dir->permission, 'x', tparent)) {
+    size_t nfiles = 0;
+    int rc = 0;
+    for (size_t i = 0; i < n; ++i) {
+        GlobHit* h = &hits[i];
+        if (recursive && h->is_dir) {
+            remove_subtree((Directory*)h->node);
+        } else if (!recursive && !h->is_dir) {
+            printf("File '%s' removed.\n", h->name);
+            files[nfiles++] = (File*)h->node;
+        } else if (recursive) {
+            printf("'%s' is not a directory.\n", h->name);
+            rc = -1;
+        } else {
+            printf("'%s' is not a file. Use -r to remove directory.\n", h->name);
+            rc = -1;
+        }
+    }
+    if (nfiles) {
+        drop_entries(current_dir, files, nfiles);
+        save_vfs();
+    }
+    free(files);
+    free(hits);
+    return rc;
+}
+
+// === Usage ===
+// Both read cached counters: O(1) regardless of subtree size.
+void du_vfs(const char* name) {
+    Directory* d = current_dir;
+    if (name && *name) {
+        d = find_subdir(current_dir, name);
+        if (!d) { printf("du: cannot access '%s': No such directory\n", name); return; }
+    }
+    int t = get_user_type(inode_owner(d->ino), inode_group(d->ino), current_user);
+    if (!has_permission(inodes.perm[d->ino], 'r', t)) {
         printf("Permission denied.\n");
         return;
     }
-    rm_dir_vfs(name);
+    char path[1024];
+    dir_path(d, path, sizeof(path));
+    printf("%lld bytes  %lld inodes  %s\n", (long long)d->tree_bytes, (long long)d->tree_inodes, path);
 }
 
-static void rm_file_vfs(const char* name) {
-    File** prev = &current_dir->files;
-    while (*prev) {
-        File* f = *prev;
-        if (strcmp(f->name, name) == 0) {
-            *prev = f->next;
-            free(f);
-            printf("File '%s' removed.\n", name);
-            save_vfs(); // save after removal       
-            return;
+static void print_limit(const char* what, int64_t used, int64_t max) {
+    if (max) printf("  %-7s %lld / %lld\n", what, (long long)used, (long long)max);
+    else printf("  %-7s %lld / unlimited\n", what, (long long)used);
+}
+
+void quota_vfs(const char* user) {
+    QuotaUsage q = quota_get(user);
+    printf("Quota for %s:\n", user);
+    print_limit("inodes:", q.inodes, q.max_inodes);
+    print_limit("bytes:", q.bytes, q.max_bytes);
+}
+
+void quota_set_vfs(const char* user, long long max_inodes, long long max_bytes) {
+    if (strcmp(current_user, "root") != 0) {
+        printf("quota: setting limits: Operation not permitted\n");
+        return;
+    }
+    if (max_inodes < 0 || max_bytes < 0) {
+        printf("quota: invalid limit\n");
+        return;
+    }
+    quota_set_limit(user, max_inodes, max_bytes);
+    printf("Quota for %s set to %lld inodes, %lld bytes (0 = unlimited).\n", user, max_inodes, max_bytes);
+    save_vfs();
+}
+
+// === Metadata scan ===
+// Path of the entry naming ino; 0 if it is not reachable from root (a
+// subtree still waiting for the reaper). Caller holds inode_lock().
+static int inode_path(uint32_t ino, char* out, size_t size) {
+    void* e = inodes.entry[ino];
+    if (!e) return 0;
+    Directory* dir = inodes.is_dir[ino] ? (Directory*)e : ((File*)e)->dir;
+    const Directory* d = dir;
+    while (d && d != root) d = d->parent;
+    if (!d) return 0;
+
+    char base[1024];
+    dir_path(dir, base, sizeof(base));
+    if (inodes.is_dir[ino]) snprintf(out, size, "%s", base);
+    else snprintf(out, size, "%s%s%s", base, strcmp(base, "/") == 0 ? "" : "/", ((File*)e)->name);
+    return 1;
+}
+
+// The per-node check the kernels replace, for the benchmark
+static int walk_match(const ScanQuery* q, const char* user, uint32_t ino) {
+    switch (q->kind) {
+    case SCAN_WORLD_WRITABLE:
+        return has_permission(inodes.perm[ino], 'w', 2);
+    case SCAN_OWNED_BY:
+        return strcmp(inode_owner(ino), user) == 0;
+    case SCAN_READABLE_BY:
+        return has_permission(inodes.perm[ino], 'r',
+                              get_user_type(inode_owner(ino), inode_group(ino), user));
+    }
+    return 0;
+}
+
+static size_t walk_count(const ScanQuery* q, const char* user, Directory* top) {
+    size_t n = 0;
+    size_t cap = 64, depth = 0;
+    Directory** stack = (Directory**)malloc(cap * sizeof(Directory*));
+    if (!stack) return 0;
+
+    stack[depth++] = top;
+    while (depth > 0) {
+        Directory* dir = stack[--depth];
+        n += (size_t)walk_match(q, user, dir->ino);
+        for (File* f = dir->files; f; f = f->next) n += (size_t)walk_match(q, user, f->ino);
+        for (Directory* sub = dir->subdirs; sub; sub = sub->next) {
+            if (depth == cap) {
+                Directory** grown = (Directory**)realloc(stack, 2 * cap * sizeof(Directory*));
+                if (!grown) {
+                    free(stack);
+                    return n;
+                }
+                stack = grown;
+                cap *= 2;
+            }
+            stack[depth++] = sub;
         }
-        prev = &(*prev)->next;
     }
-    printf("File not found.\n");
+    free(stack);
+    return n;
 }
 
-static void rm_dir_recursive(Directory* dir) {
-    while (dir->files) {
-        File* f = dir->files;
-        dir->files = f->next;
-        free(f);
+static void scan_bench(const ScanQuery* q, const char* user, uint64_t* bits) {
+    size_t nodes = inodes.live ? inodes.live : 1;
+    uint64_t t0 = stats_now_ns();
+    size_t n = walk_count(q, user, root);
+    uint64_t walk_ns = stats_now_ns() - t0;
+    printf("%-8s %8zu matches  %10.3f ms  %7.2f ns/node\n", "walk:", n, walk_ns / 1e6,
+           (double)walk_ns / (double)nodes);
+
+    ScanImpl impls[] = { SCAN_IMPL_SCALAR, SCAN_IMPL_SSE2, SCAN_IMPL_AVX2 };
+    for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); ++k) {
+        if (!scan_impl_supported(impls[k])) continue;
+        uint64_t best = UINT64_MAX;
+        for (int rep = 0; rep < 5; ++rep) {
+            t0 = stats_now_ns();
+            n = scan_inodes(q, impls[k], bits);
+            uint64_t ns = stats_now_ns() - t0;
+            if (ns < best) best = ns;
+        }
+        char label[16];
+        snprintf(label, sizeof(label), "%s:", scan_impl_name(impls[k]));
+        printf("%-8s %8zu matches  %10.3f ms  %7.2f ns/node  (%.1fx walk)\n", label, n, best / 1e6,
+               (double)best / (double)nodes, best ? (double)walk_ns / (double)best : 0.0);
     }
-    while (dir->subdirs) {
-        Directory* d = dir->subdirs;
-        dir->subdirs = d->next;
-        rm_dir_recursive(d);
+    printf("(walk counts every link; scans count each inode once, live or awaiting the reaper)\n");
+}
+
+// scan world-writable | owner USER | readable USER, over every node
+void scan_vfs(const char* query, const char* user, int bench) {
+    ScanQuery q;
+    memset(&q, 0, sizeof(q));
+    if (strcmp(query, "world-writable") == 0) {
+        q.kind = SCAN_WORLD_WRITABLE;
+    } else if ((strcmp(query, "owner") == 0 || strcmp(query, "readable") == 0) && user && *user) {
+        q.kind = query[0] == 'o' ? SCAN_OWNED_BY : SCAN_READABLE_BY;
+        q.uid = ident_intern(user);
+        char groups[50][50];
+        int n = get_user_groups(user, groups);
+        for (int i = 0; i < n && q.ngids < SCAN_MAX_GROUPS; ++i) q.gids[q.ngids++] = ident_intern(groups[i]);
+    } else {
+        printf("Usage: scan world-writable | scan owner <user> | scan readable <user> [--bench]\n");
+        return;
     }
-    free(dir);
+
+    inode_lock(); // keeps the reaper from freeing entries under us
+    uint64_t* bits = (uint64_t*)malloc(scan_bitmap_words() * sizeof(uint64_t) + 1);
+    if (!bits) {
+        inode_unlock();
+        printf("scan: out of memory\n");
+        return;
+    }
+    if (bench) {
+        scan_bench(&q, user, bits);
+    } else {
+        ScanImpl impl = scan_best_impl();
+        uint64_t t0 = stats_now_ns();
+        scan_inodes(&q, impl, bits);
+        uint64_t ns = stats_now_ns() - t0;
+
+        size_t shown = 0;
+        char path[1200];
+        for (size_t w = 0; w < scan_bitmap_words(); ++w) {
+            for (uint64_t word = bits[w]; word; word &= word - 1) {
+                uint32_t ino = (uint32_t)(w * 64 + (size_t)__builtin_ctzll(word));
+                if (!inode_path(ino, path, sizeof(path))) continue;
+                out_puts(&session_out, path);
+                out_putc(&session_out, '\n');
+                ++shown;
+            }
+        }
+        out_flush(&session_out);
+        printf("%zu matches (%s scan, %.3f ms)\n", shown, scan_impl_name(impl), ns / 1e6);
+    }
+    free(bits);
+    inode_unlock();
 }
 
-static void rm_dir_vfs(const char* name) {
-    Directory** prev = &current_dir->subdirs;
-    while (*prev) {
-        Directory* d = *prev;
-        if (strcmp(d->name, name) == 0) {
-            *prev = d->next;     // unlink from sibling list
-            rm_dir_recursive(d); // free all children and dir itself
-            printf("Directory '%s' removed.\n", name);
-            save_vfs(); // save after removal
+// === Content search ===
+// The files a grep covers, with their content pointers (valid while
+// inode_lock() is held)
+typedef struct GrepSet {
+    File** files;
+    const char** data;
+    uint32_t* size;
+    size_t n, cap;
+    uint64_t bytes;
+    size_t denied;         // directories and files left out for lack of permission
+} GrepSet;
+
+static int grep_add(GrepSet* s, File* f) {
+    if (s->n == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 256;
+        File** files = (File**)realloc(s->files, cap * sizeof(File*));
+        if (files) s->files = files;
+        const char** data = (const char**)realloc(s->data, cap * sizeof(char*));
+        if (data) s->data = data;
+        uint32_t* size = (uint32_t*)realloc(s->size, cap * sizeof(uint32_t));
+        if (size) s->size = size;
+        if (!files || !data || !size) return 0;
+        s->cap = cap;
+    }
+    s->files[s->n] = f;
+    s->data[s->n] = inode_data(f->ino);
+    s->size[s->n] = inodes.size[f->ino];
+    s->bytes += inodes.size[f->ino];
+    s->n++;
+    return 1;
+}
+
+// Same rules as export: directories need r+x, files need r (as for read).
+// Preorder with a stack of sibling cursors, so hits come out in tree order.
+static int grep_files_of(GrepSet* s, Directory* dir) {
+    if (!export_readable(dir->ino, 1)) {
+        s->denied++;
+        return -1;
+    }
+    for (File* f = dir->files; f; f = f->next) {
+        if (!inodes.size[f->ino]) continue;
+        if (!export_readable(f->ino, 0)) s->denied++;
+        else if (!grep_add(s, f)) return 0;
+    }
+    return 1;
+}
+
+static int grep_collect(GrepSet* s, Directory* top) {
+    int rc = grep_files_of(s, top);
+    if (rc <= 0) return rc == 0 ? 0 : 1;
+
+    size_t cap = 64, depth = 0;
+    Directory** stack = (Directory**)malloc(cap * sizeof(Directory*));
+    if (!stack) return 0;
+    stack[depth++] = top->subdirs;
+    while (depth > 0) {
+        Directory* d = stack[depth - 1];
+        if (!d) {
+            --depth;
+            continue;
+        }
+        stack[depth - 1] = d->next;
+        rc = grep_files_of(s, d);
+        if (rc == 0) break;
+        if (rc < 0) continue;
+        if (depth == cap) {
+            Directory** grown = (Directory**)realloc(stack, 2 * cap * sizeof(Directory*));
+            if (!grown) {
+                rc = 0;
+                break;
+            }
+            stack = grown;
+            cap *= 2;
+        }
+        stack[depth++] = d->subdirs;
+    }
+    free(stack);
+    return rc != 0;
+}
+
+static void grep_bench(const GrepSet* s, const char* pattern) {
+    GrepImpl impls[] = { GREP_IMPL_SCALAR, GREP_IMPL_LIBC, GREP_IMPL_SSE2, GREP_IMPL_AVX2 };
+    uint64_t scalar_ns = 0;
+    int threads = grep_thread_count(s->bytes, 0);
+    for (size_t k = 0; k <= sizeof(impls) / sizeof(impls[0]); ++k) {
+        // Every kernel on one thread, then the best one on all of them
+        int last = k == sizeof(impls) / sizeof(impls[0]);
+        GrepImpl impl = last ? grep_best_impl() : impls[k];
+        if (!grep_impl_supported(impl)) continue;
+        uint64_t best = UINT64_MAX;
+        long n = 0;
+        for (int rep = 0; rep < 5; ++rep) {
+            GrepHit* hits;
+            uint64_t t0 = stats_now_ns();
+            n = grep_files(s->data, s->size, s->n, pattern, impl, last ? threads : 1, &hits);
+            uint64_t ns = stats_now_ns() - t0;
+            free(hits);
+            if (ns < best) best = ns;
+        }
+        if (k == 0) scalar_ns = best;
+        char label[32];
+        snprintf(label, sizeof(label), "%s x%d:", grep_impl_name(impl), last ? threads : 1);
+        printf("%-12s %8ld lines  %10.3f ms  %8.1f MB/s  (%.1fx scalar)\n", label, n, best / 1e6,
+               best ? (double)s->bytes / 1e6 / (best / 1e9) : 0.0, best ? (double)scalar_ns / (double)best : 0.0);
+    }
+    printf("(%zu files, %llu bytes; best of 5)\n", s->n, (unsigned long long)s->bytes);
+}
+
+// grep PATTERN [PATH]: every line containing PATTERN (a literal string)
+// in the files under PATH the current user can read
+void grep_vfs(const char* pattern, const char* path, int bench) {
+    Directory* dir = path ? lookup_dir(path) : current_dir;
+    if (!dir) {
+        printf("grep: cannot access '%s': No such directory\n", path);
+        return;
+    }
+    if (!path_searchable(dir)) {
+        printf("grep: cannot access '%s': Permission denied\n", path);
+        return;
+    }
+
+    inode_lock(); // keeps the reaper from freeing entries under us
+    GrepSet s;
+    memset(&s, 0, sizeof(s));
+    if (!grep_collect(&s, dir)) {
+        printf("grep: out of memory\n");
+    } else if (bench) {
+        grep_bench(&s, pattern);
+    } else {
+        GrepImpl impl = grep_best_impl();
+        GrepHit* hits;
+        uint64_t t0 = stats_now_ns();
+        long n = grep_files(s.data, s.size, s.n, pattern, impl, 0, &hits);
+        uint64_t ns = stats_now_ns() - t0;
+        if (n < 0) {
+            printf("grep: out of memory\n");
+        } else {
+            char dpath[1024];
+            size_t files = 0;
+            for (long i = 0; i < n; ++i) {
+                const GrepHit* h = &hits[i];
+                File* f = s.files[h->file];
+                if (i == 0 || h->file != hits[i - 1].file) {
+                    dir_path(f->dir, dpath, sizeof(dpath));
+                    ++files;
+                }
+                out_puts(&session_out, dpath);
+                if (strcmp(dpath, "/") != 0) out_putc(&session_out, '/');
+                out_puts(&session_out, f->name);
+                out_putc(&session_out, ':');
+                out_uint(&session_out, h->line);
+                out_putc(&session_out, ':');
+                out_write(&session_out, s.data[h->file] + h->start, h->len);
+                out_putc(&session_out, '\n');
+            }
+            out_flush(&session_out);
+            printf("%ld lines in %zu files (%zu files, %llu bytes searched; %s x%d, %.3f ms)", n, files, s.n,
+                   (unsigned long long)s.bytes, grep_impl_name(impl), grep_thread_count(s.bytes, 0), ns / 1e6);
+            if (s.denied) printf(" (%zu denied)", s.denied);
+            printf("\n");
+            free(hits);
+        }
+    }
+    free(s.files);
+    free(s.data);
+    free(s.size);
+    inode_unlock();
+}
+
+// === Word index ===
+// index: what the word index holds. index on|off (root): build it from
+// every file's content or drop it, then save (the snapshot names it).
+void index_vfs(const char* arg) {
+    if (!arg) {
+        if (!wordindex_enabled()) {
+            printf("Word index: off\n");
             return;
         }
-        prev = &(*prev)->next;
+        WordIndexInfo info = wordindex_info();
+        printf("Word index: on (%s)\n", WORDINDEX_FILE);
+        printf("  words:    %zu\n", info.words);
+        printf("  postings: %zu in %zu bytes (%.1f bits each)\n", info.postings, info.bytes,
+               info.postings ? 8.0 * (double)info.bytes / (double)info.postings : 0.0);
+        printf("  memory:   %zu bytes\n", info.memory);
+        if (info.lost) printf("  lost:     %zu updates (out of memory; index off and on to rebuild)\n", info.lost);
+        return;
+    }
+    int on = strcmp(arg, "on") == 0;
+    if (!on && strcmp(arg, "off") != 0) {
+        printf("Usage: index [on|off]\n");
+        return;
+    }
+    if (strcmp(current_user, "root") != 0) {
+        printf("index: Operation not permitted\n");
+        return;
+    }
+    if (on == wordindex_enabled()) {
+        printf("Word index is already %s.\n", arg);
+        return;
+    }
+    if (!on) {
+        wordindex_enable(0);
+        save_vfs();
+        remove(WORDINDEX_FILE);
+        printf("Word index off.\n");
+        return;
+    }
+
+    uint64_t t0 = stats_now_ns();
+    size_t files = 0;
+    wordindex_enable(1);
+    inode_lock(); // includes subtrees waiting for the reaper, as later updates will
+    for (uint32_t ino = 1; ino < inodes.used; ++ino) {
+        if (!inodes.nlink[ino] || inodes.is_dir[ino] || !inodes.size[ino]) continue;
+        wordindex_update(ino, "", 0, inode_data(ino), inodes.size[ino]);
+        ++files;
     }
-    printf("Directory not found.\n");
+    inode_unlock();
+    uint64_t ns = stats_now_ns() - t0;
+    save_vfs();
+    WordIndexInfo info = wordindex_info();
+    printf("Word index on: %zu files, %zu words, %zu postings in %zu bytes (built in %.1f ms).\n", files,
+           info.words, info.postings, info.bytes, ns / 1e6);
 }
 
-// === Ownership (kept as in your version, with minor safety) ===
-void chown_vfs(const char* new_owner, const char* new_group, const char* name) {
-    void* target = NULL;
-    int is_dir = 0;
+// f can be reached by walking down from /: x on every directory above it
+// and r+x on its own, as grep on that directory needs. Not for entries
+// outside the live tree (awaiting the reaper, or a reload not swapped in).
+static int entry_visible(const File* f) {
+    if (!export_readable(f->dir->ino, 1)) return 0;
+    for (const Directory* d = f->dir->parent; d; d = d->parent) {
+        int t = get_user_type(inode_owner(d->ino), inode_group(d->ino), current_user);
+        if (!has_permission(inodes.perm[d->ino], 'x', t)) return 0;
+    }
+    const Directory* top = f->dir;
+    while (top->parent) top = top->parent;
+    return top == root;
+}
 
-    Directory* d = find_subdir(current_dir, name);
-    if (d) { target = d; is_dir = 1; }
-    else {
-        File* f = find_file(current_dir, name);
-        if (f) { target = f; is_dir = 0; }
+// search WORD...: files containing every word, from the index. Only names
+// the caller could find and read with grep are shown; the rest are left
+// out without a count, so a search says nothing about files it cannot read.
+void search_vfs(const char* text) {
+    if (!wordindex_enabled()) {
+        printf("search: the word index is off (see 'index on')\n");
+        return;
     }
-    if (!target) {
-        printf("chown: cannot access '%s': No such file or directory\n", name);
+    uint64_t t0 = stats_now_ns();
+    inode_lock(); // keeps the reaper from freeing entries under us
+    uint32_t* hits;
+    int nwords = 0;
+    long n = wordindex_query(text, &nwords, &hits);
+    if (n < 0) {
+        inode_unlock();
+        printf("search: out of memory\n");
+        return;
+    }
+    if (!nwords) {
+        inode_unlock();
+        printf("Usage: search <word>...\n");
         return;
     }
 
-    char* owner = is_dir ? ((Directory*)target)->owner : ((File*)target)->owner;
-    char* group = is_dir ? ((Directory*)target)->group : ((File*)target)->group;
+    size_t shown = 0;
+    char dpath[1024];
+    for (long i = 0; i < n; ++i) {
+        uint32_t ino = hits[i];
+        File* first = (File*)inodes.entry[ino];
+        if (!inodes.nlink[ino] || inodes.is_dir[ino] || !first || !export_readable(ino, 0)) continue;
+        // Every name of the file the caller can reach
+        File* f = first;
+        do {
+            if (entry_visible(f)) {
+                dir_path(f->dir, dpath, sizeof(dpath));
+                out_puts(&session_out, dpath);
+                if (strcmp(dpath, "/") != 0) out_putc(&session_out, '/');
+                out_puts(&session_out, f->name);
+                out_putc(&session_out, '\n');
+                ++shown;
+            }
+            f = f->alias;
+        } while (f != first);
+    }
+    out_flush(&session_out);
+    inode_unlock();
+    free(hits);
+    printf("%zu files (word index, %.3f ms)\n", shown, (stats_now_ns() - t0) / 1e6);
+}
 
+// === Ownership (kept as in your version, with minor safety) ===
+static int chown_entry(const char* new_owner, const char* new_group, uint32_t ino, const char* name) {
     // Owner change – root only
     if (new_owner && *new_owner) {
         if (strcmp(current_user, "root") != 0) {
             printf("chown: changing owner of '%s': Operation not permitted\n", name);
-            return;
+            return -1;
         }
-        strcpy(owner, new_owner);
+        // One inode changes hands (every link to it); chown is not recursive
+        inode_chown(ino, new_owner, NULL);
     }
 
     // Group change – root OR owner in target group
     if (new_group && *new_group) {
         if (strcmp(current_user, "root") != 0) {
-            if (strcmp(owner, current_user) != 0 || !user_in_group(current_user, new_group)) {
+            if (strcmp(inode_owner(ino), current_user) != 0 || !user_in_group(current_user, new_group)) {
                 printf("chown: changing group of '%s': Operation not permitted\n", name);
-                return;
+                return -1;
             }
         }
-        strcpy(group, new_group);
+        inode_chown(ino, NULL, new_group);
     }
 
-    printf("Ownership of '%s' changed to %s:%s\n", name, owner, group);
+    printf("Ownership of '%s' changed to %s:%s\n", name, inode_owner(ino), inode_group(ino));
+    return 0;
+}
+
+int chown_vfs(const char* new_owner, const char* new_group, const char* name) {
+    if (glob_has_magic(name)) {
+        GlobHit* hits;
+        size_t n = glob_hits("chown", name, &hits);
+        int rc = n ? 0 : -1;
+        for (size_t i = 0; i < n; ++i) {
+            if (chown_entry(new_owner, new_group, hits[i].ino, hits[i].name) != 0) rc = -1;
+        }
+        free(hits);
+        return rc;
+    }
+
+    void* target = NULL;
+    int is_dir = 0;
+
+    Directory* d = find_subdir(current_dir, name);
+    if (d) { target = d; is_dir = 1; }
+    else {
+        File* f = find_file(current_dir, name);
+        if (f) { target = f; is_dir = 0; }
+    }
+    if (!target) {
+        printf("chown: cannot access '%s': No such file or directory\n", name);
+        return -1;
+    }
+
+    uint32_t ino = is_dir ? ((Directory*)target)->ino : ((File*)target)->ino;
+    return chown_entry(new_owner, new_group, ino, name);
 }
 // ===== CHMOD helpers =====
 static void split_perm(int perm, int* u, int* g, int* o) {
@@ -638,39 +2396,19 @@ static int parse_symbolic_mode(const char* mode, int* u, int* g, int* o) {
 }
 
 // === Public: chmod ===
-// Only the owner or root can change mode. NAME is looked up in current_dir.
-void chmod_vfs(const char* mode, const char* name) {
-    if (!mode || !name || !*mode || !*name) {
-        printf("chmod: missing operand\n");
-        return;
-    }
-
-    // find target (file or dir) in current_dir
-    Directory* d = NULL;
-    File* f = NULL;
-    for (Directory* it = current_dir->subdirs; it; it = it->next) {
-        if (strcmp(it->name, name) == 0) { d = it; break; }
-    }
-    if (!d) {
-        for (File* it = current_dir->files; it; it = it->next) {
-            if (strcmp(it->name, name) == 0) { f = it; break; }
-        }
-    }
-    if (!d && !f) {
-        printf("chmod: cannot access '%s': No such file or directory\n", name);
-        return;
-    }
-
+// 0 if changed, -1 if refused, -2 if the mode itself is invalid (no point
+// trying other names)
+static int chmod_entry(const char* mode, uint32_t ino, const char* name) {
     // Ownership check: root or owner
-    const char* owner = d ? d->owner : f->owner;
+    const char* owner = inode_owner(ino);
     if (strcmp(current_user, "root") != 0 && strcmp(owner, current_user) != 0) {
         printf("chmod: changing permissions of '%s': Operation not permitted\n", name);
-        return;
+        return -1;
     }
 
     // Work with triplet
     int u, g, o;
-    int perm = d ? d->permission : f->permission;
+    int perm = inodes.perm[ino];
     split_perm(perm, &u, &g, &o);
 
     // Numeric mode? (e.g., "755", "0644")
@@ -679,25 +2417,55 @@ void chmod_vfs(const char* mode, const char* name) {
         if (strlen(mode) == 4 && mode[0] == '0') s = mode + 1; // allow leading 0
         if (strlen(s) != 3) {
             printf("chmod: invalid mode: '%s'\n", mode);
-            return;
+            return -2;
         }
         int nu = s[0] - '0', ng = s[1] - '0', no = s[2] - '0';
         if (nu > 7 || ng > 7 || no > 7) {
             printf("chmod: invalid mode: '%s'\n", mode);
-            return;
+            return -2;
         }
         u = nu; g = ng; o = no;
     } else {
         // Symbolic mode
         if (!parse_symbolic_mode(mode, &u, &g, &o)) {
             printf("chmod: invalid mode: '%s'\n", mode);
-            return;
+            return -2;
         }
     }
 
     int newperm = join_perm(u, g, o);
-    if (d) d->permission = newperm;
-    else    f->permission = newperm;
+    inode_set_perm(ino, newperm);
 
     printf("mode of '%s' changed to %03d\n", name, newperm);
-}
\ No newline at end of file
+    return 0;
+}
+
+// Only the owner or root can change mode. NAME is looked up in current_dir.
+int chmod_vfs(const char* mode, const char* name) {
+    if (!mode || !name || !*mode || !*name) {
+        printf("chmod: missing operand\n");
+        return -1;
+    }
+
+    if (glob_has_magic(name)) {
+        GlobHit* hits;
+        size_t n = glob_hits("chmod", name, &hits);
+        int rc = n ? 0 : -1;
+        for (size_t i = 0; i < n; ++i) {
+            int r = chmod_entry(mode, hits[i].ino, hits[i].name);
+            if (r != 0) rc = -1;
+            if (r == -2) break;
+        }
+        free(hits);
+        return rc;
+    }
+
+    // find target (file or dir) in current_dir
+    Directory* d = find_subdir(current_dir, name);
+    File* f = d ? NULL : find_file(current_dir, name);
+    if (!d && !f) {
+        printf("chmod: cannot access '%s': No such file or directory\n", name);
+        return -1;
+    }
+    return chmod_entry(mode, d ? d->ino : f->ino, name) == 0 ? 0 : -1;
+}
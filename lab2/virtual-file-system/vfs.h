@@ -2,25 +2,30 @@
 #define VFS_H
 
 #include <stdio.h>
+#include <stdint.h>
+#include "dirindex.h"
 
+// Directory entries: a name plus an inode number. Owner, group, mode,
+// link count and content live in the inode table (inode.h).
 typedef struct File {
     char name[100];
-    char owner[50];
-    char group[50];        // ✅ NEW
-    int permission;        // like 754
-    char content[1024];
+    uint32_t ino;
+    struct Directory* dir;    // directory holding this entry
     struct File* next;
+    struct File* alias;       // next entry for the same inode (circular)
 } File;
 
 typedef struct Directory {
     char name[100];
-    char owner[50];
-    char group[50];        // ✅ NEW
-    int permission;
+    uint32_t ino;
     struct Directory* parent;
     struct Directory* subdirs;
     struct Directory* next;
+    struct Directory* prev;   // O(1) unlink from the sibling list
     struct File* files;
+    DirIndex index;        // ordered name index over subdirs + files
+    int64_t tree_inodes;   // nodes in this subtree, itself included
+    int64_t tree_bytes;    // file content bytes in this subtree
 } Directory;
 
 
@@ -33,30 +38,48 @@ extern char current_user[50];
 void init_fs();
 void go_to_home_directory();
 
-// Basic FS operations
-void mkdir_vfs(const char* name);
-void touch_vfs(const char* name);
-void ls_vfs();
-void ls_l_vfs();
+// Basic FS operations. Those returning int give 0, or -1 if the command
+// failed (or, for a pattern, failed for some name).
+int mkdir_vfs(const char* name);
+int touch_vfs(const char* name);
+void ls_vfs(const char* after, int limit, const char* pattern);   // pattern may be NULL
+void ls_l_vfs(const char* after, int limit, const char* pattern);
+void complete_vfs(const char* prefix);
 void cd_vfs(const char* name);
 void pwd_vfs();
-void write_vfs(const char* name, const char* content);
+int write_vfs(const char* name, const char* content);
 void read_vfs(const char* name);
 
 // Persistence
-void save_vfs();
-void load_vfs();
+int save_vfs();        // 0, or -1 if vfs.txt was not replaced
+int load_vfs();         // -1 also when entries were left out
+int reload_vfs();       // 0 once the background build is started
+void reload_poll();     // between commands: swap in a finished reload
+void reload_cancel();   // wait for a running reload and discard it
 
 // Tree view
 void tree();
 
 // File operations
-void rm_vfs(const char* name);
-void rm_r_vfs(const char* name);
+int rm_vfs(const char* name);
+int rm_r_vfs(const char* name);
+int ln_vfs(const char* target, const char* name);
+int import_vfs(const char* host_path, const char* vfs_path);   // 0, or -1 if nothing was imported
+int export_vfs(const char* vfs_path, const char* out_path);    // 0, or -1 if no archive was written
+int store_vfs(const char* arg);   // 0, or -1 if the store was not switched
 
-void chown_vfs(const char* new_owner, const char* new_group, const char* name);
+// Usage
+void du_vfs(const char* name);
+void quota_vfs(const char* user);
+void scan_vfs(const char* query, const char* user, int bench);
+void grep_vfs(const char* pattern, const char* path, int bench);   // path may be NULL
+void index_vfs(const char* arg);     // NULL: show the word index
+void search_vfs(const char* text);
+void quota_set_vfs(const char* user, long long max_inodes, long long max_bytes);
+
+int chown_vfs(const char* new_owner, const char* new_group, const char* name);
 // vfs.h
-void chmod_vfs(const char* mode, const char* name);
+int chmod_vfs(const char* mode, const char* name);
 
 
 #endif // VFS_H
@@ -0,0 +1,552 @@
+#include "wordindex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "hash.h"
+
+#define INDEX_MAGIC "VFSWIX1\n"
+
+// One word and its posting list: ascending inode numbers, each stored as
+// a varint delta from the one before (the first from 0)
+typedef struct Term {
+    char* word;
+    uint64_t hash;
+    uint8_t* post;
+    uint32_t bytes, cap;   // encoded length, allocated
+    uint32_t count;
+    uint32_t last;         // largest inode in the list
+} Term;
+
+static Term* terms = NULL;
+static uint32_t nterms = 0, term_cap = 0;
+static uint32_t* slots = NULL;          // term index + 1, open addressing
+static uint32_t slot_cap = 0;
+static int enabled = 0;
+static size_t lost = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread int paused = 0;
+
+// === Words ===
+typedef struct Word {
+    uint64_t hash;
+    const char* p;
+    uint32_t len;
+} Word;
+
+typedef struct Words {
+    char* text;            // the words lower-cased, back to back
+    Word* w;
+    size_t n;
+} Words;
+
+static int word_byte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+// Hash of an already lower-cased word
+static uint64_t word_hash(const char* w, size_t len) {
+    return fnv1a64(w, len);
+}
+
+static int word_cmp(const Word* a, const Word* b) {
+    if (a->hash != b->hash) return a->hash < b->hash ? -1 : 1;
+    if (a->len != b->len) return a->len < b->len ? -1 : 1;
+    return memcmp(a->p, b->p, a->len);
+}
+
+static int word_qcmp(const void* a, const void* b) {
+    return word_cmp((const Word*)a, (const Word*)b);
+}
+
+static void words_free(Words* w) {
+    free(w->text);
+    free(w->w);
+}
+
+// Distinct words of s[0..len), in word_cmp order; 0 if out of memory
+static int split_words(const char* s, size_t len, Words* out) {
+    out->text = NULL;
+    out->w = NULL;
+    out->n = 0;
+    if (!len) return 1;
+    out->text = (char*)malloc(len);
+    out->w = (Word*)malloc((len / 2 + 1) * sizeof(Word));
+    if (!out->text || !out->w) {
+        words_free(out);
+        return 0;
+    }
+    size_t i = 0, at = 0;
+    while (i < len) {
+        if (!word_byte((unsigned char)s[i])) {
+            ++i;
+            continue;
+        }
+        size_t start = at;
+        for (; i < len && word_byte((unsigned char)s[i]); ++i) {
+            if (at - start == WORDINDEX_WORD_MAX) continue;
+            out->text[at++] = s[i] >= 'A' && s[i] <= 'Z' ? (char)(s[i] + 32) : s[i];
+        }
+        const char* w = out->text + start;
+        out->w[out->n++] = (Word){ word_hash(w, at - start), w, (uint32_t)(at - start) };
+    }
+    qsort(out->w, out->n, sizeof(Word), word_qcmp);
+    size_t keep = 0;
+    for (size_t k = 0; k < out->n; ++k) {
+        if (keep && word_cmp(&out->w[keep - 1], &out->w[k]) == 0) continue;
+        out->w[keep++] = out->w[k];
+    }
+    out->n = keep;
+    return 1;
+}
+
+// === Terms ===
+// Caller holds lock. Keeps the load factor at most 1/2.
+static int rehash(void) {
+    uint32_t n = slot_cap ? slot_cap * 2 : 1024;
+    uint32_t* s = (uint32_t*)calloc(n, sizeof(uint32_t));
+    if (!s) return 0;
+    for (uint32_t t = 0; t < nterms; ++t) {
+        uint32_t i = (uint32_t)terms[t].hash & (n - 1);
+        while (s[i]) i = (i + 1) & (n - 1);
+        s[i] = t + 1;
+    }
+    free(slots);
+    slots = s;
+    slot_cap = n;
+    return 1;
+}
+
+// Caller holds lock. NULL if absent (and not created, or out of memory).
+// Creating may move every Term.
+static Term* find_term(const Word* w, int create) {
+    if (!slot_cap && (!create || !rehash())) return NULL;
+    uint32_t i = (uint32_t)w->hash & (slot_cap - 1);
+    for (; slots[i]; i = (i + 1) & (slot_cap - 1)) {
+        Term* t = &terms[slots[i] - 1];
+        if (t->hash == w->hash && strlen(t->word) == w->len && memcmp(t->word, w->p, w->len) == 0) return t;
+    }
+    if (!create) return NULL;
+
+    if (nterms == term_cap) {
+        uint32_t cap = term_cap ? term_cap * 2 : 1024;
+        Term* grown = (Term*)realloc(terms, cap * sizeof(Term));
+        if (!grown) return NULL;
+        terms = grown;
+        term_cap = cap;
+    }
+    if ((nterms + 1) * 2 > slot_cap) {
+        if (!rehash()) return NULL;
+        i = (uint32_t)w->hash & (slot_cap - 1);
+        while (slots[i]) i = (i + 1) & (slot_cap - 1);
+    }
+    char* word = (char*)malloc(w->len + 1);
+    if (!word) return NULL;
+    memcpy(word, w->p, w->len);
+    word[w->len] = '\0';
+    Term* t = &terms[nterms];
+    memset(t, 0, sizeof(*t));
+    t->word = word;
+    t->hash = w->hash;
+    slots[i] = ++nterms;
+    return t;
+}
+
+// === Postings ===
+static size_t put_varint(uint8_t* p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t varint_len(uint32_t v) {
+    size_t n = 1;
+    for (; v >= 0x80; v >>= 7) ++n;
+    return n;
+}
+
+// Bytes read, 0 if [p, end) does not hold a whole varint
+static size_t get_varint(const uint8_t* p, const uint8_t* end, uint32_t* v) {
+    uint32_t x = 0;
+    for (size_t n = 0; n < 5 && p + n < end; ++n) {
+        x |= (uint32_t)(p[n] & 0x7f) << (7 * n);
+        if (!(p[n] & 0x80)) {
+            *v = x;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+static int reserve(Term* t, size_t more) {
+    if (t->bytes + more <= t->cap) return 1;
+    size_t cap = t->cap ? t->cap : 8;
+    while (cap < t->bytes + more) cap *= 2;
+    uint8_t* p = (uint8_t*)realloc(t->post, cap);
+    if (!p) return 0;
+    t->post = p;
+    t->cap = (uint32_t)cap;
+    return 1;
+}
+
+// Insert ino; past the end this is an append, else the delta it lands in
+// is split in two and the tail moved up
+static int post_add(Term* t, uint32_t ino) {
+    uint8_t buf[10];
+    if (!t->count || ino > t->last) {
+        size_t n = put_varint(buf, ino - t->last);
+        if (!reserve(t, n)) return 0;
+        memcpy(t->post + t->bytes, buf, n);
+        t->bytes += (uint32_t)n;
+        t->count++;
+        t->last = ino;
+        return 1;
+    }
+    uint32_t prev = 0, off = 0;
+    while (off < t->bytes) {
+        uint32_t d;
+        size_t n = get_varint(t->post + off, t->post + t->bytes, &d);
+        uint32_t v = prev + d;
+        if (v == ino) return 1;
+        if (v > ino) {
+            size_t n1 = put_varint(buf, ino - prev);
+            size_t n2 = put_varint(buf + n1, v - ino);
+            size_t grow = n1 + n2 - n;
+            if (!reserve(t, grow)) return 0;
+            memmove(t->post + off + n1 + n2, t->post + off + n, t->bytes - off - n);
+            memcpy(t->post + off, buf, n1 + n2);
+            t->bytes += (uint32_t)grow;
+            t->count++;
+            return 1;
+        }
+        prev = v;
+        off += (uint32_t)n;
+    }
+    return 1;
+}
+
+// Remove ino; its delta is folded into the next one
+static void post_remove(Term* t, uint32_t ino) {
+    if (!t->count || ino > t->last) return;
+    const uint8_t* end = t->post + t->bytes;
+    uint32_t prev = 0, off = 0;
+    while (off < t->bytes) {
+        uint32_t d;
+        size_t n = get_varint(t->post + off, end, &d);
+        uint32_t v = prev + d;
+        if (v > ino) return;
+        if (v == ino) {
+            if (off + n == t->bytes) {
+                t->bytes = off;
+                t->last = prev;
+            } else {
+                uint32_t d2;
+                size_t n2 = get_varint(t->post + off + n, end, &d2);
+                uint8_t buf[5];
+                size_t m = put_varint(buf, d + d2); // never longer than the two it replaces
+                memmove(t->post + off + m, t->post + off + n + n2, t->bytes - off - n - n2);
+                memcpy(t->post + off, buf, m);
+                t->bytes -= (uint32_t)(n + n2 - m);
+            }
+            t->count--;
+            return;
+        }
+        prev = v;
+        off += (uint32_t)n;
+    }
+}
+
+// Replace the list with ids[0..n) (ascending, distinct)
+static int post_set(Term* t, const uint32_t* ids, size_t n) {
+    size_t need = 0;
+    uint32_t prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+        need += varint_len(ids[i] - prev);
+        prev = ids[i];
+    }
+    t->bytes = 0;
+    if (!reserve(t, need)) return 0;
+    prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+        t->bytes += (uint32_t)put_varint(t->post + t->bytes, ids[i] - prev);
+        prev = ids[i];
+    }
+    t->count = (uint32_t)n;
+    t->last = prev;
+    return 1;
+}
+
+static size_t post_decode(const Term* t, uint32_t* out) {
+    const uint8_t* p = t->post;
+    const uint8_t* end = p + t->bytes;
+    uint32_t v = 0, d;
+    size_t n = 0, k;
+    while ((k = get_varint(p, end, &d)) != 0) {
+        v += d;
+        out[n++] = v;
+        p += k;
+    }
+    return n;
+}
+
+// === Updates ===
+int wordindex_enabled(void) {
+    return __atomic_load_n(&enabled, __ATOMIC_ACQUIRE);
+}
+
+void wordindex_enable(int on) {
+    pthread_mutex_lock(&lock);
+    if (!on) {
+        for (uint32_t i = 0; i < nterms; ++i) {
+            free(terms[i].word);
+            free(terms[i].post);
+        }
+        free(terms);
+        free(slots);
+        terms = NULL;
+        slots = NULL;
+        nterms = term_cap = slot_cap = 0;
+        lost = 0;
+    }
+    __atomic_store_n(&enabled, on != 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&lock);
+}
+
+void wordindex_pause(int p) {
+    paused = p;
+}
+
+// Only the words in one version and not the other change: both sides
+// come sorted, so one merge pass finds them
+void wordindex_update(uint32_t ino, const char* old, size_t old_len, const char* data, size_t len) {
+    if (paused || !wordindex_enabled() || (!old_len && !len)) return;
+    Words a, b;
+    int ok = split_words(old, old_len, &a);
+    if (ok && !split_words(data, len, &b)) {
+        words_free(&a);
+        ok = 0;
+    }
+    pthread_mutex_lock(&lock);
+    if (!ok) {
+        lost++;
+    } else if (enabled) {
+        size_t i = 0, j = 0;
+        while (i < a.n || j < b.n) {
+            int c = i == a.n ? 1 : j == b.n ? -1 : word_cmp(&a.w[i], &b.w[j]);
+            if (c < 0) {
+                Term* t = find_term(&a.w[i++], 0);
+                if (t) post_remove(t, ino);
+            } else if (c > 0) {
+                Term* t = find_term(&b.w[j++], 1);
+                if (!t || !post_add(t, ino)) lost++;
+            } else {
+                ++i;
+                ++j;
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    if (ok) {
+        words_free(&a);
+        words_free(&b);
+    }
+}
+
+// === Queries ===
+long wordindex_query(const char* text, int* nwords, uint32_t** out) {
+    *out = NULL;
+    Words q;
+    if (!split_words(text, strlen(text), &q)) return -1;
+    *nwords = (int)q.n;
+    if (!q.n) return 0;
+
+    pthread_mutex_lock(&lock);
+    long n = 0;
+    Term** list = (Term**)malloc(q.n * sizeof(Term*));
+    if (!list) n = -1;
+    for (size_t i = 0; list && i < q.n; ++i) {
+        Term* t = find_term(&q.w[i], 0);
+        if (!t || !t->count) goto done;
+        // Rarest first: the candidates only shrink from there
+        size_t k = i;
+        for (; k > 0 && list[k - 1]->count > t->count; --k) list[k] = list[k - 1];
+        list[k] = t;
+    }
+    if (list) {
+        uint32_t* ids = (uint32_t*)malloc(list[0]->count * sizeof(uint32_t));
+        if (!ids) {
+            n = -1;
+            goto done;
+        }
+        size_t have = post_decode(list[0], ids);
+        for (size_t k = 1; k < q.n && have; ++k) {
+            const uint8_t* p = list[k]->post;
+            const uint8_t* end = p + list[k]->bytes;
+            uint32_t v = 0, d;
+            size_t i = 0, keep = 0, used;
+            while (i < have && (used = get_varint(p, end, &d)) != 0) {
+                p += used;
+                v += d;
+                while (i < have && ids[i] < v) ++i;
+                if (i < have && ids[i] == v) ids[keep++] = ids[i++];
+            }
+            have = keep;
+        }
+        *out = ids;
+        n = (long)have;
+    }
+done:
+    pthread_mutex_unlock(&lock);
+    free(list);
+    words_free(&q);
+    return n;
+}
+
+WordIndexInfo wordindex_info(void) {
+    WordIndexInfo info;
+    memset(&info, 0, sizeof(info));
+    pthread_mutex_lock(&lock);
+    info.memory = (size_t)term_cap * sizeof(Term) + (size_t)slot_cap * sizeof(uint32_t);
+    for (uint32_t i = 0; i < nterms; ++i) {
+        const Term* t = &terms[i];
+        info.words += t->count != 0;
+        info.postings += t->count;
+        info.bytes += t->bytes;
+        info.memory += t->cap + strlen(t->word) + 1;
+    }
+    info.lost = lost;
+    pthread_mutex_unlock(&lock);
+    return info;
+}
+
+// === Persistence ===
+// Header: magic, generation (u64), files, words (u32), then the inode of
+// each file (u32). Then per word: its length (u8) and bytes, postings and
+// encoded bytes (u32), and the list.
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+int wordindex_save(const char* path, unsigned long generation, const uint32_t* ino, uint32_t nfiles) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) return -1;
+    pthread_mutex_lock(&lock);
+    uint32_t nwords = 0;
+    for (uint32_t i = 0; i < nterms; ++i) nwords += terms[i].count != 0;
+    uint64_t gen = generation;
+    int ok = fwrite(INDEX_MAGIC, 1, 8, fp) == 8 && fwrite(&gen, sizeof(gen), 1, fp) == 1 &&
+             fwrite(&nfiles, sizeof(nfiles), 1, fp) == 1 && fwrite(&nwords, sizeof(nwords), 1, fp) == 1 &&
+             fwrite(ino, sizeof(uint32_t), nfiles, fp) == nfiles;
+    for (uint32_t i = 0; ok && i < nterms; ++i) {
+        const Term* t = &terms[i];
+        if (!t->count) continue;
+        uint8_t len = (uint8_t)strlen(t->word);
+        ok = fwrite(&len, 1, 1, fp) == 1 && fwrite(t->word, 1, len, fp) == len &&
+             fwrite(&t->count, sizeof(t->count), 1, fp) == 1 && fwrite(&t->bytes, sizeof(t->bytes), 1, fp) == 1 &&
+             fwrite(t->post, 1, t->bytes, fp) == t->bytes;
+    }
+    pthread_mutex_unlock(&lock);
+    if (fclose(fp) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+// Add ids[0..n) (ascending, distinct) to t, merging with what it holds
+static int post_merge(Term* t, const uint32_t* ids, size_t n) {
+    if (!t->count) return post_set(t, ids, n);
+    uint32_t* both = (uint32_t*)malloc((t->count + n) * sizeof(uint32_t));
+    if (!both) return 0;
+    size_t have = post_decode(t, both + n), i = n, j = 0, k = 0;
+    while (i < n + have || j < n) {
+        uint32_t v = j == n || (i < n + have && both[i] < ids[j]) ? both[i++] : ids[j++];
+        if (k && both[k - 1] == v) continue;
+        both[k++] = v;
+    }
+    int ok = post_set(t, both, k);
+    free(both);
+    return ok;
+}
+
+int wordindex_load(const char* path, unsigned long generation, const uint32_t* ino, uint32_t nfiles) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return -1;
+    char magic[8];
+    uint64_t gen;
+    uint32_t files, nwords;
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, INDEX_MAGIC, 8) != 0 ||
+        fread(&gen, sizeof(gen), 1, fp) != 1 || fread(&files, sizeof(files), 1, fp) != 1 ||
+        fread(&nwords, sizeof(nwords), 1, fp) != 1 || gen != generation || files != nfiles) {
+        fclose(fp);
+        return -1;
+    }
+
+    // Saved inode -> this load's inode
+    uint32_t* saved = (uint32_t*)malloc((size_t)nfiles * sizeof(uint32_t) + 1);
+    uint32_t* map = NULL;
+    uint32_t map_len = 0;
+    int ok = saved && fread(saved, sizeof(uint32_t), nfiles, fp) == nfiles;
+    for (uint32_t k = 0; ok && k < nfiles; ++k) {
+        if (saved[k] >= map_len) map_len = saved[k] + 1;
+    }
+    if (ok) ok = (map = (uint32_t*)calloc((size_t)map_len + 1, sizeof(uint32_t))) != NULL;
+    for (uint32_t k = 0; ok && k < nfiles; ++k) map[saved[k]] = ino[k];
+    free(saved);
+
+    uint8_t* enc = NULL;
+    uint32_t* ids = NULL;
+    size_t enc_cap = 0, ids_cap = 0;
+    pthread_mutex_lock(&lock);
+    for (uint32_t w = 0; ok && enabled && w < nwords; ++w) {
+        uint8_t len;
+        char word[WORDINDEX_WORD_MAX];
+        uint32_t count, bytes;
+        ok = fread(&len, 1, 1, fp) == 1 && len && len <= WORDINDEX_WORD_MAX &&
+             fread(word, 1, len, fp) == len && fread(&count, sizeof(count), 1, fp) == 1 &&
+             fread(&bytes, sizeof(bytes), 1, fp) == 1 && bytes <= (uint64_t)count * 5;
+        if (ok && bytes > enc_cap) {
+            free(enc);
+            enc_cap = bytes;
+            ok = (enc = (uint8_t*)malloc(enc_cap)) != NULL;
+        }
+        if (ok && count > ids_cap) {
+            free(ids);
+            ids_cap = count;
+            ok = (ids = (uint32_t*)malloc(ids_cap * sizeof(uint32_t))) != NULL;
+        }
+        if (!ok || fread(enc, 1, bytes, fp) != bytes) {
+            ok = 0;
+            break;
+        }
+
+        // Inodes must ascend; those the snapshot did not save drop out
+        const uint8_t* p = enc;
+        uint32_t v = 0, d;
+        size_t n = 0, used;
+        for (uint32_t k = 0; ok && k < count; ++k) {
+            used = get_varint(p, enc + bytes, &d);
+            ok = used && (k == 0 || d > 0) && (uint64_t)v + d <= UINT32_MAX;
+            p += used;
+            v += d;
+            if (ok && v < map_len && map[v]) ids[n++] = map[v];
+        }
+        if (!ok || !n) continue;
+        size_t k = 1;
+        while (k < n && ids[k - 1] < ids[k]) ++k;
+        if (k < n) qsort(ids, n, sizeof(uint32_t), cmp_u32);
+
+        Word key = { word_hash(word, len), word, len };
+        Term* t = find_term(&key, 1);
+        ok = t && post_merge(t, ids, n);
+    }
+    if (!enabled) ok = 0;
+    pthread_mutex_unlock(&lock);
+    free(map);
+    free(enc);
+    free(ids);
+    fclose(fp);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,58 @@
+#ifndef WORDINDEX_H
+#define WORDINDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Optional inverted index over file contents: every word maps to the
+// inodes whose content contains it. A word is a run of letters, digits,
+// '_' and bytes >= 0x80 (so UTF-8 text stays whole), lower-cased and cut
+// to WORDINDEX_WORD_MAX bytes; queries are split the same way.
+//
+// Posting lists are kept sorted and stored as varint deltas, so a list
+// costs about a byte per file for common words. inode.c reports every
+// content change; only the words that appear or disappear are touched,
+// and a new inode above every one in a list is a plain append.
+//
+// Thread-safe: the reaper drops the words of files it frees. Callers
+// holding inode_lock() may call in, never the other way round.
+
+#define WORDINDEX_WORD_MAX 32
+#define WORDINDEX_FILE     "vfs.index"
+
+typedef struct WordIndexInfo {
+    size_t words;          // with at least one file
+    size_t postings;
+    size_t bytes;          // encoded postings
+    size_t memory;         // everything the index holds
+    size_t lost;           // updates dropped for lack of memory
+} WordIndexInfo;
+
+int wordindex_enabled(void);
+
+// Start empty or drop everything
+void wordindex_enable(int on);
+
+// Content of ino changed from old to data
+void wordindex_update(uint32_t ino, const char* old, size_t old_len, const char* data, size_t len);
+
+// Ignore changes made by the calling thread (a load adopting a saved index)
+void wordindex_pause(int paused);
+
+// Inodes holding every word of `text`, ascending, in *out (caller frees).
+// *nwords is how many words the text had. Returns the count, or -1 if out
+// of memory.
+long wordindex_query(const char* text, int* nwords, uint32_t** out);
+
+WordIndexInfo wordindex_info(void);
+
+// Persistence. Inode numbers change across a load, so a saved index
+// carries the inode each file of its snapshot had, in snapshot order;
+// the lists themselves are written as they are. Load maps them onto
+// ino[position] (INODE_NONE: no file), adding to what is there. It fails,
+// possibly having added part, unless the file belongs to snapshot
+// `generation` with `nfiles` files. Both return 0 or -1.
+int wordindex_save(const char* path, unsigned long generation, const uint32_t* ino, uint32_t nfiles);
+int wordindex_load(const char* path, unsigned long generation, const uint32_t* ino, uint32_t nfiles);
+
+#endif // WORDINDEX_H
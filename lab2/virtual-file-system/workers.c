@@ -0,0 +1,17 @@
+#include "workers.h"
+#include <pthread.h>
+
+void workers_run(void* (*run)(void*), void* jobs, size_t job_size, int n) {
+    char* job = (char*)jobs;
+    pthread_t tids[WORKERS_MAX];
+    int started[WORKERS_MAX] = { 0 };
+    int spawn = n < WORKERS_MAX ? n : WORKERS_MAX;
+    for (int i = 1; i < spawn; ++i) {
+        started[i] = pthread_create(&tids[i], NULL, run, job + (size_t)i * job_size) == 0;
+    }
+    if (n > 0) run(job);
+    for (int i = 1; i < n; ++i) {
+        if (i < spawn && started[i]) pthread_join(tids[i], NULL);
+        else run(job + (size_t)i * job_size);
+    }
+}
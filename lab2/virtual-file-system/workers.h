@@ -0,0 +1,14 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <stddef.h>
+
+#define WORKERS_MAX 16
+
+// Run `run` on each of the n jobs in `jobs` (an array of job_size-byte
+// elements) and return once all are done. Job 0 runs on the calling
+// thread and jobs 1..n-1 on their own threads; a job whose thread fails
+// to start, or past WORKERS_MAX, is run inline afterwards.
+void workers_run(void* (*run)(void*), void* jobs, size_t job_size, int n);
+
+#endif // WORKERS_H